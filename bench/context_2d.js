@@ -0,0 +1,69 @@
+// Call throughput of the hot CanvasContext2D bindings.
+// Run it in place of the game's index.js, or Rekka.include("bench/context_2d.js") from it,
+// the results are printed to the log as the best of RUNS runs, in ns per call.
+(function () {
+	var N = 100000;
+	var RUNS = 5;
+
+	// the first canvas is the screen, once a game has created it this one is offscreen
+	var target = new Rekka.Canvas();
+	if (!target.style) {
+		target.width = 512;
+		target.height = 256;
+	}
+	var ctx = target.getContext("2d");
+	var source = new Rekka.Canvas();
+	source.width = 64;
+	source.height = 64;
+	var sctx = source.getContext("2d");
+	sctx.fillStyle = "#c04080";
+	sctx.fillRect(0, 0, 64, 64);
+
+	var cases = [
+		["drawImage(image, dx, dy)", function (n) {
+			for (var i = 0; i < n; i++) ctx.drawImage(source, i & 255, 0);
+		}],
+		["drawImage(image, sx, sy, sw, sh, dx, dy, dw, dh)", function (n) {
+			for (var i = 0; i < n; i++) ctx.drawImage(source, 0, 0, 32, 32, i & 255, 0, 32, 32);
+		}],
+		["fillRect", function (n) {
+			for (var i = 0; i < n; i++) ctx.fillRect(i & 255, 0, 16, 16);
+		}],
+		["setTransform", function (n) {
+			for (var i = 0; i < n; i++) ctx.setTransform(1, 0, 0, 1, i & 255, 0);
+			ctx.setTransform(1, 0, 0, 1, 0, 0);
+		}],
+		["save + restore", function (n) {
+			for (var i = 0; i < n; i++) {
+				ctx.save();
+				ctx.restore();
+			}
+		}],
+		["globalAlpha =", function (n) {
+			for (var i = 0; i < n; i++) ctx.globalAlpha = (i & 1) ? 0.5 : 1;
+			ctx.globalAlpha = 1;
+		}],
+		["fillStyle =", function (n) {
+			for (var i = 0; i < n; i++) ctx.fillStyle = (i & 1) ? "#ff0000" : "#0000ff";
+		}]
+	];
+
+	function measure(body) {
+		// warm up, so that the loop is compiled by the time it is measured
+		body(N);
+		var best = Infinity;
+		for (var run = 0; run < RUNS; run++) {
+			var start = Rekka.performanceNow();
+			body(N);
+			best = Math.min(best, Rekka.performanceNow() - start);
+		}
+		return best * 1000000 / N;
+	}
+
+	requestAnimationFrame(function () {
+		print("context_2d: " + N + " calls, best of " + RUNS + " runs");
+		for (var i = 0; i < cases.length; i++) {
+			print("  " + cases[i][0] + ": " + measure(cases[i][1]).toFixed(1) + " ns/call");
+		}
+	});
+})();
@@ -49,6 +49,7 @@ Mix_Chunk* AudioManager::fetchChunk(const std::string & path)
 	}
 	Mix_Chunk* chunk = Mix_LoadWAV_RW(SDL_RWFromFile(path.c_str(), "rb"), SDL_TRUE);
 	_chunkCache[path] = { chunk, 1 };
+	_loadedCount++;
 	return chunk;
 }
 
@@ -66,6 +67,25 @@ void AudioManager::releaseChunk(Mix_Chunk* chunk)
 	}
 }
 
+void AudioManager::suspend()
+{
+	int channels = Mix_AllocateChannels(-1);
+	for (int channel = 0; channel < channels; channel++) {
+		if (Mix_Playing(channel) && !Mix_Paused(channel)) {
+			Mix_Pause(channel);
+			_suspendedChannels.push_back(channel);
+		}
+	}
+}
+
+void AudioManager::resume()
+{
+	for (int channel : _suspendedChannels) {
+		Mix_Resume(channel);
+	}
+	_suspendedChannels.clear();
+}
+
 void AudioManager::finishCallbackStatic(void * userdata, int channel)
 {
 	AudioManager* audiomgr = (AudioManager*)userdata;
@@ -89,6 +109,7 @@ void AudioManager::finishCallback(void * userdata, Mix_Music * music, int channe
 }
 
 AudioManager::AudioManager()
+: _loadedCount(0)
 {
 }
 
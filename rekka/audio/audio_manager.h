@@ -19,6 +19,11 @@ public:
 	void removeAudio(Audio* audio);
 	Mix_Chunk* fetchChunk(const std::string& path);
 	void releaseChunk(Mix_Chunk* chunk);
+	// pause every playing channel, resume() continues only those
+	void suspend();
+	void resume();
+	unsigned int getLoadedCount() const { return _loadedCount; }
+	int getPlayingCount() { return Mix_Playing(-1); }
 private:
 	static void finishCallbackStatic(void* userdata, int channel);
 	static void finishCallback(void* userdata, Mix_Music *music, int channel);	
@@ -29,6 +34,8 @@ private:
 		int refcount;
 	};
 	std::map<std::string, ChunkItem> _chunkCache;
+	std::vector<int> _suspendedChannels;
+	unsigned int _loadedCount;
 };
 
 NS_REK_END
\ No newline at end of file
@@ -4,15 +4,22 @@
 #include "render/image.h"
 #include "render/canvas.h"
 #include "render/2d/context_2d.h"
+#include "render/2d/path_2d.h"
 #include "render/extra.h"
+#include "render/texture_pool.h"
 #include "system/xml_http_request.h"
 #include "audio/audio_manager.h"
 #include "audio/audio.h"
+#include "stats.h"
+#include "trace.h"
 #include "rapidjson/document.h"
 #include "stb_image.h"
 
 NS_REK_BEGIN
 
+// interval (ms) of timers while paused, like the browsers do for background tabs
+#define BACKGROUND_TIMER_INTERVAL 1000
+
 Core* Core::s_sharedRekkaCore = nullptr;
 Core* Core::getInstance()
 {
@@ -26,7 +33,8 @@ void Core::destroyInstance()
 }
 
 Core::Core()
-: _paused(false), _taskGarbageCollection(0), _requestAnimationFrameFunc(nullptr),
+: _paused(false), _pausedTimerTime(0), _backgroundAudio(false), _tracing(false), _showStats(false), _taskGarbageCollection(0), _requestAnimationFrameFunc(nullptr),
+_pauseCallback(nullptr), _resumeCallback(nullptr),
 _isFullscreen(false), _isLandscape(true), _appName("Game"), _prefPath("")
 {	
 }
@@ -39,6 +47,10 @@ Core::~Core()
 	SAFE_DELETE(_touchStartCallback);
 	SAFE_DELETE(_touchEndCallback);
 	SAFE_DELETE(_touchMoveCallback);
+	SAFE_DELETE(_pauseCallback);
+	SAFE_DELETE(_resumeCallback);
+	Stats::destroyInstance();
+	TexturePool::destroyInstance();
 	gpu::Quit();
 }
 
@@ -78,12 +90,17 @@ bool Core::init()
 #ifdef _DEBUG
 	gpu::SetDebugLevel(gpu::DEBUG_LEVEL_MAX);
 #endif
-#if !defined(SINGLE_BUFFERED)
-	SDL_GL_SetSwapInterval(0);
-#endif
+	_framePacer.apply(_window);
+
+	auto tracer = Tracer::getInstance();
+	tracer->setThreadName("main");
+	tracer->setDefaultPath(_prefPath + "trace.json");
+	if (_tracing) tracer->setEnabled(true);
 
 	AudioManager::getInstance()->initialze();
 	CanvasExtra::initialize();
+	// turning stats on reads the managers, so it waits for them
+	if (_showStats) Stats::getInstance()->setOverlay(true);
 
 	jsb_register();
 
@@ -93,106 +110,190 @@ bool Core::init()
 void Core::run()
 {
 	auto scheduler = Scheduler::getInstance();
-	auto fontmgr = FontManager::getInstance();
 	auto scripter = ScriptCore::getInstance();
+	auto stats = Stats::getInstance();
 
 	initRekkaEnvironment();
+	gpu::InvalidateTarget(_screen);
 
 	bool done = false;
-	double prev_t = scheduler->performanceNow();
 	double fps_t = 0;
-	int frameCount = 0;
 	
 	while (!done) {
-		double now = scheduler->performanceNow();
-		double deltaTime = (now - prev_t) * 0.001f;
-		prev_t = now;
-
-		scheduler->update(deltaTime);
-		fontmgr->update(deltaTime);
-
-		SDL_Event event;
-		float x, y;
-		int keycode = 0;
-		while (SDL_PollEvent(&event)) {
-			switch (event.type) {			
-			case SDL_MOUSEBUTTONDOWN:				
-			case SDL_MOUSEBUTTONUP:
-				x = event.button.x;
-				y = event.button.y;
-				traslatePoint(x, y);
-				fireMouseClick(event.button.button, x, y, event.type == SDL_MOUSEBUTTONDOWN);
-				break;
-			case SDL_MOUSEMOTION:
-				x = event.button.x;
-				y = event.button.y;
-				traslatePoint(x, y);
-				fireMouseMove(x, y);
-				break;
-			case SDL_KEYDOWN:				
-				if (event.key.keysym.sym == SDLK_RETURN && (event.key.keysym.mod & KMOD_ALT)) {
-					setFullscreen(!_isFullscreen);
-				}
-				keycode = SDLKeyToHtmlKey(event.key.keysym.sym);
-				if (keycode) fireKeyboard(keycode, event.key.keysym.mod, true);
-				break;
-			case SDL_KEYUP:
-				keycode = SDLKeyToHtmlKey(event.key.keysym.sym);
-				if (keycode) fireKeyboard(keycode, event.key.keysym.mod, false);
-				break;
-			case SDL_FINGERDOWN:
-				x = event.tfinger.x;
-				y = event.tfinger.y;
-				traslateTouchPoint(x, y);				
-				fireTouchEvent(event.tfinger.touchId, x, y, 0);
-				break;
-			case SDL_FINGERUP:
-				x = event.tfinger.x;
-				y = event.tfinger.y;
-				traslateTouchPoint(x, y);
-				fireTouchEvent(event.tfinger.touchId, x, y, 1);
-				break;
-			case SDL_FINGERMOTION:
-				x = event.tfinger.x;
-				y = event.tfinger.y;
-				traslateTouchPoint(x, y);
-				fireTouchEvent(event.tfinger.touchId, x, y, 2);
-				break;
-			case SDL_QUIT:
-				done = true;
-				break;
+		if (_paused) {
+			// in background: no rendering, block on events and run timers at a low rate
+			SDL_Event event;
+			if (SDL_WaitEventTimeout(&event, BACKGROUND_TIMER_INTERVAL)) {
+				do {
+					if (!handleEvent(event)) done = true;
+				} while (SDL_PollEvent(&event));
+			}
+			double now = scheduler->performanceNow();
+			if (_paused && now - _pausedTimerTime >= BACKGROUND_TIMER_INTERVAL) {
+				scheduler->update((now - _pausedTimerTime) * 0.001);
+				_pausedTimerTime = now;
 			}
+			continue;
+		}
+		double timestamp = _framePacer.beginFrame();
+		double deltaTime = _framePacer.getDeltaTime() * 0.001;
+		bool statsEnabled = stats->isEnabled();
+		if (statsEnabled) stats->beginFrame();
+
+		double scriptStart = statsEnabled ? scheduler->performanceNow() : 0;
+		{
+			TRACE_SCOPE("Scheduler::update");
+			scheduler->update(deltaTime);
 		}
+		{
+			TRACE_SCOPE("Events");
+			SDL_Event event;
+			while (SDL_PollEvent(&event)) {
+				if (!handleEvent(event)) done = true;
+			}
+		}
+		if (_paused) continue;
 
 		if (_taskGarbageCollection > 0) {
+			TRACE_SCOPE("forceGC");
 			_taskGarbageCollection--;
 			scripter->forceGC();
 		}
-		bool skip = fireRequestAnimationFrame(deltaTime);		
-		if (!skip) gpu::Flip(_screen);
+		bool skip;
+		{
+			TRACE_SCOPE("requestAnimationFrame");
+			skip = fireRequestAnimationFrame(deltaTime, timestamp);
+		}
+		if (statsEnabled) stats->addScriptTime(scheduler->performanceNow() - scriptStart);
+		// present only when something was drawn to the screen, otherwise leave the last frame and idle
+		bool presented = !skip && gpu::GetDamageRect(_screen, nullptr);
+		if (presented) {
+			TRACE_SCOPE("Flip");
+			if (statsEnabled) stats->drawOverlay(_screen);
+			gpu::Flip(_screen);
+		}
+		if (statsEnabled) stats->endFrame();
+		{
+			TRACE_SCOPE("FramePacer::wait");
+			_framePacer.endFrame(presented);
+		}
 
 		fps_t += deltaTime;
-		frameCount++;
 		if (fps_t > 1.0) {
+			const auto& timeStats = _framePacer.fetchStats();
 #ifdef REKKA_DESKTOP
-			static char title[0x20];
-			sprintf(title, "Rekka %.2f FPS", (float)frameCount / fps_t);
+			static char title[0x40];
+			sprintf(title, "Rekka %.2f FPS (%.2f +/- %.2f ms)", timeStats.fps, timeStats.average, timeStats.jitter);
 			SDL_SetWindowTitle(_window, title);
 #else
-			SDL_Log("Rekka %.2f FPS", (float)frameCount / fps_t);
+			SDL_Log("Rekka %.2f FPS, frame time %.2f ms, jitter %.2f ms, max %.2f ms", timeStats.fps, timeStats.average, timeStats.jitter, timeStats.maximum);
 #endif
 			fps_t = 0;
-			frameCount = 0;
 		}
 	}
+	if (Tracer::isEnabled()) {
+		auto tracer = Tracer::getInstance();
+		tracer->dump(tracer->getDefaultPath().c_str());
+	}
+}
+
+bool Core::handleEvent(const SDL_Event& event)
+{
+	float x, y;
+	int keycode = 0;
+	switch (event.type) {			
+	case SDL_MOUSEBUTTONDOWN:				
+	case SDL_MOUSEBUTTONUP:
+		x = event.button.x;
+		y = event.button.y;
+		traslatePoint(x, y);
+		fireMouseClick(event.button.button, x, y, event.type == SDL_MOUSEBUTTONDOWN);
+		break;
+	case SDL_MOUSEMOTION:
+		x = event.button.x;
+		y = event.button.y;
+		traslatePoint(x, y);
+		fireMouseMove(x, y);
+		break;
+	case SDL_KEYDOWN:				
+		if (event.key.keysym.sym == SDLK_RETURN && (event.key.keysym.mod & KMOD_ALT)) {
+			setFullscreen(!_isFullscreen);
+		}
+		if (event.key.keysym.sym == SDLK_F12 && Tracer::isEnabled()) {
+			auto tracer = Tracer::getInstance();
+			tracer->dump(tracer->getDefaultPath().c_str());
+		}
+		keycode = SDLKeyToHtmlKey(event.key.keysym.sym);
+		if (keycode) fireKeyboard(keycode, event.key.keysym.mod, true);
+		break;
+	case SDL_KEYUP:
+		keycode = SDLKeyToHtmlKey(event.key.keysym.sym);
+		if (keycode) fireKeyboard(keycode, event.key.keysym.mod, false);
+		break;
+	case SDL_FINGERDOWN:
+		x = event.tfinger.x;
+		y = event.tfinger.y;
+		traslateTouchPoint(x, y);				
+		fireTouchEvent(event.tfinger.touchId, x, y, 0);
+		break;
+	case SDL_FINGERUP:
+		x = event.tfinger.x;
+		y = event.tfinger.y;
+		traslateTouchPoint(x, y);
+		fireTouchEvent(event.tfinger.touchId, x, y, 1);
+		break;
+	case SDL_FINGERMOTION:
+		x = event.tfinger.x;
+		y = event.tfinger.y;
+		traslateTouchPoint(x, y);
+		fireTouchEvent(event.tfinger.touchId, x, y, 2);
+		break;
+	case SDL_WINDOWEVENT:
+		switch (event.window.event) {
+		case SDL_WINDOWEVENT_EXPOSED:
+		case SDL_WINDOWEVENT_SIZE_CHANGED:
+			gpu::InvalidateTarget(_screen);
+			break;
+		case SDL_WINDOWEVENT_MINIMIZED:
+		case SDL_WINDOWEVENT_FOCUS_LOST:
+			pause();
+			break;
+		case SDL_WINDOWEVENT_RESTORED:
+		case SDL_WINDOWEVENT_FOCUS_GAINED:
+			resume();
+			break;
+		}
+		break;
+	case SDL_APP_WILLENTERBACKGROUND:
+		pause();
+		break;
+	case SDL_APP_DIDENTERFOREGROUND:
+		resume();
+		break;
+	case SDL_QUIT:
+		return false;
+	}
+	return true;
 }
 
 void Core::pause()
 {
+	if (_paused) return;
+	_paused = true;
+	_pausedTimerTime = Scheduler::getInstance()->performanceNow();
+	if (!_backgroundAudio) AudioManager::getInstance()->suspend();
+	fireVisibilityEvent(_pauseCallback);
 }
 
 void Core::resume()
 {
+	if (!_paused) return;
+	_paused = false;
+	if (!_backgroundAudio) AudioManager::getInstance()->resume();
+	// don't let the time spent in background leak into the next frame
+	_framePacer.reset();
+	gpu::InvalidateTarget(_screen);
+	fireVisibilityEvent(_resumeCallback);
 }
 
 bool Core::initManifest()
@@ -217,6 +318,24 @@ bool Core::initManifest()
 	if (d.HasMember("orientation") && d["orientation"].IsString()) {
 		_isLandscape = strcasecmp(d["orientation"].GetString(), "portrait") != 0;
 	}
+	// "frame_pacing": "vsync" | "adaptive" | "limiter" | "none", "frame_rate": 60
+	FramePacingMode pacingMode = _framePacer.getMode();
+	if (d.HasMember("frame_pacing") && d["frame_pacing"].IsString()) {
+		for (int idx = 0; _framePacingMode_enum_names[idx]; ++idx) {
+			if (strcasecmp(_framePacingMode_enum_names[idx], d["frame_pacing"].GetString()) == 0) {
+				pacingMode = (FramePacingMode)idx;
+				break;
+			}
+		}
+	}
+	int frameRate = d.HasMember("frame_rate") && d["frame_rate"].IsInt() ? d["frame_rate"].GetInt() : 0;
+	_framePacer.setMode(pacingMode, frameRate);
+	// keep playing audio while paused (minimized / in background)
+	_backgroundAudio = d.HasMember("background_audio") && d["background_audio"].IsBool() && d["background_audio"].GetBool();
+	// record trace zones from the start, dumped with F12, Rekka.traceDump() or on exit
+	_tracing = d.HasMember("trace") && d["trace"].IsBool() && d["trace"].GetBool();
+	// "stats": true shows the statistics overlay from the start
+	_showStats = d.HasMember("stats") && d["stats"].IsBool() && d["stats"].GetBool();
 	SDL_SetHint(SDL_HINT_ANDROID_SEPARATE_MOUSE_AND_TOUCH, "1");
 #ifndef REKKA_DESKTOP
 	_isFullscreen = true; // always fullscreen at Mobile
@@ -266,6 +385,8 @@ void Core::jsb_register()
 		JS_FUNC_DEF(Core, include),
 		JS_FUNC_DEF(Core, performanceNow),
 		JS_FUNC_DEF(Core, loadFont),
+		JS_FUNC_DEF(Core, prepareText),
+		JS_FUNC_DEF(Core, distanceFieldText),
 		JS_FS_END
 	};	
 	JS::RootedObject rekkaobj(ctx, JS_NewObject(ctx, nullptr));	
@@ -275,8 +396,11 @@ void Core::jsb_register()
 	
 	Image::jsb_register(ctx, rekkaobj);
 	Canvas::jsb_register(ctx, rekkaobj);
+	Path2D::jsb_register(ctx, rekkaobj);
 	XMLHttpRequest::jsb_register(ctx, rekkaobj);
 	Audio::jsb_register(ctx, rekkaobj);
+	Stats::jsb_register(ctx, rekkaobj);
+	Tracer::jsb_register(ctx, rekkaobj);
 
 	_localStorage.jsb_register(ctx, global);
 }
@@ -297,6 +421,10 @@ void Core::initRekkaEnvironment()
 	JS_GetProperty(ctx, global, "_touchEndCallback", _touchEndCallback);
 	_touchMoveCallback = new JS::PersistentRootedValue(ctx, JS::NullValue());
 	JS_GetProperty(ctx, global, "_touchMoveCallback", _touchMoveCallback);
+	_pauseCallback = new JS::PersistentRootedValue(ctx, JS::NullValue());
+	JS_GetProperty(ctx, global, "_pauseCallback", _pauseCallback);
+	_resumeCallback = new JS::PersistentRootedValue(ctx, JS::NullValue());
+	JS_GetProperty(ctx, global, "_resumeCallback", _resumeCallback);
 
 	// perform "window.onload"
 	JS::RootedValue onloadfunc(ctx);
@@ -333,6 +461,7 @@ void Core::setFullscreen(bool enable)
 		gpu::UnsetVirtualResolution(_screen);
 		gpu::UnsetViewport(_screen);
 	}
+	gpu::InvalidateTarget(_screen);
 }
 
 void Core::setFullscreenVirtualResolution()
@@ -394,15 +523,16 @@ bool Core::js_requestAnimationFrame(JSContext* ctx, unsigned argc, JS::Value* vp
 	JS_RETURN;
 }
 
-bool Core::fireRequestAnimationFrame(float deltaTime)
+bool Core::fireRequestAnimationFrame(float deltaTime, double timestamp)
 {
 	if (_requestAnimationFrameFunc->isNullOrUndefined()) return false;
 	auto ctx = ScriptCore::getInstance()->getGlobalContext();
 	auto global = ScriptCore::getInstance()->getGlobalObject();
 	JS::RootedValue funcval(ctx, *_requestAnimationFrameFunc);
 	JS::RootedValue rval(ctx);
-	JS::AutoValueArray<1> argv(ctx);	
+	JS::AutoValueArray<2> argv(ctx);	
 	argv[0].setDouble(deltaTime);
+	argv[1].setDouble(timestamp); // predicted presentation time, ms
 	_requestAnimationFrameFunc->setNull();
 	JS_CallFunctionValue(ctx, global, funcval, argv, &rval);
 	return rval.toBoolean();
@@ -461,6 +591,15 @@ bool Core::fireTouchEvent(SDL_TouchID id, int x, int y, int eventType)
 		return JS_CallFunctionValue(ctx, global, *_touchMoveCallback, argv, &rval);
 }
 
+bool Core::fireVisibilityEvent(JS::PersistentRootedValue* callback)
+{
+	if (!callback || callback->isNullOrUndefined()) return false;
+	auto ctx = ScriptCore::getInstance()->getGlobalContext();
+	auto global = ScriptCore::getInstance()->getGlobalObject();
+	JS::RootedValue rval(ctx);
+	return JS_CallFunctionValue(ctx, global, *callback, JS::HandleValueArray::empty(), &rval);
+}
+
 bool Core::js_setTimeout(JSContext* ctx, unsigned argc, JS::Value * vp)
 {
 	JS_BEGIN_ARG;
@@ -526,4 +665,43 @@ bool Core::js_loadFont(JSContext* ctx, unsigned argc, JS::Value * vp)
 	JS_RETURN;
 }
 
+// prepareText(font, texts) lays out and rasterises the texts' fills in the background
+bool Core::js_prepareText(JSContext* ctx, unsigned argc, JS::Value * vp)
+{
+	JS_BEGIN_ARG;
+	JS_STRING_ARG(fontdesc, 0);
+	JS_ROOT_OBJECT_ARG(textsObj, 1);
+	if (!fontdesc) return false;
+	if (!textsObj) JS_FAIL("Texts must be an array");
+	Font font;
+	if (!FontManager::getInstance()->parseFont(fontdesc, font)) JS_RETURN;
+	bool isarray = false;
+	JS_IsArrayObject(ctx, textsObj, &isarray);
+	if (!isarray) JS_FAIL("Texts must be an array");
+	uint32_t length = 0;
+	JS_GetArrayLength(ctx, textsObj, &length);
+	std::vector<std::string> texts;
+	JS::RootedValue v(ctx);
+	for (uint32_t i = 0; i < length; i++) {
+		if (!JS_GetElement(ctx, textsObj, i, &v)) return false;
+		if (!v.isString()) continue;
+		JS::RootedString str(ctx, v.toString());
+		JSAutoByteString jsautostr;
+		char* text = jsautostr.encodeUtf8(ctx, str);
+		if (!text) return false;
+		texts.push_back(text);
+	}
+	FontManager::getInstance()->prepareText(font, texts);
+	JS_RETURN;
+}
+
+// distanceFieldText(enable) draws texts from distance field atlases scaled to any size
+bool Core::js_distanceFieldText(JSContext* ctx, unsigned argc, JS::Value * vp)
+{
+	JS_BEGIN_ARG;
+	JS_BOOL_ARG(enable, 0);
+	FontManager::getInstance()->setDistanceFieldText(enable);
+	JS_RETURN;
+}
+
 NS_REK_END
\ No newline at end of file
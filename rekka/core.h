@@ -2,6 +2,7 @@
 
 #include "rekka.h"
 #include "system/local_storage.h"
+#include "frame_pacer.h"
 
 NS_REK_BEGIN
 
@@ -36,6 +37,8 @@ public:
 
 	static bool js_performanceNow(JSContext* ctx, unsigned argc, JS::Value* vp);
 	static bool js_loadFont(JSContext* ctx, unsigned argc, JS::Value* vp);
+	static bool js_prepareText(JSContext* ctx, unsigned argc, JS::Value* vp);
+	static bool js_distanceFieldText(JSContext* ctx, unsigned argc, JS::Value* vp);
 private:
 	bool initManifest();
 	void setAppName(const char* appName);
@@ -49,15 +52,24 @@ private:
 	JS::PersistentRootedValue* _touchStartCallback;
 	JS::PersistentRootedValue* _touchEndCallback;
 	JS::PersistentRootedValue* _touchMoveCallback;
-	bool fireRequestAnimationFrame(float deltaTime);
+	JS::PersistentRootedValue* _pauseCallback;
+	JS::PersistentRootedValue* _resumeCallback;
+	bool fireRequestAnimationFrame(float deltaTime, double timestamp);
 	bool fireMouseMove(int x, int y);
 	bool fireMouseClick(int button, int x, int y, bool isdown);
 	bool fireKeyboard(int key, int mod, bool isdown);
 	bool fireTouchEvent(SDL_TouchID id, int x, int y, int eventType);
+	bool fireVisibilityEvent(JS::PersistentRootedValue* callback);
+	bool handleEvent(const SDL_Event& event);
 private:
 	bool _paused;
+	double _pausedTimerTime;
+	bool _backgroundAudio;
+	bool _tracing;
+	bool _showStats;
 	int _taskGarbageCollection;
 	LocalStorage _localStorage;
+	FramePacer _framePacer;
 	// ƶ豸innerWidth/innerHeightΪ豸ߴ
 	// ϵͳڻʱΪڳߴ
 	int _innerWidth;
@@ -0,0 +1,170 @@
+#include "frame_pacer.h"
+#include <math.h>
+
+NS_REK_BEGIN
+
+// SDL_Delay may oversleep by about a scheduler tick, spin the last ms
+#define SLEEP_MARGIN_MS 2
+// pacing of frames that presented nothing when there is no target rate
+#define IDLE_FRAME_RATE 60
+// how fast the predicted timestamps follow the wall clock drift
+#define TIMESTAMP_CORRECTION 0.05
+
+FramePacer::FramePacer()
+: _mode(kFramePacingVsync), _frameRate(0), _refreshRate(60), _frameInterval(0), _frameTicks(0), _nextDeadline(0),
+_frameTimestamp(0), _deltaTime(0), _lastBeginTime(0),
+_statsFrames(0), _statsSum(0), _statsSquareSum(0), _statsMax(0)
+{
+	_tickToMs = 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void FramePacer::setMode(FramePacingMode mode, int frameRate)
+{
+	_mode = mode;
+	_frameRate = frameRate;
+}
+
+void FramePacer::apply(SDL_Window* window)
+{
+	SDL_DisplayMode displayMode;
+	if (SDL_GetWindowDisplayMode(window, &displayMode) == 0 && displayMode.refresh_rate > 0) {
+		_refreshRate = displayMode.refresh_rate;
+	}
+#ifdef SINGLE_BUFFERED
+	if (_mode == kFramePacingVsync || _mode == kFramePacingAdaptiveVsync) {
+		SDL_Log("Vsync is not available when single buffered, use the frame limiter");
+		_mode = kFramePacingLimiter;
+	}
+#endif
+	int swapInterval = 0;
+	if (_mode == kFramePacingVsync) {
+		// e.g. 30fps at 60Hz, swap every 2nd vertical blank
+		swapInterval = _frameRate > 0 && _frameRate < _refreshRate ? _refreshRate / _frameRate : 1;
+	}
+	else if (_mode == kFramePacingAdaptiveVsync) {
+		swapInterval = -1;
+	}
+	if (swapInterval != 0) {
+		if (SDL_GL_SetSwapInterval(swapInterval) != 0) {
+			if (swapInterval < 0 && SDL_GL_SetSwapInterval(1) == 0) {
+				SDL_Log("Adaptive vsync is not supported, use vsync");
+				_mode = kFramePacingVsync;
+				swapInterval = 1;
+			}
+			else {
+				SDL_LogError(0, "Unable to set swap interval %d: %s, use the frame limiter", swapInterval, SDL_GetError());
+				_mode = kFramePacingLimiter;
+				swapInterval = 0;
+			}
+		}
+	}
+#if !defined(SINGLE_BUFFERED)
+	if (swapInterval == 0) SDL_GL_SetSwapInterval(0);
+#endif
+
+	int rate = 0;
+	switch (_mode) {
+	case kFramePacingVsync:
+		rate = _refreshRate / swapInterval;
+		break;
+	case kFramePacingAdaptiveVsync:
+		rate = _refreshRate;
+		break;
+	case kFramePacingLimiter:
+		rate = _frameRate > 0 ? _frameRate : _refreshRate;
+		break;
+	default:
+		break;
+	}
+	_frameInterval = rate > 0 ? 1000.0 / rate : 0;
+	_frameTicks = rate > 0 ? SDL_GetPerformanceFrequency() / rate : 0;
+	_nextDeadline = SDL_GetPerformanceCounter();
+	SDL_Log("Frame pacing: %s, %d fps", _framePacingMode_enum_names[_mode], rate);
+}
+
+double FramePacer::beginFrame()
+{
+	double now = SDL_GetPerformanceCounter() * _tickToMs;
+	if (_lastBeginTime > 0) {
+		double frameTime = now - _lastBeginTime;
+		_statsFrames++;
+		_statsSum += frameTime;
+		_statsSquareSum += frameTime * frameTime;
+		if (frameTime > _statsMax) _statsMax = frameTime;
+	}
+	_lastBeginTime = now;
+
+	double timestamp = now;
+	if (_frameInterval > 0 && _frameTimestamp > 0) {
+		// stay on the frame grid and follow the clock slowly, so wakeup and swap noise don't leak into animations
+		double frames = floor((now - _frameTimestamp) / _frameInterval + 0.5);
+		if (frames < 1) frames = 1;
+		double predicted = _frameTimestamp + frames * _frameInterval;
+		double error = now - predicted;
+		if (fabs(error) < _frameInterval) {
+			timestamp = predicted + error * TIMESTAMP_CORRECTION;
+		}
+	}
+	_deltaTime = _frameTimestamp > 0 ? timestamp - _frameTimestamp : _frameInterval;
+	_frameTimestamp = timestamp;
+	return timestamp;
+}
+
+void FramePacer::endFrame(bool presented)
+{
+	bool swapWaits = _mode == kFramePacingVsync || _mode == kFramePacingAdaptiveVsync;
+	if (presented && swapWaits) {
+		// SwapWindow has blocked until the vertical blank
+		_nextDeadline = SDL_GetPerformanceCounter();
+		return;
+	}
+	Uint64 ticks = _frameTicks;
+	if (ticks == 0) {
+		if (presented) return;
+		ticks = SDL_GetPerformanceFrequency() / IDLE_FRAME_RATE;
+	}
+	_nextDeadline += ticks;
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (_nextDeadline <= now) {
+		// running late, start over instead of rushing the following frames
+		_nextDeadline = now;
+		return;
+	}
+	waitUntil(_nextDeadline);
+}
+
+void FramePacer::reset()
+{
+	_frameTimestamp = 0;
+	_lastBeginTime = 0;
+	_nextDeadline = SDL_GetPerformanceCounter();
+}
+
+void FramePacer::waitUntil(Uint64 deadline)
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (now >= deadline) return;
+	Uint32 ms = (Uint32)((deadline - now) * _tickToMs);
+	if (ms > SLEEP_MARGIN_MS) SDL_Delay(ms - SLEEP_MARGIN_MS);
+	while (SDL_GetPerformanceCounter() < deadline) {
+		// spin
+	}
+}
+
+FrameTimeStats FramePacer::fetchStats()
+{
+	FrameTimeStats stats = { 0, 0, 0, 0 };
+	if (_statsFrames > 0) {
+		double average = _statsSum / _statsFrames;
+		double variance = _statsSquareSum / _statsFrames - average * average;
+		stats.fps = _statsSum > 0 ? _statsFrames * 1000.0 / _statsSum : 0;
+		stats.average = average;
+		stats.jitter = variance > 0 ? sqrt(variance) : 0;
+		stats.maximum = _statsMax;
+	}
+	_statsFrames = 0;
+	_statsSum = _statsSquareSum = _statsMax = 0;
+	return stats;
+}
+
+NS_REK_END
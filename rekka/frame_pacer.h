@@ -0,0 +1,70 @@
+#pragma once
+
+#include "rekka.h"
+
+NS_REK_BEGIN
+
+typedef enum {
+	kFramePacingNone = 0,		// no throttle, run as fast as possible
+	kFramePacingVsync,			// wait for the vertical blank in SwapWindow
+	kFramePacingAdaptiveVsync,	// late swap tearing, swap interval -1
+	kFramePacingLimiter			// software limiter, sleep + spin
+} FramePacingMode;
+static const char *_framePacingMode_enum_names[] = {
+	"none",
+	"vsync",
+	"adaptive",
+	"limiter",
+	nullptr
+};
+
+struct FrameTimeStats {
+	float fps;
+	float average;	// ms
+	float jitter;	// standard deviation of frame times, ms
+	float maximum;	// ms
+};
+
+class FramePacer {
+public:
+	FramePacer();
+	// configure before apply(), frameRate <= 0 means the display refresh rate
+	void setMode(FramePacingMode mode, int frameRate);
+	// apply swap interval, requires a current GL context
+	void apply(SDL_Window* window);
+
+	// returns the predicted timestamp (ms) of the frame to be rendered
+	double beginFrame();
+	// throttle until the next frame is due, presented is false when nothing was flipped
+	void endFrame(bool presented);
+	// restart the frame grid, e.g. after being paused
+	void reset();
+
+	double getFrameTimestamp() const { return _frameTimestamp; }
+	// ms between the last two predicted timestamps
+	double getDeltaTime() const { return _deltaTime; }
+	FramePacingMode getMode() const { return _mode; }
+	// fetch frame time statistics since the last call
+	FrameTimeStats fetchStats();
+private:
+	void waitUntil(Uint64 deadline);
+private:
+	FramePacingMode _mode;
+	int _frameRate;
+	int _refreshRate;
+	double _frameInterval;	// ms
+	Uint64 _frameTicks;		// SDL_GetPerformanceCounter ticks of a frame
+	Uint64 _nextDeadline;
+	double _tickToMs;
+
+	double _frameTimestamp;
+	double _deltaTime;
+	double _lastBeginTime;
+	// accumulated for fetchStats
+	int _statsFrames;
+	double _statsSum;
+	double _statsSquareSum;
+	double _statsMax;
+};
+
+NS_REK_END
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "rekka.h"
+#include "script_core.h"
+#include <unordered_map>
+
+NS_REK_BEGIN
+
+// Maps string values assigned from JS to their parsed form, e.g. "#ff0000" to a color.
+// Looked up by JSString pointer first, literals are atoms and share one pointer,
+// then by the Latin-1 chars, so nothing is transcoded or parsed twice.
+// Pointers are forgotten at every GC since the strings may die and their cells be reused.
+template <typename T>
+class JSStringCache {
+public:
+	JSStringCache(size_t capacity = 256) : _capacity(capacity), _gcNumber(0), _keyValid(false) {}
+
+	// the cached value of str, nullptr on a miss
+	const T* find(JSContext* ctx, JSString* str)
+	{
+		uint32_t gcNumber = ScriptCore::getInstance()->getGCNumber();
+		if (gcNumber != _gcNumber) {
+			_byString.clear();
+			_gcNumber = gcNumber;
+		}
+		auto itr = _byString.find(str);
+		if (itr != _byString.end()) return &itr->second->second;
+
+		_keyValid = false;
+		if (!JS_StringHasLatin1Chars(str)) return nullptr;
+		JSFlatString* flat = JS_FlattenString(ctx, str);
+		if (!flat) return nullptr;
+		{
+			JS::AutoCheckCannotGC nogc;
+			const JS::Latin1Char* chars = JS_GetLatin1FlatStringChars(nogc, flat);
+			_key.assign((const char*)chars, JS_GetStringLength(str));
+		}
+		_keyValid = true;
+		auto vitr = _values.find(_key);
+		if (vitr == _values.end()) return nullptr;
+		_byString[str] = &*vitr;
+		return &vitr->second;
+	}
+	// cache the parsed value of str after find() missed it
+	void insert(JSString* str, const T& value)
+	{
+		if (!_keyValid) return;
+		if (_values.size() >= _capacity) {
+			_values.clear();
+			_byString.clear();
+		}
+		auto res = _values.emplace(_key, value);
+		_byString[str] = &*res.first;
+		_keyValid = false;
+	}
+	void clear()
+	{
+		_values.clear();
+		_byString.clear();
+		_keyValid = false;
+	}
+private:
+	typedef std::unordered_map<std::string, T> ValueMap;
+	ValueMap _values;
+	// element pointers of an unordered_map stay valid on rehash
+	std::unordered_map<JSString*, typename ValueMap::value_type*> _byString;
+	size_t _capacity;
+	uint32_t _gcNumber;
+	std::string _key;	// chars of the last miss
+	bool _keyValid;
+};
+
+NS_REK_END
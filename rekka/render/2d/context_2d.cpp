@@ -3,37 +3,66 @@
 #include "render/image.h"
 #include "render/canvas.h"
 #include "render/extra.h"
+#include "path_2d.h"
+#include "js_string_cache.h"
+#include <cmath>
 
 NS_REK_BEGIN
 
 static JSClass context2d_class = {
-	"CanvasContext2D", JSCLASS_HAS_PRIVATE,
+	"CanvasContext2D", JSCLASS_HAS_PRIVATE | JSCLASS_IS_DOMJSCLASS | JSCLASS_HAS_RESERVED_SLOTS(1),
 	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr
 };
+
+// the hottest bindings are JIT-info natives
+static const JSJitInfo::ArgType context2d_no_args[] = { JSJitInfo::ArgTypeListEnd };
+static const JSJitInfo::ArgType context2d_numeric_args[] = {
+	JSJitInfo::Numeric, JSJitInfo::Numeric, JSJitInfo::Numeric, JSJitInfo::Numeric, JSJitInfo::Numeric, JSJitInfo::Numeric,
+	JSJitInfo::ArgTypeListEnd
+};
+static const JSJitInfo::ArgType context2d_image_args[] = {
+	JSJitInfo::Object, JSJitInfo::Numeric, JSJitInfo::Numeric, JSJitInfo::Numeric, JSJitInfo::Numeric,
+	JSJitInfo::Numeric, JSJitInfo::Numeric, JSJitInfo::Numeric, JSJitInfo::Numeric,
+	JSJitInfo::ArgTypeListEnd
+};
+static const JSTypedMethodJitInfo save_jitinfo = JS_JIT_METHOD_INFO(CanvasContext2D, save, kDOMProtoCanvasContext2D, context2d_no_args);
+static const JSTypedMethodJitInfo restore_jitinfo = JS_JIT_METHOD_INFO(CanvasContext2D, restore, kDOMProtoCanvasContext2D, context2d_no_args);
+static const JSTypedMethodJitInfo setTransform_jitinfo = JS_JIT_METHOD_INFO(CanvasContext2D, setTransform, kDOMProtoCanvasContext2D, context2d_numeric_args);
+static const JSTypedMethodJitInfo drawImage_jitinfo = JS_JIT_METHOD_INFO(CanvasContext2D, drawImage, kDOMProtoCanvasContext2D, context2d_image_args);
+static const JSTypedMethodJitInfo clearRect_jitinfo = JS_JIT_METHOD_INFO(CanvasContext2D, clearRect, kDOMProtoCanvasContext2D, context2d_numeric_args);
+static const JSTypedMethodJitInfo fillRect_jitinfo = JS_JIT_METHOD_INFO(CanvasContext2D, fillRect, kDOMProtoCanvasContext2D, context2d_numeric_args);
+static const JSJitInfo globalAlpha_getterinfo = JS_JIT_GETTER_INFO(CanvasContext2D, globalAlpha, kDOMProtoCanvasContext2D, JSVAL_TYPE_DOUBLE);
+static const JSJitInfo globalAlpha_setterinfo = JS_JIT_SETTER_INFO(CanvasContext2D, globalAlpha, kDOMProtoCanvasContext2D);
+static const JSJitInfo fillStyle_setterinfo = JS_JIT_SETTER_INFO(CanvasContext2D, fillStyle, kDOMProtoCanvasContext2D);
+
 static JSPropertySpec context2d_properties[] = {
 	JS_PROP_DEF(CanvasContext2D, globalCompositeOperation),
-	JS_PROP_DEF(CanvasContext2D, globalAlpha),
-	JS_PROP_DEF(CanvasContext2D, fillStyle),
+	JS_JIT_PROP_DEF(globalAlpha, globalAlpha_getterinfo, globalAlpha_setterinfo),
+	JS_JIT_PROP_SET_DEF(CanvasContext2D, fillStyle, fillStyle_setterinfo),
 	JS_PROP_DEF(CanvasContext2D, strokeStyle),
 	JS_PROP_DEF(CanvasContext2D, lineWidth),
+	JS_PROP_DEF(CanvasContext2D, lineCap),
+	JS_PROP_DEF(CanvasContext2D, lineJoin),
+	JS_PROP_DEF(CanvasContext2D, miterLimit),
 	JS_PROP_DEF(CanvasContext2D, font),
 	JS_PROP_DEF(CanvasContext2D, textAlign),
 	JS_PROP_DEF(CanvasContext2D, textBaseline),
 	JS_PS_END
 };
 static JSFunctionSpec context2d_funcs[] = {
-	JS_FUNC_DEF(CanvasContext2D, save),
-	JS_FUNC_DEF(CanvasContext2D, restore),
+	JS_JIT_FUNC_DEF(save, save_jitinfo),
+	JS_JIT_FUNC_DEF(restore, restore_jitinfo),
 	JS_FUNC_DEF(CanvasContext2D, fillText),
 	JS_FUNC_DEF(CanvasContext2D, strokeText),
 	JS_FUNC_DEF(CanvasContext2D, measureText),
-	JS_FUNC_DEF(CanvasContext2D, setTransform),
+	JS_JIT_FUNC_DEF(setTransform, setTransform_jitinfo),
 	JS_FUNC_DEF(CanvasContext2D, rotate),
 	JS_FUNC_DEF(CanvasContext2D, scale),
 	JS_FUNC_DEF(CanvasContext2D, translate),
-	JS_FUNC_DEF(CanvasContext2D, drawImage),
-	JS_FUNC_DEF(CanvasContext2D, clearRect),
-	JS_FUNC_DEF(CanvasContext2D, fillRect),
+	JS_JIT_FUNC_DEF(drawImage, drawImage_jitinfo),
+	JS_FUNC_DEF(CanvasContext2D, drawImages),
+	JS_JIT_FUNC_DEF(clearRect, clearRect_jitinfo),
+	JS_JIT_FUNC_DEF(fillRect, fillRect_jitinfo),
 	JS_FUNC_DEF(CanvasContext2D, strokeRect),
 	JS_FUNC_DEF(CanvasContext2D, createImageData),
 	JS_FUNC_DEF(CanvasContext2D, getImageData),
@@ -54,12 +83,15 @@ static JSFunctionSpec context2d_funcs[] = {
 	JS_FUNC_DEF(CanvasContext2D, createLinearGradient),
 	JS_FUNC_DEF(CanvasContext2D, createRadialGradient),
 	JS_FUNC_DEF(CanvasContext2D, tintImage),
+	JS_FUNC_DEF(CanvasContext2D, fillTextRuns),
+	JS_FUNC_DEF(CanvasContext2D, measureTextRuns),
 	JS_FS_END
 };
 
 
 #define PREPARE_IMAGE_OPERATION(context, image) \
 	context->checkTarget(); \
+	context->_blank = false; \
 	int op = context->_state->globalCompositeOperation; \
 	gpu::BlendFuncEnum src = (gpu::BlendFuncEnum)_compositeOperationFuncs[op].source; \
 	gpu::BlendFuncEnum dest = (gpu::BlendFuncEnum)_compositeOperationFuncs[op].destination; \
@@ -67,34 +99,66 @@ static JSFunctionSpec context2d_funcs[] = {
 		gpu::SetBlendFunction(image, src, dest, src, dest)
 #define PREPARE_FILL_OPERATION(context) \
 	context->checkTarget(); \
+	context->_blank = false; \
 	int op = context->_state->globalCompositeOperation; \
 	gpu::BlendFuncEnum src = (gpu::BlendFuncEnum)_compositeOperationFuncs[op].source; \
 	gpu::BlendFuncEnum dest = (gpu::BlendFuncEnum)_compositeOperationFuncs[op].destination; \
 	gpu::SetShapeBlendFunction(src, dest, src, dest)
 #define PREPARE_STROKE_OPERATION(context) \
 	context->checkTarget(); \
-	gpu::SetLineThickness(context->_state->lineWidth); \
+	context->_blank = false; \
 	int op = context->_state->globalCompositeOperation; \
 	gpu::BlendFuncEnum src = (gpu::BlendFuncEnum)_compositeOperationFuncs[op].source; \
 	gpu::BlendFuncEnum dest = (gpu::BlendFuncEnum)_compositeOperationFuncs[op].destination; \
 	gpu::SetShapeBlendFunction(src, dest, src, dest)
 #define PREPARE_TARGET(context) context->checkTarget()
+// parse results of the string-valued properties, a game uses only a few distinct values
+static JSStringCache<SDL_Color> s_colorCache;
+static JSStringCache<Font> s_fontCache;
+static int s_fontCacheFamilyCount = 0;	// a font loaded later may match a family list better
+static JSStringCache<int> s_compositeOperationCache(32);
+
+static SDL_Color parseColor(JSContext* ctx, JS::HandleString str)
+{
+	const SDL_Color* cached = s_colorCache.find(ctx, str);
+	if (cached) return *cached;
+	JSAutoByteString jsautostr;
+	char* colorstr = jsautostr.encodeUtf8(ctx, str);
+	SDL_Color color = HtmlColorToColor(colorstr ? colorstr : "");
+	s_colorCache.insert(str, color);
+	return color;
+}
+
 CanvasContext2D::CanvasContext2D(Canvas* canvas) : CanvasContext(canvas)
 {
 	Context2DState state;
+	_stateStack.reserve(8);
 	_stateStack.push_back(state);
 	_state = &_stateStack.back();	
+	_lastPathRect = { 0, 0, 0, 0 };
+	// a new target has full alpha and no clip
+	_dirty = 0;
+	_appliedAlpha = 1.0f;
+	_appliedClip = { 0, 0, 0, 0 };
+	_blank = true;
 }
 CanvasContext2D::~CanvasContext2D()
 {
 }
 
+// shared by all contexts, so call sites see one function per method and one shape
+static JS::PersistentRootedObject* s_context2dProto = nullptr;
 JSObject* CanvasContext2D::createObject(JSContext* ctx)
 {
-	JS::RootedObject robj(ctx, JS_NewObject(ctx, &context2d_class));
-	JS_DefineFunctions(ctx, robj, context2d_funcs);
-	JS_DefineProperties(ctx, robj, context2d_properties);
+	if (!s_context2dProto) {
+		s_context2dProto = new JS::PersistentRootedObject(ctx, JS_NewObject(ctx, nullptr));
+		JS_DefineFunctions(ctx, *s_context2dProto, context2d_funcs);
+		JS_DefineProperties(ctx, *s_context2dProto, context2d_properties);
+		ScriptCore::registerDOMClass(kDOMProtoCanvasContext2D, &context2d_class);
+	}
+	JS::RootedObject robj(ctx, JS_NewObjectWithGivenProto(ctx, &context2d_class, *s_context2dProto));
 	JS_SetPrivate(robj, this);
+	JS_SetReservedSlot(robj, 0, JS::PrivateValue(this));
 	return robj;
 }
 
@@ -106,31 +170,42 @@ JS_PROPGET_IMPL(CanvasContext2D, globalCompositeOperation)
 JS_PROPSET_IMPL(CanvasContext2D, globalCompositeOperation)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
-	JS_STRING_ARG(op, 0);
-	for (int idx = 0; _globalCompositeOperation_enum_names[idx]; ++idx) {
-		if (strcmp(_globalCompositeOperation_enum_names[idx], op) == 0) {
-			pthis->_state->globalCompositeOperation = (CompositeOperation)idx;
-			JS_RETURN;
+	JS::RootedString js_op(ctx, JS::ToString(ctx, args.get(0)));
+	if (!js_op) return false;
+	const int* cached = s_compositeOperationCache.find(ctx, js_op);
+	int found = cached ? *cached : -1;
+	if (!cached) {
+		JSAutoByteString jsautostr;
+		char* op = jsautostr.encodeUtf8(ctx, js_op);
+		for (int idx = 0; op && _globalCompositeOperation_enum_names[idx]; ++idx) {
+			if (strcmp(_globalCompositeOperation_enum_names[idx], op) == 0) {
+				found = idx;
+				break;
+			}
 		}
+		s_compositeOperationCache.insert(js_op, found);
 	}
+	if (found >= 0) pthis->writableState()->globalCompositeOperation = (CompositeOperation)found;
 	JS_RETURN;
 }
 
-JS_PROPGET_IMPL(CanvasContext2D, globalAlpha)
+JS_JIT_PROPGET_IMPL(CanvasContext2D, globalAlpha)
 {
-	JS_BEGIN_ARG_THIS(CanvasContext2D);
-	JS_RET(pthis->_state->globalAlpha);	
+	JS_BEGIN_JIT_ARG_THIS(CanvasContext2D);
+	args.rval().setDouble(pthis->_state->globalAlpha);
+	return true;
 }
 
-JS_PROPSET_IMPL(CanvasContext2D, globalAlpha)
+JS_JIT_PROPSET_IMPL(CanvasContext2D, globalAlpha)
 {
-	JS_BEGIN_ARG_THIS(CanvasContext2D);
-	JS_DOUBLE_ARG(alpha, 0);	
-	if (pthis->_target && pthis->_state->globalAlpha != alpha) {
-		gpu::SetTargetRGBA(pthis->_target, 0xff, 0xff, 0xff, std::min<int>(255, std::max<int>(alpha * 255, 0)));
+	JS_BEGIN_JIT_ARG_THIS(CanvasContext2D);
+	double alpha = 0;
+	if (!JS::ToNumber(ctx, args[0], &alpha)) return false;
+	if (pthis->_state->globalAlpha != alpha) {
+		pthis->writableState()->globalAlpha = alpha;
+		pthis->_dirty |= kDirtyAlpha;
 	}
-	pthis->_state->globalAlpha = alpha;	
-	JS_RETURN;
+	return true;
 }
 
 JS_PROPGET_IMPL(CanvasContext2D, fillStyle)
@@ -142,22 +217,23 @@ JS_PROPGET_IMPL(CanvasContext2D, fillStyle)
 	JS_RET(ColorToHtmlColor(pthis->_state->fillColor));	
 }
 
-JS_PROPSET_IMPL(CanvasContext2D, fillStyle)
+JS_JIT_PROPSET_IMPL(CanvasContext2D, fillStyle)
 {
-	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_BEGIN_JIT_ARG_THIS(CanvasContext2D);
 	if (args[0].isString()) {
-		JS_STRING_ARG(fillstyle, 0);
-		pthis->_state->fillColor = HtmlColorToColor(fillstyle);
-		pthis->_state->fillObject = nullptr;
+		JS::RootedString js_fillstyle(ctx, args[0].toString());
+		auto state = pthis->writableState();
+		state->fillColor = parseColor(ctx, js_fillstyle);
+		state->fillObject = nullptr;
 	}
-	else {
-		JS_ROOT_OBJECT_ARG(obj, 0);
+	else if (args[0].isObject()) {
+		JS::RootedObject obj(ctx, &args[0].toObject());
 		if (FillObject::is_js_instance(obj)) {			
 			FillObject* fillobj = (FillObject*)JS_GetPrivate(obj);
-			pthis->_state->fillObject = fillobj;			
+			pthis->writableState()->fillObject = fillobj;			
 		}
 	}
-	JS_RETURN;
+	return true;
 }
 
 JS_PROPGET_IMPL(CanvasContext2D, strokeStyle)
@@ -173,15 +249,16 @@ JS_PROPSET_IMPL(CanvasContext2D, strokeStyle)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);	
 	if (args[0].isString()) {
-		JS_STRING_ARG(strokestyle, 0);
-		pthis->_state->strokeColor = HtmlColorToColor(strokestyle);
-		pthis->_state->strokeObject = nullptr;
+		JS::RootedString js_strokestyle(ctx, args[0].toString());
+		auto state = pthis->writableState();
+		state->strokeColor = parseColor(ctx, js_strokestyle);
+		state->strokeObject = nullptr;
 	}
 	else {
 		JS_ROOT_OBJECT_ARG(obj, 0);
 		if (FillObject::is_js_instance(obj)) {			
 			FillObject* fillobj = (FillObject*)JS_GetPrivate(obj);
-			pthis->_state->strokeObject = fillobj;	
+			pthis->writableState()->strokeObject = fillobj;	
 		}
 	}	
 	JS_RETURN;
@@ -197,20 +274,73 @@ JS_PROPSET_IMPL(CanvasContext2D, lineWidth)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
 	JS_DOUBLE_ARG(width, 0);
-	pthis->_state->lineWidth = width;
+	pthis->writableState()->lineWidth = width;
 	JS_RETURN;
 }
 
-JS_FUNC_IMPL(CanvasContext2D, setTransform)
+JS_PROPGET_IMPL(CanvasContext2D, lineCap)
+{
+	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_RET(_lineCap_enum_names[pthis->_state->lineCap]);
+}
+
+JS_PROPSET_IMPL(CanvasContext2D, lineCap)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_STRING_ARG(cap, 0);
+	for (int idx = 0; _lineCap_enum_names[idx]; ++idx) {
+		if (strcmp(_lineCap_enum_names[idx], cap) == 0) {
+			pthis->writableState()->lineCap = (LineCap)idx;
+			JS_RETURN;
+		}
+	}
+	JS_RETURN;
+}
+
+JS_PROPGET_IMPL(CanvasContext2D, lineJoin)
+{
+	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_RET(_lineJoin_enum_names[pthis->_state->lineJoin]);
+}
+
+JS_PROPSET_IMPL(CanvasContext2D, lineJoin)
+{
+	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_STRING_ARG(join, 0);
+	for (int idx = 0; _lineJoin_enum_names[idx]; ++idx) {
+		if (strcmp(_lineJoin_enum_names[idx], join) == 0) {
+			pthis->writableState()->lineJoin = (LineJoin)idx;
+			JS_RETURN;
+		}
+	}
+	JS_RETURN;
+}
+
+JS_PROPGET_IMPL(CanvasContext2D, miterLimit)
+{
+	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_RET(pthis->_state->miterLimit);
+}
+
+JS_PROPSET_IMPL(CanvasContext2D, miterLimit)
+{
+	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_DOUBLE_ARG(limit, 0);
+	// non-positive values are ignored as in browsers
+	if (limit > 0) pthis->writableState()->miterLimit = limit;
+	JS_RETURN;
+}
+
+JS_JIT_FUNC_IMPL(CanvasContext2D, setTransform)
+{
+	JS_BEGIN_JIT_ARG_THIS(CanvasContext2D);
 	JS_DOUBLE_ARG(a, 0);
 	JS_DOUBLE_ARG(b, 1);
 	JS_DOUBLE_ARG(c, 2);
 	JS_DOUBLE_ARG(d, 3);
 	JS_DOUBLE_ARG(tx, 4);
 	JS_DOUBLE_ARG(ty, 5);
-	pthis->_state->transform = gpu::AffineTransformMake(a, b, c, d, tx, ty);
+	pthis->writableState()->transform = gpu::AffineTransformMake(a, b, c, d, tx, ty);
 	JS_RETURN;
 }
 
@@ -218,7 +348,8 @@ JS_FUNC_IMPL(CanvasContext2D, rotate)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
 	JS_DOUBLE_ARG(r, 0);
-	pthis->_state->transform = gpu::AffineTransformRotate(&pthis->_state->transform, r);
+	auto state = pthis->writableState();
+	state->transform = gpu::AffineTransformRotate(&state->transform, r);
 	JS_RETURN;
 }
 
@@ -227,7 +358,8 @@ JS_FUNC_IMPL(CanvasContext2D, scale)
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
 	JS_DOUBLE_ARG(sx, 0);
 	JS_DOUBLE_ARG(sy, 1);
-	pthis->_state->transform = gpu::AffineTransformScale(&pthis->_state->transform, sx, sy);
+	auto state = pthis->writableState();
+	state->transform = gpu::AffineTransformScale(&state->transform, sx, sy);
 	JS_RETURN;
 }
 
@@ -236,13 +368,15 @@ JS_FUNC_IMPL(CanvasContext2D, translate)
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
 	JS_DOUBLE_ARG(tx, 0);
 	JS_DOUBLE_ARG(ty, 1);
-	pthis->_state->transform = gpu::AffineTransformTranslate(&pthis->_state->transform, tx, ty);
+	auto state = pthis->writableState();
+	state->transform = gpu::AffineTransformTranslate(&state->transform, tx, ty);
 	JS_RETURN;
 }
 
-JS_FUNC_IMPL(CanvasContext2D, drawImage)
+JS_JIT_FUNC_IMPL(CanvasContext2D, drawImage)
 {
-	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_BEGIN_JIT_ARG_THIS(CanvasContext2D);
+	unsigned argc = args.length();
 	JS_ROOT_OBJECT_ARG(obj, 0);
 	void* ptr = JS_GetPrivate(obj);
 	gpu::Image* image = nullptr;
@@ -250,10 +384,29 @@ JS_FUNC_IMPL(CanvasContext2D, drawImage)
 		image = ((Image*)ptr)->_texture;
 	}
 	else if (Canvas::is_js_instance(obj)) {
-		image = ((Canvas*)ptr)->_texture;
+		image = ((Canvas*)ptr)->getTexture();
 	}
 	if (!image) JS_RETURN;
 
+	if (Canvas::is_js_instance(obj) && (argc == 3 || argc == 9)) {
+		// canvas to canvas at 1:1 scale
+		Canvas* source = (Canvas*)ptr;
+		JS_DOUBLE_ARG(a1, 1);
+		JS_DOUBLE_ARG(a2, 2);
+		if (argc == 3) {
+			if (pthis->copyCanvasRect(source, 0, 0, image->w, image->h, a1, a2)) JS_RETURN;
+		}
+		else {
+			JS_DOUBLE_ARG(sw, 3);
+			JS_DOUBLE_ARG(sh, 4);
+			JS_DOUBLE_ARG(x, 5);
+			JS_DOUBLE_ARG(y, 6);
+			JS_DOUBLE_ARG(w, 7);
+			JS_DOUBLE_ARG(h, 8);
+			if (sw == w && sh == h && pthis->copyCanvasRect(source, a1, a2, w, h, x, y)) JS_RETURN;
+		}
+	}
+
 	PREPARE_IMAGE_OPERATION(pthis, image);	
 	if (argc == 3) { // drawImage(image, dx, dy)
 		JS_DOUBLE_ARG(x, 1);
@@ -285,19 +438,103 @@ JS_FUNC_IMPL(CanvasContext2D, drawImage)
 	JS_RETURN;
 }
 
+static gpu::Image* textureFromObject(JS::HandleObject obj)
+{
+	if (Image::is_js_instance(obj)) return ((Image*)JS_GetPrivate(obj))->_texture;
+	if (Canvas::is_js_instance(obj)) return ((Canvas*)JS_GetPrivate(obj))->getTexture();
+	return nullptr;
+}
+
+// the source index a record starts with, -1 unless it is finite and in range
+static inline int recordSource(float value, size_t count)
+{
+	if (!std::isfinite(value) || value < 0 || value >= count) return -1;
+	return (int)value;
+}
+
+// drawImages(image, records, count), records is a Float32Array of
+// [sx, sy, sw, sh, a, b, c, d, e, f, alpha] per sprite, drawn like
+// save(); transform(a, b, c, d, e, f); globalAlpha *= alpha; drawImage(image, sx, sy, sw, sh, 0, 0, sw, sh); restore();
+// drawImages([image, ...], records, count) prefixes every record with the index of its source
+JS_FUNC_IMPL(CanvasContext2D, drawImages)
+{
+	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_ROOT_OBJECT_ARG(obj, 0);
+	JS_ROOT_OBJECT_ARG(recordsObj, 1);
+	if (!obj) JS_FAIL("Invalid image");
+	if (!recordsObj) JS_FAIL("Records must be a Float32Array");
+	bool isarray = false;
+	JS_IsArrayObject(ctx, obj, &isarray);
+	// resolve the sources first, nothing may GC while the records are accessed
+	std::vector<gpu::Image*> images;
+	if (isarray) {
+		uint32_t length = 0;
+		JS_GetArrayLength(ctx, obj, &length);
+		images.resize(length, nullptr);
+		JS::RootedValue jsval(ctx);
+		JS::RootedObject source(ctx);
+		for (uint32_t i = 0; i < length; i++) {
+			if (!JS_GetElement(ctx, obj, i, &jsval) || !jsval.isObject()) continue;
+			source = &jsval.toObject();
+			images[i] = textureFromObject(source);
+		}
+	}
+	else {
+		gpu::Image* image = textureFromObject(obj);
+		if (!image) JS_RETURN;
+		images.push_back(image);
+	}
+	int maxCount = -1;
+	if (argc > 2) {
+		JS_INT_ARG(count, 2);
+		maxCount = count;
+	}
+	uint32_t length = 0;
+	bool isSharedMemory = false;
+	float* records = nullptr;
+	if (!JS_GetObjectAsFloat32Array(recordsObj, &length, &isSharedMemory, &records)) {
+		JS_FAIL("Records must be a Float32Array");
+	}
+	unsigned int recordSize = isarray ? BLIT_BATCH_RECORD_SIZE + 1 : BLIT_BATCH_RECORD_SIZE;
+	unsigned int count = length / recordSize;
+	if (maxCount >= 0 && (unsigned int)maxCount < count) count = maxCount;
+
+	if (!isarray) {
+		gpu::Image* image = images[0];
+		PREPARE_IMAGE_OPERATION(pthis, image);
+		gpu::BlitBatchA(image, pthis->_target, &pthis->_state->transform, count, records, recordSize);
+		JS_RETURN;
+	}
+	// consecutive records of the same source go in one batch
+	unsigned int start = 0;
+	while (start < count) {
+		int index = recordSource(records[start * recordSize], images.size());
+		unsigned int end = start + 1;
+		while (end < count && recordSource(records[end * recordSize], images.size()) == index) end++;
+		gpu::Image* image = index >= 0 ? images[index] : nullptr;
+		if (image) {
+			PREPARE_IMAGE_OPERATION(pthis, image);
+			gpu::BlitBatchA(image, pthis->_target, &pthis->_state->transform, end - start, records + start * recordSize + 1, recordSize);
+		}
+		start = end;
+	}
+	JS_RETURN;
+}
+
 void CanvasContext2D::clearRect(float x, float y, float w, float h)
 {
 	auto transform = &_state->transform;
 	if (IsAffineTransformIdentity(transform)) {
 		if (x == 0 && y == 0 && w == _target->w && h == _target->h) {			
 			gpu::ClearRGBA(_target, 0, 0, 0, 0);
+			if (_appliedClip.w <= 0 || _appliedClip.h <= 0) _blank = true;
 		}
 		else {			
 			gpu::SetClip(_target, x, y, w, h);
 			gpu::ClearRGBA(_target, 0, 0, 0, 0);
 			gpu::UnsetClip(_target);
-			if (_state->clipRect.w > 0 && _state->clipRect.h > 0) {
-				gpu::SetClipRect(_target, _state->clipRect);
+			if (_appliedClip.w > 0 && _appliedClip.h > 0) {
+				gpu::SetClipRect(_target, _appliedClip);
 			}
 		}
 	}
@@ -312,9 +549,9 @@ void CanvasContext2D::clearRect(float x, float y, float w, float h)
 	}
 }
 
-JS_FUNC_IMPL(CanvasContext2D, clearRect)
+JS_JIT_FUNC_IMPL(CanvasContext2D, clearRect)
 {
-	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_BEGIN_JIT_ARG_THIS(CanvasContext2D);
 	JS_DOUBLE_ARG(x, 0);
 	JS_DOUBLE_ARG(y, 1);
 	JS_DOUBLE_ARG(w, 2);
@@ -336,8 +573,8 @@ void CanvasContext2D::fillRect(float x, float y, float w, float h, const SDL_Col
 				gpu::SetClip(_target, x, y, w, h);
 				gpu::ClearColor(_target, color);
 				gpu::UnsetClip(_target);
-				if (_state->clipRect.w > 0 && _state->clipRect.h > 0) {
-					gpu::SetClipRect(_target, _state->clipRect);
+				if (_appliedClip.w > 0 && _appliedClip.h > 0) {
+					gpu::SetClipRect(_target, _appliedClip);
 				}
 			}
 		}
@@ -357,9 +594,9 @@ void CanvasContext2D::fillRect(float x, float y, float w, float h, const SDL_Col
 	}
 }
 
-JS_FUNC_IMPL(CanvasContext2D, fillRect)
+JS_JIT_FUNC_IMPL(CanvasContext2D, fillRect)
 {
-	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_BEGIN_JIT_ARG_THIS(CanvasContext2D);
 	JS_DOUBLE_ARG(x, 0);
 	JS_DOUBLE_ARG(y, 1);
 	JS_DOUBLE_ARG(w, 2);
@@ -396,11 +633,11 @@ JS_FUNC_IMPL(CanvasContext2D, strokeRect)
 	path.lineTo(x + w, y + h, transform);
 	path.lineTo(x, y + h, transform);
 	path.closePath();
-	if (pthis->_state->fillObject) {
-		path.stroke(pthis->_target, pthis->_state->strokeObject, transform);
+	if (pthis->_state->strokeObject) {
+		path.stroke(pthis->_target, pthis->_state->strokeObject, transform, pthis->strokeStyle(true));
 	}
 	else {
-		path.stroke(pthis->_target, pthis->_state->strokeColor);
+		path.stroke(pthis->_target, pthis->_state->strokeColor, pthis->strokeStyle(true));
 	}
 	JS_RETURN;
 }
@@ -432,7 +669,7 @@ JS_FUNC_IMPL(CanvasContext2D, getImageData)
 	JS_INT_ARG(w, 2);
 	JS_INT_ARG(h, 3);
 	PREPARE_TARGET(pthis);
-	if (x >= 0 && y >= 0 && w > 0 && h > 0 &&
+	if (pthis->_target && x >= 0 && y >= 0 && w > 0 && h > 0 &&
 		x + w <= pthis->_target->w && y + h <= pthis->_target->h) {
 		auto bufferarray = JS_NewUint8ClampedArray(ctx, w * h * 4);
 		uint8_t* data;
@@ -480,8 +717,11 @@ JS_FUNC_IMPL(CanvasContext2D, putImageData)
 	uint32_t length = 0;
 	bool isSharedMemory;
 	JS_GetObjectAsUint8ClampedArray(JS::ToObject(ctx, v), &length, &isSharedMemory, &data);	
+	gpu::Image* texture = pthis->_owner->getTexture();
+	if (!texture) JS_RETURN;
 	GPU_Rect rect = { x, y, width, height };
-	gpu::UpdateImageBytes(pthis->_owner->_texture, &rect, data, 4 * width);
+	gpu::UpdateImageBytes(texture, &rect, data, 4 * width);
+	pthis->_blank = false;
 	JS_RETURN;
 }
 
@@ -499,15 +739,47 @@ JS_FUNC_IMPL(CanvasContext2D, closePath)
 	JS_RETURN;
 }
 
+// the current path is in target space, so its line width is scaled by the transform
+StrokeStyle CanvasContext2D::strokeStyle(bool deviceSpace)
+{
+	const AffineTransform& t = _state->transform;
+	StrokeStyle style = { _state->lineWidth, _state->lineCap, _state->lineJoin, _state->miterLimit };
+	if (deviceSpace) style.width *= sqrtf(t.a * t.a + t.c * t.c);
+	return style;
+}
+
+// fill(path) and stroke(path) draw a Path2D instead of the current path
+static Path2D* path2DFromArgs(JSContext* ctx, const JS::CallArgs& args)
+{
+	if (args.length() > 0 && args[0].isObject()) {
+		JS::RootedObject obj(ctx, &args[0].toObject());
+		if (Path2D::is_js_instance(obj)) return (Path2D*)JS_GetPrivate(obj);
+	}
+	return nullptr;
+}
+
+static FillRule fillRuleFromArg(JSContext* ctx, JS::HandleValue arg)
+{
+	if (!arg.isString()) return kFillRuleNonZero;
+	JS::RootedString js_rule(ctx, arg.toString());
+	JSAutoByteString jsautostr;
+	char* rule = jsautostr.encodeUtf8(ctx, js_rule);
+	return rule && strcmp(rule, _fillRule_enum_names[kFillRuleEvenOdd]) == 0 ? kFillRuleEvenOdd : kFillRuleNonZero;
+}
+
 JS_FUNC_IMPL(CanvasContext2D, fill)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
 	PREPARE_FILL_OPERATION(pthis);
+	auto transform = &pthis->_state->transform;
+	Path2D* path2d = path2DFromArgs(ctx, args);
+	FillRule rule = fillRuleFromArg(ctx, args.get(path2d ? 1 : 0));
+	const FillMesh& mesh = path2d ? path2d->transformedFillMesh(transform, rule) : pthis->_path.getFillMesh(rule);
 	if (pthis->_state->fillObject) {
-		pthis->_path.fill(pthis->_target, pthis->_state->fillObject, &pthis->_state->transform);
+		Path::fillMesh(pthis->_target, mesh, pthis->_state->fillObject, transform);
 	}
 	else {
-		pthis->_path.fill(pthis->_target, pthis->_state->fillColor);
+		Path::fillMesh(pthis->_target, mesh, pthis->_state->fillColor);
 	}
 	JS_RETURN;
 }
@@ -516,11 +788,15 @@ JS_FUNC_IMPL(CanvasContext2D, stroke)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
 	PREPARE_STROKE_OPERATION(pthis);
+	auto transform = &pthis->_state->transform;
+	Path2D* path2d = path2DFromArgs(ctx, args);
+	const FillMesh& mesh = path2d ? path2d->transformedStrokeMesh(transform, pthis->strokeStyle(false)) :
+		pthis->_path.getStrokeMesh(pthis->strokeStyle(true));
 	if (pthis->_state->strokeObject) {
-		pthis->_path.stroke(pthis->_target, pthis->_state->strokeObject, &pthis->_state->transform);
+		Path::fillMesh(pthis->_target, mesh, pthis->_state->strokeObject, transform);
 	}
 	else {
-		pthis->_path.stroke(pthis->_target, pthis->_state->strokeColor);
+		Path::fillMesh(pthis->_target, mesh, pthis->_state->strokeColor);
 	}
 	JS_RETURN;
 }
@@ -612,7 +888,7 @@ JS_FUNC_IMPL(CanvasContext2D, rect)
 	if (IsAffineTransformAxisAligned(transform)) {
 		const auto& pt = gpu::PointApplyAffineTransform(x, y, transform);
 		const auto& size = gpu::SizeApplyAffineTransform(w, h, transform);
-		pthis->_state->lastPathRect = { pt.x, pt.y, size.x, size.y };
+		pthis->_lastPathRect = { pt.x, pt.y, size.x, size.y };
 	}
 	JS_RETURN;
 }
@@ -620,10 +896,10 @@ JS_FUNC_IMPL(CanvasContext2D, rect)
 JS_FUNC_IMPL(CanvasContext2D, clip)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
-	auto& rect = pthis->_state->lastPathRect;
+	auto& rect = pthis->_lastPathRect;
 	if (rect.w > 0 && rect.h > 0) { 
-		pthis->_state->clipRect = rect;
-		if (pthis->_target) gpu::SetClipRect(pthis->_target, rect);
+		pthis->writableState()->clipRect = rect;
+		pthis->_dirty |= kDirtyClip;
 	}
 	JS_RETURN;
 }
@@ -645,41 +921,28 @@ JS_PROPGET_IMPL(CanvasContext2D, font)
 	JS_RETURN;
 }
 
-// 	֧ "italic bold|bolder 12px|40pt arial, sans-serif"
 JS_PROPSET_IMPL(CanvasContext2D, font)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
-	JS_STRING_ARG(fontdesc, 0);		
-	std::vector<std::string> familyNames;	
-	bool italic = false;
-	bool bold = false;
-	float size = 0;
-	char *p = strtok(fontdesc, " ,");
-	while (p) {
-		if (strcasecmp(p, "italic") == 0) {
-			italic = true;
-		}
-		else if (strcasecmp(p, "bold") == 0 || strcasecmp(p, "bolder") == 0) {
-			bold = true;
-		}
-		else {
-			int ptx = 0; // intԷֹMSC
-			sscanf(p, "%fp%1[tx]", &size, (char *)&ptx);
-			if (size > 0 && (ptx == 't' || ptx == 'x')) {
-				if (ptx == 't') size = ceilf(size * 4.0 / 3.0);
-			}
-			else { // ٶ
-				familyNames.push_back(p);
-			}
-		}
-		p = strtok(0, " ,");
+	JS::RootedString js_fontdesc(ctx, JS::ToString(ctx, args.get(0)));
+	if (!js_fontdesc) return false;
+	int familyCount = FontManager::getInstance()->getFamilyCount();
+	if (familyCount != s_fontCacheFamilyCount) {
+		s_fontCache.clear();
+		s_fontCacheFamilyCount = familyCount;
+	}
+	const Font* cached = s_fontCache.find(ctx, js_fontdesc);
+	if (cached) {
+		pthis->writableState()->font = *cached;
+		JS_RETURN;
 	}
-	int fontId = FontManager::getInstance()->findFontId(familyNames);
-	if (fontId != -1) {		
-		pthis->_state->font.italic = italic;
-		pthis->_state->font.bold = bold;
-		pthis->_state->font.familyId = fontId;
-		pthis->_state->font.size = roundf(size);
+	JSAutoByteString jsautostr;
+	char* fontdesc = jsautostr.encodeUtf8(ctx, js_fontdesc);
+	if (!fontdesc) return false;
+	Font font;
+	if (FontManager::getInstance()->parseFont(fontdesc, font)) {
+		pthis->writableState()->font = font;
+		s_fontCache.insert(js_fontdesc, font);
 	}
 	JS_RETURN;
 }
@@ -696,7 +959,7 @@ JS_PROPSET_IMPL(CanvasContext2D, textAlign)
 	JS_STRING_ARG(align, 0);
 	for (int idx = 0; _textAlign_enum_names[idx]; ++idx) {
 		if (strcmp(_textAlign_enum_names[idx], align) == 0) {
-			pthis->_state->textAlign = (TextAlign)idx;
+			pthis->writableState()->textAlign = (TextAlign)idx;
 			JS_RETURN;
 		}
 	}
@@ -715,13 +978,134 @@ JS_PROPSET_IMPL(CanvasContext2D, textBaseline)
 	JS_STRING_ARG(baseline, 0);
 	for (int idx = 0; _textBaseline_enum_names[idx]; ++idx) {
 		if (strcmp(_textBaseline_enum_names[idx], baseline) == 0) {
-			pthis->_state->textBaseline = (TextBaseline)idx;
+			pthis->writableState()->textBaseline = (TextBaseline)idx;
 			JS_RETURN;
 		}
 	}
 	JS_RETURN;
 }
 
+// gradients are evaluated per pixel in user space, masked by the glyphs
+void CanvasContext2D::blitText(gpu::Image* image, float x, float y, FillObject* fillobj, const SDL_Color& color)
+{
+	Gradient* gradient = dynamic_cast<Gradient*>(fillobj);
+	if (gradient) {
+		if (!gradient->getLookupTexture()) return;
+		float x1 = -image->anchor_x + x;
+		float y1 = -image->anchor_y + y;
+		AffineTransform texCoordTransform = gpu::AffineTransformMake(image->texture_w, 0, 0, image->texture_h, x1, y1);
+		if (gradient->beginShader(texCoordTransform, true)) {
+			gpu::SetColor(image, { 0xff, 0xff, 0xff, 0xff });
+			gpu::BlitTransformA(image, nullptr, _target, x, y, &_state->transform);
+			Gradient::endShader();
+			return;
+		}
+		// colors at the corners only
+		GPU_Color colors[4];
+		float x2 = (image->w - image->anchor_x) + x;
+		float y2 = (image->h - image->anchor_y) + y;
+		colors[0] = Gradient::colorFunc(x1, y1, gradient);
+		colors[1] = Gradient::colorFunc(x2, y1, gradient);
+		colors[2] = Gradient::colorFunc(x2, y2, gradient);
+		colors[3] = Gradient::colorFunc(x1, y2, gradient);
+		gpu::BlitTransformAColor(image, _target, x, y, &_state->transform, colors);
+		return;
+	}
+	gpu::SetColor(image, color);
+	gpu::BlitTransformA(image, nullptr, _target, x, y, &_state->transform);
+}
+
+// scratch buffers of drawTextGlyphs
+static std::vector<TextQuad> s_textQuads;
+static std::vector<float> s_textRecords;
+
+bool CanvasContext2D::drawTextGlyphs(const char* text, float x, float y, bool stroke)
+{
+	// glyph quads may overlap, only source-over composes them like one image,
+	// fill objects are mapped over the whole text image.
+	// Bitmap fonts have no text image, they are drawn in the color of the style
+	auto fontmgr = FontManager::getInstance();
+	bool bitmap = fontmgr->bitmapFont(_state->font) != nullptr;
+	FillObject* fillobj = stroke ? _state->strokeObject : _state->fillObject;
+	if (!bitmap && (fillobj || _state->globalCompositeOperation != kCompositeOperationSourceOver)) return false;
+	if (!bitmap && fontmgr->isDistanceFieldText() && drawTextDistanceField(text, x, y, stroke)) return true;
+	bool laidOut = stroke ?
+		fontmgr->layoutText(text, _state->font, _state->textBaseline, _state->textAlign, s_textQuads,
+			_state->lineWidth, _state->lineCap, _state->lineJoin, _state->miterLimit) :
+		fontmgr->layoutText(text, _state->font, _state->textBaseline, _state->textAlign, s_textQuads);
+	if (!laidOut) return false;
+	blitTextQuads(x, y, stroke ? _state->strokeColor : _state->fillColor);
+	return true;
+}
+
+// outlines are stroked around the fill's glyphs with round joins, wider ones than
+// the field reaches are left to the stroke fonts
+bool CanvasContext2D::drawTextDistanceField(const char* text, float x, float y, bool stroke)
+{
+	const Font& font = _state->font;
+	float scale = (float)font.size / SDF_FONT_SIZE;
+	float halfWidth = stroke ? _state->lineWidth * 0.5f : 0;
+	if (font.size <= 0 || halfWidth > SDF_SPREAD * scale) return false;
+	// device pixels per field pixel
+	const AffineTransform& t = _state->transform;
+	float pixels = scale * sqrtf(fabsf(t.a * t.d - t.b * t.c));
+	if (pixels <= 0) return false;
+	if (!FontManager::getInstance()->layoutDistanceFieldText(text, font, _state->textBaseline, _state->textAlign, s_textQuads)) return false;
+	float unit = 1.0f / (SDF_SPREAD * 2);	// field value per field pixel
+	float band[2] = { 0.5f, 2.0f };
+	if (stroke) {
+		band[0] = 0.5f - halfWidth / scale * unit;
+		band[1] = 0.5f + halfWidth / scale * unit;
+	}
+	// ramps over one device pixel
+	if (!CanvasExtra::beginDistanceField(band, 0.5f * unit / pixels)) return false;
+	blitTextQuads(x, y, stroke ? _state->strokeColor : _state->fillColor);
+	CanvasExtra::endDistanceField();
+	return true;
+}
+
+void CanvasContext2D::blitTextQuads(float x, float y, const SDL_Color& color)
+{
+	s_textRecords.resize(s_textQuads.size() * BLIT_BATCH_RECORD_SIZE);
+	for (size_t i = 0; i < s_textQuads.size(); i++) {
+		const TextQuad& quad = s_textQuads[i];
+		float* record = &s_textRecords[i * BLIT_BATCH_RECORD_SIZE];
+		record[0] = quad.rect.x;
+		record[1] = quad.rect.y;
+		record[2] = quad.rect.w;
+		record[3] = quad.rect.h;
+		record[4] = quad.scale; record[5] = 0; record[6] = 0; record[7] = quad.scale;
+		record[8] = x + quad.x;
+		record[9] = y + quad.y;
+		record[10] = 1;
+	}
+	// consecutive glyphs of the same page in one batch
+	size_t start = 0;
+	while (start < s_textQuads.size()) {
+		gpu::Image* page = s_textQuads[start].page;
+		size_t end = start + 1;
+		while (end < s_textQuads.size() && s_textQuads[end].page == page) end++;
+		PREPARE_IMAGE_OPERATION(this, page);
+		gpu::SetColor(page, color);
+		gpu::BlitBatchA(page, _target, &_state->transform, end - start, &s_textRecords[start * BLIT_BATCH_RECORD_SIZE], BLIT_BATCH_RECORD_SIZE);
+		start = end;
+	}
+}
+
+bool CanvasContext2D::drawText(const char* text, float x, float y, bool stroke)
+{
+	if (drawTextGlyphs(text, x, y, stroke)) return true;
+	auto image = stroke ?
+		FontManager::getInstance()->drawText(text, true, _state->font, _state->textBaseline, _state->textAlign,
+			_state->lineWidth, _state->lineCap, _state->lineJoin, _state->miterLimit) :
+		FontManager::getInstance()->drawText(text, true, _state->font, _state->textBaseline, _state->textAlign);
+	if (image == nullptr) return false;
+	PREPARE_IMAGE_OPERATION(this, image);
+	if (stroke) blitText(image, x, y, _state->strokeObject, _state->strokeColor);
+	else blitText(image, x, y, _state->fillObject, _state->fillColor);
+	return true;
+}
+
 JS_FUNC_IMPL(CanvasContext2D, fillText)
 {	
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
@@ -729,37 +1113,7 @@ JS_FUNC_IMPL(CanvasContext2D, fillText)
 	if (text[0] == 0) JS_RETURN;
 	JS_DOUBLE_ARG(x, 1);
 	JS_DOUBLE_ARG(y, 2);
-	auto& state = pthis->_state;	
-	auto image = FontManager::getInstance()->drawText(text, pthis->_isOffscreen, state->font,
-		state->textBaseline, state->textAlign);	
-	if (image == nullptr) JS_FAIL("Failed to render the text \"%s\"", text);
-
-	PREPARE_IMAGE_OPERATION(pthis, image);
-	auto fillobj = pthis->_state->fillObject;
-	gpu::ColorCallback colorfunc = nullptr;
-	if (fillobj && dynamic_cast<Pattern*>(fillobj) == nullptr) {
-		if (dynamic_cast<LinearGradient*>(fillobj) != nullptr)
-			colorfunc = LinearGradient::colorFunc;
-		else if (dynamic_cast<RadialGradient*>(fillobj))
-			colorfunc = RadialGradient::colorFunc;
-	}
-	if (colorfunc) {
-		GPU_Color colors[4];
-		float x1 = -image->anchor_x + x;
-		float y1 = -image->anchor_y + y;
-		float x2 = (image->w - image->anchor_x) + x;
-		float y2 = (image->h - image->anchor_y) + y;
-		colors[0] = colorfunc(x1, y1, fillobj);
-		colors[1] = colorfunc(x2, y1, fillobj);
-		colors[2] = colorfunc(x2, y2, fillobj);
-		colors[3] = colorfunc(x1, y2, fillobj);
-		gpu::BlitTransformAColor(image, pthis->_target, x, y, &state->transform, colors);
-	}
-	else {
-		gpu::SetColor(image, state->fillColor);
-		gpu::BlitTransformA(image, nullptr, pthis->_target, x, y, &state->transform);		
-	}
-	if (pthis->_isOffscreen) gpu::FreeImage(image);
+	if (!pthis->drawText(text, x, y, false)) JS_FAIL("Failed to render the text \"%s\"", text);
 	JS_RETURN;
 }
 
@@ -770,38 +1124,7 @@ JS_FUNC_IMPL(CanvasContext2D, strokeText)
 	if (text[0] == 0) JS_RETURN;
 	JS_DOUBLE_ARG(x, 1);
 	JS_DOUBLE_ARG(y, 2);
-	auto& state = pthis->_state;
-	auto image = FontManager::getInstance()->drawText(text, pthis->_isOffscreen, state->font,
-		state->textBaseline, state->textAlign,
-		state->lineWidth, state->lineCap, state->lineJoin, state->miterLimit);
-	if (image == nullptr) JS_FAIL("Failed to stroke the text \"%s\"", text);
-
-	PREPARE_IMAGE_OPERATION(pthis, image);
-	auto fillobj = pthis->_state->strokeObject;
-	gpu::ColorCallback colorfunc = nullptr;
-	if (fillobj && dynamic_cast<Pattern*>(fillobj) == nullptr) {
-		if (dynamic_cast<LinearGradient*>(fillobj) != nullptr)
-			colorfunc = LinearGradient::colorFunc;
-		else if (dynamic_cast<RadialGradient*>(fillobj))
-			colorfunc = RadialGradient::colorFunc;
-	}
-	if (colorfunc) {
-		GPU_Color colors[4];
-		float x1 = -image->anchor_x + x;
-		float y1 = -image->anchor_y + y;
-		float x2 = (image->w - image->anchor_x) + x;
-		float y2 = (image->h - image->anchor_y) + y;
-		colors[0] = colorfunc(x1, y1, fillobj);
-		colors[1] = colorfunc(x2, y1, fillobj);
-		colors[2] = colorfunc(x2, y2, fillobj);
-		colors[3] = colorfunc(x1, y2, fillobj);
-		gpu::BlitTransformAColor(image, pthis->_target, x, y, &state->transform, colors);
-	}
-	else {
-		gpu::SetColor(image, state->strokeColor);
-		gpu::BlitTransformA(image, nullptr, pthis->_target, x, y, &state->transform);
-	}
-	if (pthis->_isOffscreen) gpu::FreeImage(image);	
+	if (!pthis->drawText(text, x, y, true)) JS_FAIL("Failed to stroke the text \"%s\"", text);
 	JS_RETURN;
 }
 
@@ -817,6 +1140,212 @@ JS_FUNC_IMPL(CanvasContext2D, measureText)
 	JS_RET(result);	
 }
 
+// styled runs of fillTextRuns and measureTextRuns, parsed before anything is drawn
+struct TextRun {
+	std::string text;
+	int size;				// px, 0 for the current font
+	bool hasColor;			// otherwise the fill style
+	SDL_Color color;
+	float outlineWidth;		// stroked under the fill when > 0
+	SDL_Color outlineColor;
+	gpu::Image* image;		// icon runs
+	GPU_Rect iconRect;
+	float iconWidth, iconHeight;
+	float iconY;			// from the text position
+};
+
+static bool numberProperty(JSContext* ctx, JS::HandleObject obj, const char* name, double& value)
+{
+	JS::RootedValue v(ctx);
+	if (!JS_GetProperty(ctx, obj, name, &v) || !v.isNumber()) return false;
+	value = v.toNumber();
+	return true;
+}
+
+static bool colorProperty(JSContext* ctx, JS::HandleObject obj, const char* name, SDL_Color& color)
+{
+	JS::RootedValue v(ctx);
+	if (!JS_GetProperty(ctx, obj, name, &v) || !v.isString()) return false;
+	JS::RootedString str(ctx, v.toString());
+	color = parseColor(ctx, str);
+	return true;
+}
+
+// runs is an array of strings and objects of
+// { text, color, size, outlineColor, outlineWidth } or { image, sx, sy, sw, sh, width, height, y },
+// into runs owned by the call, property getters may call back into the runs functions
+static bool parseTextRuns(JSContext* ctx, JS::HandleObject runsObj, std::vector<TextRun>& runs)
+{
+	bool isarray = false;
+	JS_IsArrayObject(ctx, runsObj, &isarray);
+	if (!isarray) return false;
+	uint32_t length = 0;
+	JS_GetArrayLength(ctx, runsObj, &length);
+	runs.resize(length);
+	JS::RootedValue v(ctx);
+	JS::RootedObject run(ctx);
+	JS::RootedString str(ctx);
+	for (uint32_t i = 0; i < length; i++) {
+		TextRun& r = runs[i];
+		r.text.clear();
+		r.size = 0;
+		r.hasColor = false;
+		r.outlineWidth = 0;
+		r.image = nullptr;
+		if (!JS_GetElement(ctx, runsObj, i, &v)) return false;
+		if (v.isString()) {
+			str = v.toString();
+		}
+		else if (v.isObject()) {
+			run = &v.toObject();
+			if (!JS_GetProperty(ctx, run, "image", &v)) return false;
+			if (v.isObject()) {
+				JS::RootedObject source(ctx, &v.toObject());
+				r.image = textureFromObject(source);
+				if (!r.image) continue;
+				double sx = 0, sy = 0, sw = r.image->w, sh = r.image->h;
+				numberProperty(ctx, run, "sx", sx);
+				numberProperty(ctx, run, "sy", sy);
+				numberProperty(ctx, run, "sw", sw);
+				numberProperty(ctx, run, "sh", sh);
+				double w = sw, h = sh, y = 0;
+				numberProperty(ctx, run, "width", w);
+				numberProperty(ctx, run, "height", h);
+				numberProperty(ctx, run, "y", y);
+				r.iconRect = { (float)sx, (float)sy, (float)sw, (float)sh };
+				r.iconWidth = w;
+				r.iconHeight = h;
+				r.iconY = y;
+				continue;
+			}
+			if (!JS_GetProperty(ctx, run, "text", &v)) return false;
+			str = v.isString() ? v.toString() : nullptr;
+			double value;
+			if (numberProperty(ctx, run, "size", value)) r.size = value;
+			r.hasColor = colorProperty(ctx, run, "color", r.color);
+			if (numberProperty(ctx, run, "outlineWidth", value) && colorProperty(ctx, run, "outlineColor", r.outlineColor)) {
+				r.outlineWidth = value;
+			}
+		}
+		else continue;
+		if (!str) continue;
+		JSAutoByteString jsautostr;
+		char* text = jsautostr.encodeUtf8(ctx, str);
+		if (!text) return false;
+		r.text = text;
+	}
+	return true;
+}
+
+static JSObject* textRunMetrics(JSContext* ctx, const std::vector<float>& advances)
+{
+	JS::RootedObject result(ctx, JS_NewObject(ctx, nullptr));
+	JS::RootedObject array(ctx, JS_NewArrayObject(ctx, advances.size()));
+	if (!result || !array) return nullptr;
+	float width = 0;
+	for (size_t i = 0; i < advances.size(); i++) {
+		JS_SetElement(ctx, array, i, advances[i]);
+		width += advances[i];
+	}
+	JS::RootedValue v(ctx);
+	v.setDouble(width);
+	JS_SetProperty(ctx, result, "width", v);
+	v.setObject(*array);
+	JS_SetProperty(ctx, result, "advances", v);
+	return result;
+}
+
+// lays the parsed runs out left to right from x, on the baseline of the current textBaseline
+void CanvasContext2D::drawTextRuns(const std::vector<TextRun>& runs, float x, float y, bool draw, std::vector<float>& advances)
+{
+	advances.resize(runs.size());
+	auto fontmgr = FontManager::getInstance();
+	// the runs are drawn with the state changed in place, then it is put back,
+	// measuring only reads it
+	Context2DState* state = draw ? writableState() : _state;
+	Font font = state->font;
+	Font runFont = font;
+	TextAlign textAlign = state->textAlign;
+	SDL_Color fillColor = state->fillColor;
+	FillObject* fillObject = state->fillObject;
+	SDL_Color strokeColor = state->strokeColor;
+	FillObject* strokeObject = state->strokeObject;
+	float lineWidth = state->lineWidth;
+	if (draw) state->textAlign = kTextAlignLeft;
+	float pen = x;
+	for (size_t i = 0; i < runs.size(); i++) {
+		const TextRun& run = runs[i];
+		advances[i] = 0;
+		if (run.image) {
+			if (draw && run.iconRect.w > 0 && run.iconRect.h > 0) {
+				PREPARE_IMAGE_OPERATION(this, run.image);
+				gpu::BlitTransformAScale(run.image, (GPU_Rect*)&run.iconRect, _target, pen, y + run.iconY, &state->transform,
+					run.iconWidth / run.iconRect.w, run.iconHeight / run.iconRect.h);
+			}
+			advances[i] = run.iconWidth;
+			pen += run.iconWidth;
+			continue;
+		}
+		if (run.text.empty()) continue;
+		runFont.size = run.size > 0 ? run.size : font.size;
+		const TextLayout* layout = fontmgr->getTextLayout(run.text.c_str(), runFont);
+		if (!layout) continue;
+		advances[i] = layout->pens.back();
+		if (draw) {
+			state->font = runFont;
+			if (run.outlineWidth > 0) {
+				state->strokeColor = run.outlineColor;
+				state->strokeObject = nullptr;
+				state->lineWidth = run.outlineWidth;
+				drawText(run.text.c_str(), pen, y, true);
+			}
+			state->fillColor = run.hasColor ? run.color : fillColor;
+			state->fillObject = run.hasColor ? nullptr : fillObject;
+			drawText(run.text.c_str(), pen, y, false);
+		}
+		pen += advances[i];
+	}
+	if (!draw) return;
+	state->font = font;
+	state->textAlign = textAlign;
+	state->fillColor = fillColor;
+	state->fillObject = fillObject;
+	state->strokeColor = strokeColor;
+	state->strokeObject = strokeObject;
+	state->lineWidth = lineWidth;
+}
+
+// fillTextRuns(runs, x, y) draws styled runs of text and icons in one call,
+// returns { width, advances } with the advance of every run
+JS_FUNC_IMPL(CanvasContext2D, fillTextRuns)
+{
+	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_ROOT_OBJECT_ARG(runs, 0);
+	JS_DOUBLE_ARG(x, 1);
+	JS_DOUBLE_ARG(y, 2);
+	std::vector<TextRun> textRuns;
+	std::vector<float> advances;
+	if (!runs || !parseTextRuns(ctx, runs, textRuns)) JS_FAIL("Runs must be an array");
+	pthis->drawTextRuns(textRuns, x, y, true, advances);
+	JSObject* result = textRunMetrics(ctx, advances);
+	if (!result) return false;
+	JS_RET(result);
+}
+
+// measureTextRuns(runs) returns what fillTextRuns would, without drawing
+JS_FUNC_IMPL(CanvasContext2D, measureTextRuns)
+{
+	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_ROOT_OBJECT_ARG(runs, 0);
+	std::vector<TextRun> textRuns;
+	std::vector<float> advances;
+	if (!runs || !parseTextRuns(ctx, runs, textRuns)) JS_FAIL("Runs must be an array");
+	pthis->drawTextRuns(textRuns, 0, 0, false, advances);
+	JSObject* result = textRunMetrics(ctx, advances);
+	if (!result) return false;
+	JS_RET(result);
+}
+
 JS_FUNC_IMPL(CanvasContext2D, createPattern)
 {
 	JS_BEGIN_ARG_THIS(CanvasContext2D);
@@ -827,7 +1356,7 @@ JS_FUNC_IMPL(CanvasContext2D, createPattern)
 		image = ((Image*)ptr)->_texture;
 	}
 	else if (Canvas::is_js_instance(obj)) {
-		image = ((Canvas*)ptr)->_texture;
+		image = ((Canvas*)ptr)->getTexture();
 	}
 	if (!image) JS_FAIL("Invalid image");
 	JS_STRING_ARG(repeatstr, 1);
@@ -881,7 +1410,7 @@ JS_FUNC_IMPL(CanvasContext2D, tintImage)
 		image = ((Image*)ptr)->_texture;
 	}
 	else if (Canvas::is_js_instance(obj)) {
-		image = ((Canvas*)ptr)->_texture;
+		image = ((Canvas*)ptr)->getTexture();
 	}
 	if (!image) JS_FAIL("Invalid image");
 	PREPARE_IMAGE_OPERATION(pthis, image);
@@ -920,51 +1449,105 @@ JS_FUNC_IMPL(CanvasContext2D, tintImage)
 	JS_RETURN;
 }
 
-JS_FUNC_IMPL(CanvasContext2D, save)
+JS_JIT_FUNC_IMPL(CanvasContext2D, save)
 {
-	JS_BEGIN_ARG_THIS(CanvasContext2D);
-	if (pthis->_state) {
-		pthis->_stateStack.push_back(*pthis->_state);
-		pthis->_state = &pthis->_stateStack.back();
-	}
+	JS_BEGIN_JIT_ARG_THIS(CanvasContext2D);
+	// nothing is copied until the state is changed, save() and restore() around
+	// a few draws are common
+	pthis->_state->sharedSaves++;
 	JS_RETURN;
 }
 
-JS_FUNC_IMPL(CanvasContext2D, restore)
+JS_JIT_FUNC_IMPL(CanvasContext2D, restore)
 {
-	JS_BEGIN_ARG_THIS(CanvasContext2D);
+	JS_BEGIN_JIT_ARG_THIS(CanvasContext2D);
 	pthis->restoreState();
 	JS_RETURN;
 }
 
 static bool IsRectEqual(const GPU_Rect& r1, const GPU_Rect& r2) { return r1.x == r2.x && r1.y == r2.y && r1.w == r2.w && r1.h == r2.h; }
+inline Context2DState* CanvasContext2D::writableState()
+{
+	if (_state->sharedSaves > 0) {
+		_state->sharedSaves--;
+		Context2DState copy = *_state;
+		copy.sharedSaves = 0;
+		_stateStack.push_back(copy);
+		_state = &_stateStack.back();
+	}
+	return _state;
+}
+
 void CanvasContext2D::restoreState()
 {
+	if (_state->sharedSaves > 0) {
+		_state->sharedSaves--;
+		return;
+	}
 	if (_stateStack.size() < 2) return;
 	auto rs = &_stateStack[_stateStack.size() - 2];
-	if (_target) {
-		if (rs->globalAlpha != _state->globalAlpha) {
-			gpu::SetTargetRGBA(_target, 0xff, 0xff, 0xff, std::min<int>(255, std::max<int>(rs->globalAlpha * 255, 0)));			
-		}
-		// ״̬clipRectͬ, 
-		if (!IsRectEqual(rs->clipRect, _state->clipRect)) {
-			gpu::UnsetClip(_target);
-			if (rs->clipRect.w > 0 && rs->clipRect.h > 0) gpu::SetClipRect(_target, rs->clipRect);			
-		}
-	}
+	if (rs->globalAlpha != _state->globalAlpha) _dirty |= kDirtyAlpha;
+	if (!IsRectEqual(rs->clipRect, _state->clipRect)) _dirty |= kDirtyClip;
 	_stateStack.pop_back();
-	if (!_stateStack.empty()) _state = &_stateStack.back();
+	_state = &_stateStack.back();
+}
+
+// copies pixels with glCopyTexSubImage2D when blending and filtering can't change them:
+// whole pixel offsets at 1:1 scale, full alpha, and copy or source-over onto a blank canvas
+bool CanvasContext2D::copyCanvasRect(Canvas* source, float sx, float sy, float w, float h, float dx, float dy)
+{
+	int op = _state->globalCompositeOperation;
+	if (op != kCompositeOperationCopy && !(op == kCompositeOperationSourceOver && _blank)) return false;
+	if (_state->globalAlpha != 1.0f) return false;
+	// negative sizes flip the rects, normalised by the blit path
+	if (w <= 0 || h <= 0) return false;
+	const AffineTransform& t = _state->transform;
+	if (t.a != 1 || t.b != 0 || t.c != 0 || t.d != 1) return false;
+	dx += t.tx;
+	dy += t.ty;
+	if (sx != floorf(sx) || sy != floorf(sy) || dx != floorf(dx) || dy != floorf(dy) || w != floorf(w) || h != floorf(h)) return false;
+	if (source == _owner || !source->_target || !_isOffscreen) return false;
+	checkTarget();
+	gpu::Target* src = source->_target;
+	gpu::Image* dst = _owner->_texture;
+	if (!_target || !dst || src->using_virtual_resolution || _target->using_virtual_resolution) return false;
+	// the part inside the source, then inside the destination and its clip
+	GPU_Rect bounds = { 0, 0, (float)_target->w, (float)_target->h };
+	if (_appliedClip.w > 0 && _appliedClip.h > 0) bounds = _appliedClip;
+	float left = std::max<float>(std::max<float>(sx, 0) - sx, std::max<float>(dx, bounds.x) - dx);
+	float top = std::max<float>(std::max<float>(sy, 0) - sy, std::max<float>(dy, bounds.y) - dy);
+	float right = std::min<float>(std::min<float>(sx + w, src->w) - sx, std::min<float>(dx + w, bounds.x + bounds.w) - dx);
+	float bottom = std::min<float>(std::min<float>(sy + h, src->h) - sy, std::min<float>(dy + h, bounds.y + bounds.h) - dy);
+	_blank = false;
+	if (right <= left || bottom <= top) return true;
+	GPU_Rect rect = { sx + left, sy + top, right - left, bottom - top };
+	return gpu::CopyTargetRect(src, &rect, dst, (int)(dx + left), (int)(dy + top));
+}
+
+void CanvasContext2D::applyState()
+{
+	if ((_dirty & kDirtyAlpha) && _appliedAlpha != _state->globalAlpha) {
+		_appliedAlpha = _state->globalAlpha;
+		gpu::SetTargetRGBA(_target, 0xff, 0xff, 0xff, std::min<int>(255, std::max<int>(_appliedAlpha * 255, 0)));
+	}
+	// ״̬clipRectͬ, 
+	if ((_dirty & kDirtyClip) && !IsRectEqual(_appliedClip, _state->clipRect)) {
+		_appliedClip = _state->clipRect;
+		gpu::UnsetClip(_target);
+		if (_appliedClip.w > 0 && _appliedClip.h > 0) gpu::SetClipRect(_target, _appliedClip);
+	}
+	_dirty = 0;
 }
 
 void CanvasContext2D::checkTarget()
 {
 	if (!_target) {
 		_owner->makeTarget();
-		if (_state->globalAlpha != 1.0) {
-			gpu::SetTargetRGBA(_target, 0xff, 0xff, 0xff, std::min<int>(255, std::max<int>(_state->globalAlpha * 255, 0)));
-		}
-		const GPU_Rect& rect = _state->clipRect;
-		if (rect.w > 0 && rect.h > 0) gpu::SetClipRect(_target, rect);		
+		_appliedAlpha = 1.0f;
+		_appliedClip = { 0, 0, 0, 0 };
+		_dirty = kDirtyAlpha | kDirtyClip;
 	}
+	if (_dirty) applyState();
 }
+
 NS_REK_END
\ No newline at end of file
@@ -9,18 +9,6 @@
 
 NS_REK_BEGIN
 
-typedef enum {
-	kLineCapButt = 0,
-	kLineCapRound,
-	kLineCapSquare
-} LineCap;
-
-typedef enum {
-	kLineJoinMiter = 0,
-	kLineJoinBevel,
-	kLineJoinRound
-} LineJoin;
-
 typedef enum {
 	kCompositeOperationSourceOver = 0,
 	kCompositeOperationLighter,
@@ -87,21 +75,22 @@ struct Context2DState {
 	TextBaseline textBaseline;
 	TextAlign textAlign;	
 	GPU_Rect clipRect;
-	GPU_Rect lastPathRect;
+	int sharedSaves;	// save() calls sharing this entry, it is copied on the first change
 	Context2DState() : globalCompositeOperation(kCompositeOperationSourceOver), globalAlpha(1.0f),		
 		lineWidth(1.0f), lineCap(kLineCapButt), lineJoin(kLineJoinMiter), miterLimit(10),
 		fillObject(nullptr), strokeObject(nullptr),
-		textBaseline(kTextBaselineAlphabetic), textAlign(kTextAlignStart)
+		textBaseline(kTextBaselineAlphabetic), textAlign(kTextAlignStart), sharedSaves(0)
 	{
 		transform = gpu::AffineTransformMakeIdentity();
 		fillColor = { 0, 0, 0, 0xff };
 		strokeColor = { 0, 0, 0, 0xff };
 		font = { 0/* sans-serif */, 10/* 10px */, 0/* no italic */, 0/* no bold */ };
 		clipRect = { 0, 0, 0, 0 };
-		lastPathRect = { 0, 0, 0, 0 };		
 	}
 };
 
+struct TextRun;
+
 class CanvasContext2D : public CanvasContext
 {
 public:
@@ -111,25 +100,32 @@ public:
 	// State
 	JS_PROPGET_DECL(globalCompositeOperation)
 	JS_PROPSET_DECL(globalCompositeOperation)
-	JS_PROPGET_DECL(globalAlpha)
-	JS_PROPSET_DECL(globalAlpha)
+	JS_JIT_PROPGET_DECL(globalAlpha)
+	JS_JIT_PROPSET_DECL(globalAlpha)
 	JS_PROPGET_DECL(fillStyle)
-	JS_PROPSET_DECL(fillStyle)
+	JS_JIT_PROPSET_DECL(fillStyle)
 	JS_PROPGET_DECL(strokeStyle)
 	JS_PROPSET_DECL(strokeStyle)
 	JS_PROPGET_DECL(lineWidth)
 	JS_PROPSET_DECL(lineWidth)	
-	JS_FUNC_DECL(save)
-	JS_FUNC_DECL(restore)
+	JS_PROPGET_DECL(lineCap)
+	JS_PROPSET_DECL(lineCap)
+	JS_PROPGET_DECL(lineJoin)
+	JS_PROPSET_DECL(lineJoin)
+	JS_PROPGET_DECL(miterLimit)
+	JS_PROPSET_DECL(miterLimit)
+	JS_JIT_FUNC_DECL(save)
+	JS_JIT_FUNC_DECL(restore)
 	// Transform
-	JS_FUNC_DECL(setTransform)
+	JS_JIT_FUNC_DECL(setTransform)
 	JS_FUNC_DECL(rotate)
 	JS_FUNC_DECL(scale)
 	JS_FUNC_DECL(translate)
 	// Rendering
-	JS_FUNC_DECL(drawImage)
-	JS_FUNC_DECL(clearRect)
-	JS_FUNC_DECL(fillRect)
+	JS_JIT_FUNC_DECL(drawImage)
+	JS_FUNC_DECL(drawImages)
+	JS_JIT_FUNC_DECL(clearRect)
+	JS_JIT_FUNC_DECL(fillRect)
 	JS_FUNC_DECL(strokeRect)
 	// Pixel Manipulate
 	JS_FUNC_DECL(createImageData)
@@ -164,18 +160,40 @@ public:
 	JS_FUNC_DECL(createRadialGradient)
 	// Rekka Extra
 	JS_FUNC_DECL(tintImage)	
+	JS_FUNC_DECL(fillTextRuns)
+	JS_FUNC_DECL(measureTextRuns)
 public:	
 	JSObject* createObject(JSContext *ctx);
 	int getType() { return kContextType2D; }
 private:
 	inline void checkTarget();
+	void applyState();
+	inline Context2DState* writableState();
 	void fillRect(float x, float y, float w, float h, const SDL_Color& color);
+	StrokeStyle strokeStyle(bool deviceSpace);
+	void blitText(gpu::Image* image, float x, float y, FillObject* fillobj, const SDL_Color& color);
+	void blitTextQuads(float x, float y, const SDL_Color& color);
+	bool drawTextDistanceField(const char* text, float x, float y, bool stroke);
+	bool drawTextGlyphs(const char* text, float x, float y, bool stroke);
+	bool drawText(const char* text, float x, float y, bool stroke);
+	void drawTextRuns(const std::vector<TextRun>& runs, float x, float y, bool draw, std::vector<float>& advances);
 	void clearRect(float x, float y, float w, float h);
+	bool copyCanvasRect(Canvas* source, float sx, float sy, float w, float h, float dx, float dy);
 	void restoreState();
 private:
+	enum {
+		kDirtyAlpha = 1 << 0,
+		kDirtyClip = 1 << 1
+	};
 	Context2DState* _state;
 	Path _path;
+	GPU_Rect _lastPathRect;
 	std::vector<Context2DState> _stateStack;
+	// target state is applied lazily before the next draw
+	int _dirty;
+	float _appliedAlpha;
+	GPU_Rect _appliedClip;
+	bool _blank;	// fully transparent, source-over draws onto it are plain copies
 };
 
 NS_REK_END
@@ -30,8 +30,9 @@ Pattern::Pattern(gpu::Image * texture, PatternRepeat repeat)
 {
 	_texture = gpu::CreateAliasImage(texture);
 	_repeat = repeat;
-	_powerof2 = isPowerOfTwo(texture->texture_w) && isPowerOfTwo(texture->texture_h);	
-	if (CanvasExtra::supportNPOTRepeat || _powerof2) {
+	bool powerof2 = isPowerOfTwo(texture->texture_w) && isPowerOfTwo(texture->texture_h);
+	_wrapRepeat = (CanvasExtra::supportNPOTRepeat || powerof2) && texture->w == texture->texture_w && texture->h == texture->texture_h;
+	if (_wrapRepeat) {
 		switch (repeat) {
 		case kPatternNoRepeat:
 			gpu::SetWrapMode(_texture, gpu::WRAP_NONE, gpu::WRAP_NONE);
@@ -60,26 +61,21 @@ JSObject* Pattern::createObject(JSContext* ctx)
 	return robj;
 }
 
-LinearGradient::LinearGradient(float x0, float y0, float x1, float y1)
-: _x0(x0), _y0(y0), _x1(x1), _y1(y1)
-{	
-}
+// texels in the lookup texture, t = 0 is at the center of the first one, 1 of the last
+#define GRADIENT_LOOKUP_SIZE 256
 
-LinearGradient::~LinearGradient()
-{	
+Gradient::Gradient() : _lookupTexture(nullptr), _lookupTextureDirty(true)
+{
 }
 
-JSObject* LinearGradient::createObject(JSContext* ctx)
-{	
-	JS::RootedObject robj(ctx, JS_NewObject(ctx, &linear_gradient_class));
-	JS_DefineFunction(ctx, robj, "addColorStop", LinearGradient::js_addColorStop, 0, 0);
-	wrap(ctx, robj);
-	return robj;
+Gradient::~Gradient()
+{
+	if (_lookupTexture) gpu::FreeImage(_lookupTexture);
 }
 
-JS_FUNC_IMPL(LinearGradient, addColorStop)
+JS_FUNC_IMPL(Gradient, addColorStop)
 {
-	JS_BEGIN_ARG_THIS(LinearGradient);
+	JS_BEGIN_ARG_THIS(Gradient);
 	JS_DOUBLE_ARG(stop, 0);
 	JS_STRING_ARG(colorstr, 1);
 	stop = std::min<double>(std::max<double>(stop, 0), 1);	
@@ -90,110 +86,137 @@ JS_FUNC_IMPL(LinearGradient, addColorStop)
 	const SDL_Color& sc = HtmlColorToColor(colorstr);
 	GPU_Color color = { sc.r / 255.0f, sc.g / 255.0f, sc.b / 255.0f, sc.a / 255.0f };
 	pthis->_colorStops.insert(itr, { color, (float)stop });
+	pthis->_lookupTextureDirty = true;
 	JS_RETURN;
 }
 
-inline GPU_Color _calculateLinearColor(float p, float p0, float p1, std::vector<GradientColorStop>& colorStops)
+inline GPU_Color _calculateStopColor(float t, std::vector<GradientColorStop>& colorStops)
 {
-	float diff = p1 - p0;
-	GradientColorStop *curclrstop, *prevclrstop;
-	for (int i = 0; i < colorStops.size(); ++i) {
-		curclrstop = &colorStops[i];
-		float stop = curclrstop->stop * diff + p0;
-		if (p <= stop) {
-			if (i == 0) return curclrstop->color;
-			float prev_p = prevclrstop->stop * diff + p0;
-			float factor = (p - prev_p) / (stop - prev_p);
-			auto& clr = curclrstop->color;
-			auto& prevclr = prevclrstop->color;
+	if (t <= colorStops.front().stop) return colorStops.front().color;
+	for (size_t i = 1; i < colorStops.size(); ++i) {
+		auto& curclrstop = colorStops[i];
+		if (t < curclrstop.stop) {
+			auto& prevclrstop = colorStops[i - 1];
+			float factor = (t - prevclrstop.stop) / (curclrstop.stop - prevclrstop.stop);
+			auto& clr = curclrstop.color;
+			auto& prevclr = prevclrstop.color;
 			return { factor * (clr.r - prevclr.r) + prevclr.r, factor * (clr.g - prevclr.g) + prevclr.g,
-				factor * (clr.b - prevclr.b) + prevclr.b,factor * (clr.a - prevclr.a) + prevclr.a };
+				factor * (clr.b - prevclr.b) + prevclr.b, factor * (clr.a - prevclr.a) + prevclr.a };
 		}
-		prevclrstop = curclrstop;
 	}
-	return curclrstop->color;
+	return colorStops.back().color;
 }
-GPU_Color SDLCALL LinearGradient::colorFunc(float x, float y, void * userdata)
+
+gpu::Image* Gradient::getLookupTexture()
 {
-	LinearGradient* pthis = (LinearGradient*)userdata;
+	if (_colorStops.empty() || isDegenerate()) return nullptr;
+	if (!_lookupTextureDirty) return _lookupTexture;
+	if (!_lookupTexture) {
+		_lookupTexture = gpu::CreateImage(GRADIENT_LOOKUP_SIZE, 1, gpu::FORMAT_RGBA);
+		if (!_lookupTexture) return nullptr;
+		gpu::SetWrapMode(_lookupTexture, gpu::WRAP_NONE, gpu::WRAP_NONE);
+	}
+	unsigned char bytes[GRADIENT_LOOKUP_SIZE * 4];
+	for (int i = 0; i < GRADIENT_LOOKUP_SIZE; i++) {
+		const GPU_Color& color = _calculateStopColor((float)i / (GRADIENT_LOOKUP_SIZE - 1), _colorStops);
+		bytes[i * 4] = (unsigned char)(color.r * 255 + 0.5f);
+		bytes[i * 4 + 1] = (unsigned char)(color.g * 255 + 0.5f);
+		bytes[i * 4 + 2] = (unsigned char)(color.b * 255 + 0.5f);
+		bytes[i * 4 + 3] = (unsigned char)(color.a * 255 + 0.5f);
+	}
+	// queued draws may still sample the old stops
+	gpu::FlushBlitBuffer();
+	gpu::UpdateImageBytes(_lookupTexture, nullptr, bytes, GRADIENT_LOOKUP_SIZE * 4);
+	_lookupTextureDirty = false;
+	return _lookupTexture;
+}
+
+bool Gradient::beginShader(const AffineTransform& texCoordTransform, bool masked)
+{
+	gpu::Image* lookup = getLookupTexture();
+	return lookup && setupShader(lookup, texCoordTransform, masked);
+}
+
+void Gradient::endShader()
+{
+	CanvasExtra::endGradient();
+}
+
+GPU_Color SDLCALL Gradient::colorFunc(float x, float y, void * userdata)
+{
+	Gradient* pthis = (Gradient*)userdata;
 	if (pthis->_colorStops.size() == 0) return{ 1, 1, 1, 1 };
 	if (pthis->_colorStops.size() == 1) return pthis->_colorStops[0].color;
-	if (pthis->_x0 == pthis->_x1 && pthis->_y0 == pthis->_y1) return pthis->_colorStops[0].color;
-	if (pthis->_x0 == pthis->_x1) return _calculateLinearColor(y, pthis->_y0, pthis->_y1, pthis->_colorStops);
-	if (pthis->_y0 == pthis->_y1) return _calculateLinearColor(x, pthis->_x0, pthis->_x1, pthis->_colorStops);
-	GPU_Color color_x = _calculateLinearColor(x, pthis->_x0, pthis->_x1, pthis->_colorStops);
-	GPU_Color color_y = _calculateLinearColor(y, pthis->_y0, pthis->_y1, pthis->_colorStops);
-	return{ sqrt((color_x.r * color_x.r + color_y.r * color_y.r) / 2),
-		sqrt((color_x.g * color_x.g + color_y.g * color_y.g) / 2),
-		sqrt((color_x.b * color_x.b + color_y.b * color_y.b) / 2),
-		sqrt((color_x.a * color_x.a + color_y.a * color_y.a) / 2) };
+	return pthis->colorAt(x, y);
 }
 
-RadialGradient::RadialGradient(float x0, float y0, float r0, float x1, float y1, float r1)
-: _x0(x0), _y0(y0), _r0(r0), _x1(x1), _y1(y1), _r1(r1)
+LinearGradient::LinearGradient(float x0, float y0, float x1, float y1)
+: _x0(x0), _y0(y0), _x1(x1), _y1(y1)
+{	
+}
+
+JSObject* LinearGradient::createObject(JSContext* ctx)
+{	
+	JS::RootedObject robj(ctx, JS_NewObject(ctx, &linear_gradient_class));
+	JS_DefineFunction(ctx, robj, "addColorStop", Gradient::js_addColorStop, 0, 0);
+	wrap(ctx, robj);
+	return robj;
+}
+
+GPU_Color LinearGradient::colorAt(float x, float y)
+{
+	float dx = _x1 - _x0, dy = _y1 - _y0;
+	if (dx == 0 && dy == 0) return _colorStops[0].color;
+	float t = ((x - _x0) * dx + (y - _y0) * dy) / (dx * dx + dy * dy);
+	return _calculateStopColor(t, _colorStops);
+}
+
+bool LinearGradient::setupShader(gpu::Image* lookup, const AffineTransform& texCoordTransform, bool masked)
 {
+	// t = dot(p - p0, p1 - p0) / |p1 - p0|^2 is affine in the texture coordinates too
+	float dx = _x1 - _x0, dy = _y1 - _y0;
+	float gx = dx / (dx * dx + dy * dy), gy = dy / (dx * dx + dy * dy);
+	const AffineTransform& t = texCoordTransform;
+	float row[3] = { gx * t.a + gy * t.b, gx * t.c + gy * t.d, gx * (t.tx - _x0) + gy * (t.ty - _y0) };
+	return CanvasExtra::beginLinearGradient(lookup, masked, row);
 }
 
-RadialGradient::~RadialGradient()
+RadialGradient::RadialGradient(float x0, float y0, float r0, float x1, float y1, float r1)
+: _x0(x0), _y0(y0), _r0(r0), _x1(x1), _y1(y1), _r1(r1)
 {
 }
 
 JSObject* RadialGradient::createObject(JSContext* ctx)
 {	
 	JS::RootedObject robj(ctx, JS_NewObject(ctx, &radial_gradient_class));
-	JS_DefineFunction(ctx, robj, "addColorStop", RadialGradient::js_addColorStop, 0, 0);
+	JS_DefineFunction(ctx, robj, "addColorStop", Gradient::js_addColorStop, 0, 0);
 	wrap(ctx, robj);
 	return robj;
 }
 
-JS_FUNC_IMPL(RadialGradient, addColorStop)
-{
-	JS_BEGIN_ARG_THIS(RadialGradient);
-	JS_DOUBLE_ARG(stop, 0);
-	JS_STRING_ARG(colorstr, 1);
-	stop = std::min<double>(std::max<double>(stop, 0), 1);
-	auto itr = pthis->_colorStops.begin();
-	for (; itr != pthis->_colorStops.end(); ++itr) {
-		if (itr->stop > stop) break;
-	}
-	const SDL_Color& sc = HtmlColorToColor(colorstr);
-	GPU_Color color = { sc.r / 255.0f, sc.g / 255.0f, sc.b / 255.0f, sc.a / 255.0f };
-	pthis->_colorStops.insert(itr, { color, (float)stop });
-	JS_RETURN;
-}
-
 inline float _distance(float x1, float y1, float x2, float y2)
 {
 	float dx = x2 - x1, dy = y2 - y1;
 	return sqrt(dx * dx + dy * dy);
 }
 
-GPU_Color SDLCALL RadialGradient::colorFunc(float x, float y, void * userdata)
+GPU_Color RadialGradient::colorAt(float x, float y)
 {
-	RadialGradient* pthis = (RadialGradient*)userdata;
-	if (pthis->_colorStops.size() == 0) return{ 1, 1, 1, 1 };
-	if (pthis->_colorStops.size() == 1) return pthis->_colorStops[0].color;	
-	float dist_0 = _distance(x, y, pthis->_x0, pthis->_y0);
-	float dist_1 = _distance(x, y, pthis->_x1, pthis->_y1);
-	float dist = _distance(pthis->_x0, pthis->_y0, pthis->_x1, pthis->_y1);
-	auto& colorStops = pthis->_colorStops;
-	if (dist_0 < dist_1 && dist_1 - dist_0 > dist) return colorStops.front().color;
-	if (dist_1 < dist_0 && dist_0 - dist_1 > dist) return colorStops.back().color;
-	float ratio = dist_0 / (dist_0 + dist_1);
-	GradientColorStop *curclrstop, *prevclrstop;
-	for (int i = 0; i < colorStops.size(); ++i) {
-		curclrstop = &colorStops[i];		
-		if (ratio <= curclrstop->stop) {
-			if (i == 0) return curclrstop->color;			
-			float factor = (ratio - prevclrstop->stop) / (curclrstop->stop - prevclrstop->stop);
-			auto& clr = curclrstop->color;
-			auto& prevclr = prevclrstop->color;
-			return { factor * (clr.r - prevclr.r) + prevclr.r, factor * (clr.g - prevclr.g) + prevclr.g,
-				factor * (clr.b - prevclr.b) + prevclr.b,factor * (clr.a - prevclr.a) + prevclr.a };
-		}
-		prevclrstop = curclrstop;
-	}
-	return curclrstop->color;
+	float dist_0 = _distance(x, y, _x0, _y0);
+	float dist_1 = _distance(x, y, _x1, _y1);
+	float dist = _distance(_x0, _y0, _x1, _y1);
+	if (dist_0 < dist_1 && dist_1 - dist_0 > dist) return _colorStops.front().color;
+	if (dist_1 < dist_0 && dist_0 - dist_1 > dist) return _colorStops.back().color;
+	return _calculateStopColor(dist_0 / (dist_0 + dist_1), _colorStops);
+}
+
+bool RadialGradient::setupShader(gpu::Image* lookup, const AffineTransform& texCoordTransform, bool masked)
+{
+	const AffineTransform& t = texCoordTransform;
+	float rows[6] = { t.a, t.c, t.tx, t.b, t.d, t.ty };
+	float start[3] = { _x0, _y0, _r0 };
+	float delta[3] = { _x1 - _x0, _y1 - _y0, _r1 - _r0 };
+	return CanvasExtra::beginRadialGradient(lookup, masked, rows, start, delta);
 }
 
 NS_REK_END
\ No newline at end of file
@@ -32,7 +32,7 @@ public:
 	JSObject* createObject(JSContext *ctx);	
 public:
 	gpu::Image* _texture; // should be an alias image
-	bool _powerof2;
+	bool _wrapRepeat; // GL repeat wraps at the image size, pooled canvas textures may be padded
 private:
 	PatternRepeat _repeat;
 };
@@ -41,32 +41,58 @@ struct GradientColorStop {
 	GPU_Color color;
 	float stop;
 };
-class LinearGradient : public FillObject
+// The color stops are sampled into a lookup texture, a shader evaluates t per pixel
+// and samples it. Gradients are in the user space of the draw call.
+class Gradient : public FillObject
 {
-public:	
+public:
+	// colors at vertices only, for when the gradient shaders are unavailable
 	static GPU_Color SDLCALL colorFunc(float x, float y, void* userdata);
 public:
+	Gradient();
+	~Gradient();
+	JS_FUNC_DECL(addColorStop)
+	// 256x1, rebuilt when the stops have changed; nullptr if there is nothing to paint
+	gpu::Image* getLookupTexture();
+	// the following draws use the gradient shader until endShader(), texCoordTransform maps
+	// their texture coordinates to user space; with masked the alpha of the drawn image masks
+	// the gradient, otherwise the lookup texture is the drawn image
+	bool beginShader(const AffineTransform& texCoordTransform, bool masked);
+	static void endShader();
+protected:
+	virtual GPU_Color colorAt(float x, float y) = 0;
+	virtual bool isDegenerate() = 0;
+	virtual bool setupShader(gpu::Image* lookup, const AffineTransform& texCoordTransform, bool masked) = 0;
+	std::vector<GradientColorStop> _colorStops;
+private:
+	gpu::Image* _lookupTexture;
+	bool _lookupTextureDirty;
+};
+
+class LinearGradient : public Gradient
+{
+public:	
 	LinearGradient(float x0, float y0, float x1, float y1);
-	~LinearGradient();
 	JSObject* createObject(JSContext *ctx);	
-	JS_FUNC_DECL(addColorStop)
+protected:
+	GPU_Color colorAt(float x, float y);
+	bool isDegenerate() { return _x0 == _x1 && _y0 == _y1; }
+	bool setupShader(gpu::Image* lookup, const AffineTransform& texCoordTransform, bool masked);
 private:
 	float _x0, _y0, _x1, _y1;
-	std::vector<GradientColorStop> _colorStops;
 };
 
-class RadialGradient : public FillObject
+class RadialGradient : public Gradient
 {
-public:
-	static GPU_Color SDLCALL colorFunc(float x, float y, void* userdata);
 public:
 	RadialGradient(float x0, float y0, float r0, float x1, float y1, float r1);
-	~RadialGradient();
 	JSObject* createObject(JSContext *ctx);	
-	JS_FUNC_DECL(addColorStop)
+protected:
+	GPU_Color colorAt(float x, float y);
+	bool isDegenerate() { return _x0 == _x1 && _y0 == _y1 && _r0 == _r1; }
+	bool setupShader(gpu::Image* lookup, const AffineTransform& texCoordTransform, bool masked);
 private:
 	float _x0, _y0, _r0, _x1, _y1, _r1;
-	std::vector<GradientColorStop> _colorStops;
 };
 
 
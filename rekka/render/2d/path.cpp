@@ -8,8 +8,13 @@ NS_REK_BEGIN
 #define PATH_COLLINEARITY_EPSILON 1.192092896e-07F // FLT_EPSILON
 #define PATH_STEPS_FOR_CIRCLE 48.0f
 
+// fills and strokes are built on the main thread only
+static Tessellator s_tessellator;
+static Stroker s_stroker;
+
 void Path::beginPath()
 {
+	invalidateMeshes();
 	_hasStartPoint = false;
 	_paths.clear();
 	_currentPath.clear();
@@ -20,7 +25,8 @@ void Path::closePath()
 	// closePathʽʱ, subpathʼΪǰsubpathʼ
 	if (_hasStartPoint) {
 		_currentPoint = _startPoint;
-		_currentPath.isClosed = true;		
+		_currentPath.isClosed = true;
+		invalidateMeshes();
 	}
 	done();
 }
@@ -64,7 +70,7 @@ void Path::bezierCurveTo(float cpx1, float cpy1, float cpx2, float cpy2, float x
 		_currentPoint = p;
 	}
 	else {
-		float scale = getAffineTransformScale(transform);
+		float scale = _flattenScale > 0 ? _flattenScale : getAffineTransformScale(transform);
 		float distanceTolerance = PATH_DISTANCE_EPSILON / scale;
 		distanceTolerance *= distanceTolerance;
 		const auto& cp1 = gpu::PointApplyAffineTransform(cpx1, cpy1, transform);
@@ -149,7 +155,7 @@ void Path::quadraticCurveTo(float cpx, float cpy, float x, float y, const Affine
 		_currentPoint = p;
 	}
 	else {
-		float scale = getAffineTransformScale(transform);
+		float scale = _flattenScale > 0 ? _flattenScale : getAffineTransformScale(transform);
 		float distanceTolerance = PATH_DISTANCE_EPSILON / scale;
 		distanceTolerance *= distanceTolerance;
 		const auto& cp = gpu::PointApplyAffineTransform(cpx, cpy, transform);
@@ -258,163 +264,125 @@ void Path::arc(float x, float y, float radius, float startAngle, float endAngle,
 	_currentPoint = _currentPath.points.back();
 }
 
-void Path::subfill(gpu::Target * target, const subpath_t & path, const SDL_Color & color)
-{
-	if (path.points.size() < 2) return;
-	gpu::PolygonFilled(target, path.points.size(), (float*)&path.points.front(), color);
-}
-
-void Path::subfill_pattern(gpu::Target * target, const subpath_t & path, Pattern* pattern, float texture_x, float texture_y)
+const FillMesh& Path::getFillMesh(FillRule rule)
 {
-	if (path.points.size() < 2) return;
-	if (CanvasExtra::supportNPOTRepeat || pattern->_powerof2) {			
-		gpu::PolygonTextureFilled(target, path.points.size(), (float*)&path.points.front(), pattern->_texture, texture_x, texture_y);
+	if (_fillMeshRule == rule) return _fillMesh;
+	_fillMesh.clear();
+	_fillMeshRule = rule;
+	const subpath_t* contour = nullptr;
+	int numContours = 0;
+	for (auto& path : _paths) {
+		if (path.points.size() < 3) continue;
+		contour = &path;
+		numContours++;
 	}
-	else {
-		CanvasExtra::beginNPOTRepeat(target, pattern->_texture, texture_x, texture_y);
-		gpu::PolygonTextureFilledNPOT(target, path.points.size(), (float*)&path.points.front(), pattern->_texture);
-		CanvasExtra::endNPOTRepeat();
+	if (_currentPath.points.size() >= 3) {
+		contour = &_currentPath;
+		numContours++;
+	}
+	if (numContours == 0) return _fillMesh;
+	if (numContours == 1 && Tessellator::isConvex(&contour->points.front(), contour->points.size()) &&
+		contour->points.size() <= FILL_MESH_MAX_VERTICES) {
+		// the common case, rects, circles and round rects
+		unsigned short count = (unsigned short)contour->points.size();
+		_fillMesh.vertices.assign((const float*)&contour->points.front(), (const float*)&contour->points.front() + count * 2);
+		for (unsigned short i = 2; i < count; i++) {
+			_fillMesh.indices.push_back(0);
+			_fillMesh.indices.push_back(i - 1);
+			_fillMesh.indices.push_back(i);
+		}
+		return _fillMesh;
+	}
+	s_tessellator.beginContours();
+	for (auto& path : _paths) {
+		if (path.points.size() >= 3) s_tessellator.addContour(&path.points.front(), path.points.size());
 	}
+	if (_currentPath.points.size() >= 3) s_tessellator.addContour(&_currentPath.points.front(), _currentPath.points.size());
+	s_tessellator.tessellate(rule, _fillMesh);
+	return _fillMesh;
 }
 
-void Path::subfill_gradient(gpu::Target * target, const subpath_t & path, void * gradient, int gradientType)
+void Path::fillMesh(gpu::Target * target, const FillMesh & mesh, const SDL_Color & color)
 {
-	if (path.points.size() < 2) return;
-	gpu::PolygonColorFilled(target, path.points.size(), (float*)&path.points.front(),
-		gradientType == 0 ? LinearGradient::colorFunc : RadialGradient::colorFunc, gradient);
+	if (mesh.indices.empty()) return;
+	gpu::TrianglesFilled(target, mesh.vertices.size() / 2, &mesh.vertices.front(), mesh.indices.size(), &mesh.indices.front(), color);
 }
 
-void Path::substroke(gpu::Target * target, const subpath_t & path, const SDL_Color & color)
+void Path::fillMesh(gpu::Target * target, const FillMesh & mesh, FillObject * filler, const AffineTransform * transform)
 {
-	auto& points = path.points;
-	if (points.size() < 1) return;
-	int num_lines = path.isClosed ? points.size() : points.size() - 1;	
-	for (int i = 0; i < num_lines; ++i) {
-		if (i == points.size() - 1) {
-			gpu::Line(target, points[i].x, points[i].y, points[0].x, points[0].y, color);
+	if (mesh.indices.empty()) return;
+	unsigned int numVertices = mesh.vertices.size() / 2;
+	const float* vertices = &mesh.vertices.front();
+	unsigned int numIndices = mesh.indices.size();
+	const unsigned short* indices = &mesh.indices.front();
+	Pattern* pattern = dynamic_cast<Pattern*>(filler);
+	if (pattern) {
+		const auto& first_point = gpu::PointApplyAffineTransform(0, 0, transform);
+		if (pattern->_wrapRepeat) {
+			gpu::TrianglesTextureFilled(target, numVertices, vertices, numIndices, indices, pattern->_texture, first_point.x, first_point.y);
 		}
 		else {
-			gpu::Line(target, points[i].x, points[i].y, points[i + 1].x, points[i + 1].y, color);
+			CanvasExtra::beginNPOTRepeat(target, pattern->_texture, first_point.x, first_point.y);
+			gpu::TrianglesTextureFilledNPOT(target, numVertices, vertices, numIndices, indices, pattern->_texture);
+			CanvasExtra::endNPOTRepeat();
 		}
-	}	
-}
-
-void Path::substroke_pattern(gpu::Target * target, const subpath_t & path, Pattern* pattern, float texture_x, float texture_y)
-{
-	auto& points = path.points;
-	if (points.size() < 1) return;
-	int num_lines = path.isClosed ? points.size() : points.size() - 1;
-	if (CanvasExtra::supportNPOTRepeat || pattern->_powerof2) {
-		for (int i = 0; i < num_lines; ++i) {
-			if (i == points.size() - 1)
-				gpu::TextureLine(target, points[i].x, points[i].y, points[0].x, points[0].y, pattern->_texture, texture_x, texture_y);			
-			else 
-				gpu::TextureLine(target, points[i].x, points[i].y, points[i + 1].x, points[i + 1].y, pattern->_texture, texture_x, texture_y);			
-		}
-	}
-	else {
-		CanvasExtra::beginNPOTRepeat(target, pattern->_texture, texture_x, texture_y);
-		for (int i = 0; i < num_lines; ++i) {
-			if (i == points.size() - 1)
-				gpu::TextureLineNPOT(target, points[i].x, points[i].y, points[0].x, points[0].y, pattern->_texture);			
-			else 
-				gpu::TextureLineNPOT(target, points[i].x, points[i].y, points[i + 1].x, points[i + 1].y, pattern->_texture);			
-		}		
-		CanvasExtra::endNPOTRepeat();
+		return;
 	}
-}
-
-void Path::substroke_gradient(gpu::Target * target, const subpath_t & path, void * gradient, int gradientType)
-{
-	auto& points = path.points;
-	if (points.size() < 1) return;
-	int num_lines = path.isClosed ? points.size() : points.size() - 1;
-	for (int i = 0; i < num_lines; ++i) {
-		if (i == points.size() - 1) {
-			gpu::ColorLine(target, points[i].x, points[i].y, points[0].x, points[0].y,
-				gradientType == 0 ? LinearGradient::colorFunc : RadialGradient::colorFunc, gradient);
+	Gradient* gradient = dynamic_cast<Gradient*>(filler);
+	if (gradient) {
+		gpu::Image* lookup = gradient->getLookupTexture();
+		if (!lookup) return; // no color stops or a degenerate gradient, nothing to paint
+		// the NPOT fill maps the target to texture coordinates 0..1
+		AffineTransform toTarget = gpu::AffineTransformMake(target->w, 0, 0, target->h, 0, 0);
+		AffineTransform toUser = invertAffineTransform(transform);
+		AffineTransform texCoordTransform = gpu::AffineTransformConcat(&toTarget, &toUser);
+		if (gradient->beginShader(texCoordTransform, false)) {
+			const gpu::BlendMode& blend = gpu::GetContextTarget()->context->shapes_blend_mode;
+			gpu::SetBlendFunction(lookup, blend.source_color, blend.dest_color, blend.source_alpha, blend.dest_alpha);
+			gpu::TrianglesTextureFilledNPOT(target, numVertices, vertices, numIndices, indices, lookup);
+			Gradient::endShader();
 		}
 		else {
-			gpu::ColorLine(target, points[i].x, points[i].y, points[i + 1].x, points[i + 1].y,
-				gradientType == 0 ? LinearGradient::colorFunc : RadialGradient::colorFunc, gradient);
+			gpu::TrianglesColorFilled(target, numVertices, vertices, numIndices, indices, Gradient::colorFunc, gradient);
 		}
+		return;
 	}
+	SDL_LogError(0, "Invalid fill object");
 }
 
-void Path::fill(gpu::Target * target, const SDL_Color & color)
+void Path::fill(gpu::Target * target, const SDL_Color & color, FillRule rule)
 {
-	for (auto& path : _paths) {	
-		subfill(target, path, color);
-	}	
-	subfill(target, _currentPath, color);
+	fillMesh(target, getFillMesh(rule), color);
 }
 
-void Path::fill(gpu::Target * target, FillObject* filler, const AffineTransform* transform)
+void Path::fill(gpu::Target * target, FillObject* filler, const AffineTransform* transform, FillRule rule)
 {
-	Pattern* pattern = dynamic_cast<Pattern*>(filler);
-	if (pattern) {		
-		const auto& first_point = gpu::PointApplyAffineTransform(0, 0, transform);		
-		for (auto& path : _paths) {
-			subfill_pattern(target, path, pattern, first_point.x, first_point.y);
-		}
-		subfill_pattern(target, _currentPath, pattern, first_point.x, first_point.y);
-		return;
-	}
-	LinearGradient* gradient = dynamic_cast<LinearGradient*>(filler);
-	if (gradient) {
-		for (auto& path : _paths) {
-			subfill_gradient(target, path, gradient, 0);
-		}
-		subfill_gradient(target, _currentPath, gradient, 0);
-		return;
-	}
-	RadialGradient* gradient1 = dynamic_cast<RadialGradient*>(filler);
-	if (gradient1) {
-		for (auto& path : _paths) {
-			subfill_gradient(target, path, gradient1, 1);
-		}
-		subfill_gradient(target, _currentPath, gradient1, 1);
-		return;
-	}
-	SDL_LogError(0, "Invalid fill object");
+	fillMesh(target, getFillMesh(rule), filler, transform);
 }
 
-void Path::stroke(gpu::Target * target, const SDL_Color & color)
+const FillMesh& Path::getStrokeMesh(const StrokeStyle& style)
 {
+	if (_strokeMeshValid && _strokeMeshStyle == style) return _strokeMesh;
+	_strokeMesh.clear();
+	_strokeMeshStyle = style;
+	_strokeMeshValid = true;
 	for (auto& path : _paths) {
-		substroke(target, path, color);
+		if (!path.points.empty()) s_stroker.stroke(&path.points.front(), path.points.size(), path.isClosed, style, _strokeMesh);
 	}
-	substroke(target, _currentPath, color);
+	if (!_currentPath.points.empty()) {
+		s_stroker.stroke(&_currentPath.points.front(), _currentPath.points.size(), _currentPath.isClosed, style, _strokeMesh);
+	}
+	return _strokeMesh;
 }
 
-void Path::stroke(gpu::Target * target, FillObject * filler, const AffineTransform* transform)
+void Path::stroke(gpu::Target * target, const SDL_Color & color, const StrokeStyle& style)
 {
-	Pattern* pattern = dynamic_cast<Pattern*>(filler);
-	if (pattern) {		
-		const auto& first_point = gpu::PointApplyAffineTransform(0, 0, transform);
-		for (auto& path : _paths) {
-			substroke_pattern(target, path, pattern, first_point.x, first_point.y);
-		}
-		substroke_pattern(target, _currentPath, pattern, first_point.x, first_point.y);
-		return;
-	}
-	LinearGradient* gradient = dynamic_cast<LinearGradient*>(filler);
-	if (gradient) {
-		for (auto& path : _paths) {
-			substroke_gradient(target, path, gradient, 0);
-		}
-		substroke_gradient(target, _currentPath, gradient, 0);
-		return;
-	}
-	RadialGradient* gradient1 = dynamic_cast<RadialGradient*>(filler);
-	if (gradient1) {
-		for (auto& path : _paths) {
-			substroke_gradient(target, path, gradient1, 1);
-		}
-		substroke_gradient(target, _currentPath, gradient1, 1);
-		return;
-	}
-	SDL_LogError(0, "Invalid stroke object");
+	fillMesh(target, getStrokeMesh(style), color);
+}
+
+void Path::stroke(gpu::Target * target, FillObject * filler, const AffineTransform* transform, const StrokeStyle& style)
+{
+	fillMesh(target, getStrokeMesh(style), filler, transform);
 }
 
 NS_REK_END
\ No newline at end of file
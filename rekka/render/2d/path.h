@@ -2,6 +2,8 @@
 
 #include "rekka.h"
 #include "fill_object.h"
+#include "tessellator.h"
+#include "stroker.h"
 
 NS_REK_BEGIN
 
@@ -13,7 +15,7 @@ class Path {
 		void clear() { points.clear(); isClosed = false; }		
 	};
 public:
-	Path() : _hasStartPoint(false) {}
+	Path() : _hasStartPoint(false), _flattenScale(0), _fillMeshRule(-1), _strokeMeshValid(false) {}
 
 	void beginPath(); // ·
 	void closePath(); // subpath	
@@ -26,10 +28,19 @@ public:
 	void arc(float x, float y, float radius, float startAngle, float endAngle,
 		bool antiClockwise, const AffineTransform* transform);
 	
-	void fill(gpu::Target* target, const SDL_Color& color);
-	void fill(gpu::Target* target, FillObject* filler, const AffineTransform* transform);
-	void stroke(gpu::Target* target, const SDL_Color& color);
-	void stroke(gpu::Target* target, FillObject* filler, const AffineTransform* transform);
+	void fill(gpu::Target* target, const SDL_Color& color, FillRule rule = kFillRuleNonZero);
+	void fill(gpu::Target* target, FillObject* filler, const AffineTransform* transform, FillRule rule = kFillRuleNonZero);
+	void stroke(gpu::Target* target, const SDL_Color& color, const StrokeStyle& style);
+	void stroke(gpu::Target* target, FillObject* filler, const AffineTransform* transform, const StrokeStyle& style);
+
+	// flatten curves for this scale instead of the transform's, 0 follows the transform
+	void setFlattenScale(float scale) { _flattenScale = scale; }
+	// the fill area as triangles, kept until the path changes
+	const FillMesh& getFillMesh(FillRule rule);
+	// the outline as triangles, kept until the path or the style changes
+	const FillMesh& getStrokeMesh(const StrokeStyle& style);
+	static void fillMesh(gpu::Target* target, const FillMesh& mesh, const SDL_Color& color);
+	static void fillMesh(gpu::Target* target, const FillMesh& mesh, FillObject* filler, const AffineTransform* transform);
 private:	
 	void recursiveBezier(float x1, float y1, float x2, float y2, float x3,
 		float y3, float x4, float y4, int level, float distanceTolerance);
@@ -40,29 +51,32 @@ private:
 	void push(float x, float y) {
 		GPU_Point point = { x, y };
 		_currentPath.points.push_back(point);
+		invalidateMeshes();
 	}
 	void push(const GPU_Point& point) {
 		_currentPath.points.push_back(point);
+		invalidateMeshes();
 	}
+	void invalidateMeshes() { _fillMeshRule = -1; _strokeMeshValid = false; }
 	float getAffineTransformScale(const AffineTransform* t) { return sqrtf(t->a * t->a + t->c * t->c); }
-	AffineTransform invertAffineTransform(const AffineTransform* t) {
+	static AffineTransform invertAffineTransform(const AffineTransform* t) {
 		float determinant = 1 / (t->a * t->d - t->b * t->c);
 		AffineTransform it = { determinant * t->d, -determinant * t->b, -determinant * t->c, determinant * t->a,
 			determinant * (t->c * t->ty - t->d * t->tx), determinant * (t->b * t->tx - t->a * t->ty)};
 		return it;
 	}
-	void subfill(gpu::Target* target, const subpath_t& path, const SDL_Color& color);
-	void subfill_pattern(gpu::Target* target, const subpath_t& path, Pattern* pattern, float texture_x, float texture_y);
-	void subfill_gradient(gpu::Target* target, const subpath_t& path, void* gradient, int gradientType);
-	void substroke(gpu::Target* target, const subpath_t& path, const SDL_Color& color);
-	void substroke_pattern(gpu::Target* target, const subpath_t& path, Pattern* pattern, float texture_x, float texture_y);
-	void substroke_gradient(gpu::Target* target, const subpath_t& path, void* gradient, int gradientType);
 private:	
 	std::vector<subpath_t> _paths;
 	subpath_t _currentPath;
 	GPU_Point _currentPoint;
 	GPU_Point _startPoint;
 	bool _hasStartPoint;
+	float _flattenScale;
+	FillMesh _fillMesh;
+	int _fillMeshRule;	// -1 if _fillMesh is stale
+	FillMesh _strokeMesh;
+	StrokeStyle _strokeMeshStyle;
+	bool _strokeMeshValid;
 };
 
 NS_REK_END
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "path_2d.h"
+
+NS_REK_BEGIN
+
+// flatten again when drawn this much larger than flattened for, curves would look polygonal
+#define PATH2D_MAX_UPSCALE 1.25f
+// or this much smaller, they would carry needless points
+#define PATH2D_MAX_DOWNSCALE 4.0f
+
+static JSClass path2d_class = {
+	"Path2D", JSCLASS_HAS_PRIVATE,
+	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+	ObjectWrap::destructor
+};
+void Path2D::jsb_register(JSContext *ctx, JS::HandleObject parent)
+{
+	static JSFunctionSpec path2d_funcs[] = {
+		JS_FUNC_DEF(Path2D, addPath),
+		JS_FUNC_DEF(Path2D, closePath),
+		JS_FUNC_DEF(Path2D, moveTo),
+		JS_FUNC_DEF(Path2D, lineTo),
+		JS_FUNC_DEF(Path2D, bezierCurveTo),
+		JS_FUNC_DEF(Path2D, quadraticCurveTo),
+		JS_FUNC_DEF(Path2D, arc),
+		JS_FUNC_DEF(Path2D, arcTo),
+		JS_FUNC_DEF(Path2D, rect),
+		JS_FS_END
+	};
+	JS_InitClass(ctx, parent, nullptr, &path2d_class, Path2D::constructor, 0, 0, path2d_funcs, 0, 0);
+}
+bool Path2D::is_js_instance(JS::HandleObject obj)
+{
+	return JS_GetClass(obj) == &path2d_class;
+}
+
+Path2D::Path2D()
+: _flattenScale(0)
+{
+}
+Path2D::~Path2D()
+{
+}
+
+bool Path2D::constructor(JSContext *ctx, unsigned argc, JS::Value *vp)
+{
+	JS_BEGIN_ARG;
+	JS::RootedObject obj(ctx, JS_NewObjectForConstructor(ctx, &path2d_class, args));
+	Path2D* path = new Path2D();
+	if (argc > 0 && args[0].isObject()) { // new Path2D(path)
+		JS::RootedObject other(ctx, &args[0].toObject());
+		if (is_js_instance(other)) path->_commands = ((Path2D*)JS_GetPrivate(other))->_commands;
+	}
+	else if (argc > 0) {
+		SDL_LogError(0, "Path2D from SVG path data is not supported");
+	}
+	path->wrap(ctx, obj);
+	JS_RET(obj);
+}
+
+void Path2D::record(PathCommandType type, float a0, float a1, float a2, float a3, float a4, float a5)
+{
+	command_t command = { type, { a0, a1, a2, a3, a4, a5 } };
+	_commands.push_back(command);
+	_flattenScale = 0;
+}
+
+void Path2D::flatten(const AffineTransform* transform)
+{
+	float scale = sqrtf(transform->a * transform->a + transform->c * transform->c);
+	if (scale <= 0) scale = 1;
+	if (_flattenScale > 0 && scale <= _flattenScale * PATH2D_MAX_UPSCALE && scale * PATH2D_MAX_DOWNSCALE >= _flattenScale) return;
+	AffineTransform identity = gpu::AffineTransformMakeIdentity();
+	_flattened.beginPath();
+	_flattened.setFlattenScale(scale);
+	for (const auto& cmd : _commands) {
+		const float* a = cmd.args;
+		switch (cmd.type) {
+		case kPathClosePath:
+			_flattened.closePath();
+			break;
+		case kPathMoveTo:
+			_flattened.moveTo(a[0], a[1], &identity);
+			break;
+		case kPathLineTo:
+			_flattened.lineTo(a[0], a[1], &identity);
+			break;
+		case kPathBezierCurveTo:
+			_flattened.bezierCurveTo(a[0], a[1], a[2], a[3], a[4], a[5], &identity);
+			break;
+		case kPathQuadraticCurveTo:
+			_flattened.quadraticCurveTo(a[0], a[1], a[2], a[3], &identity);
+			break;
+		case kPathArc:
+			_flattened.arc(a[0], a[1], a[2], a[3], a[4], a[5] != 0, &identity);
+			break;
+		case kPathArcTo:
+			_flattened.arcTo(a[0], a[1], a[2], a[3], a[4], &identity);
+			break;
+		}
+	}
+	_flattenScale = scale;
+}
+
+const FillMesh& Path2D::transformedFillMesh(const AffineTransform* transform, FillRule rule)
+{
+	flatten(transform);
+	return transformMesh(_flattened.getFillMesh(rule), transform);
+}
+
+const FillMesh& Path2D::transformedStrokeMesh(const AffineTransform* transform, const StrokeStyle& style)
+{
+	// stroked in path space, so the outline follows non-uniform scales and skews
+	flatten(transform);
+	return transformMesh(_flattened.getStrokeMesh(style), transform);
+}
+
+const FillMesh& Path2D::transformMesh(const FillMesh& mesh, const AffineTransform* transform)
+{
+	_transformedMesh.indices = mesh.indices;
+	_transformedMesh.vertices.resize(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); i += 2) {
+		const auto& p = gpu::PointApplyAffineTransform(mesh.vertices[i], mesh.vertices[i + 1], transform);
+		_transformedMesh.vertices[i] = p.x;
+		_transformedMesh.vertices[i + 1] = p.y;
+	}
+	return _transformedMesh;
+}
+
+JS_FUNC_IMPL(Path2D, addPath)
+{
+	JS_BEGIN_ARG_THIS(Path2D);
+	JS_ROOT_OBJECT_ARG(obj, 0);
+	if (!obj || !is_js_instance(obj)) JS_FAIL("Parameter 1 is not of type 'Path2D'");
+	if (argc > 1) SDL_LogError(0, "Path2D.addPath with a transform is not supported");
+	auto& commands = ((Path2D*)JS_GetPrivate(obj))->_commands;
+	std::vector<command_t> added(commands);	// copied first, a path may be added to itself
+	pthis->_commands.insert(pthis->_commands.end(), added.begin(), added.end());
+	pthis->_flattenScale = 0;
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Path2D, closePath)
+{
+	JS_BEGIN_ARG_THIS(Path2D);
+	pthis->record(kPathClosePath);
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Path2D, moveTo)
+{
+	JS_BEGIN_ARG_THIS(Path2D);
+	JS_DOUBLE_ARG(x, 0);
+	JS_DOUBLE_ARG(y, 1);
+	pthis->record(kPathMoveTo, x, y);
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Path2D, lineTo)
+{
+	JS_BEGIN_ARG_THIS(Path2D);
+	JS_DOUBLE_ARG(x, 0);
+	JS_DOUBLE_ARG(y, 1);
+	pthis->record(kPathLineTo, x, y);
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Path2D, bezierCurveTo)
+{
+	JS_BEGIN_ARG_THIS(Path2D);
+	JS_DOUBLE_ARG(cpx1, 0);
+	JS_DOUBLE_ARG(cpy1, 1);
+	JS_DOUBLE_ARG(cpx2, 2);
+	JS_DOUBLE_ARG(cpy2, 3);
+	JS_DOUBLE_ARG(x, 4);
+	JS_DOUBLE_ARG(y, 5);
+	pthis->record(kPathBezierCurveTo, cpx1, cpy1, cpx2, cpy2, x, y);
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Path2D, quadraticCurveTo)
+{
+	JS_BEGIN_ARG_THIS(Path2D);
+	JS_DOUBLE_ARG(cpx, 0);
+	JS_DOUBLE_ARG(cpy, 1);
+	JS_DOUBLE_ARG(x, 2);
+	JS_DOUBLE_ARG(y, 3);
+	pthis->record(kPathQuadraticCurveTo, cpx, cpy, x, y);
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Path2D, arc)
+{
+	JS_BEGIN_ARG_THIS(Path2D);
+	JS_DOUBLE_ARG(x, 0);
+	JS_DOUBLE_ARG(y, 1);
+	JS_DOUBLE_ARG(radius, 2);
+	JS_DOUBLE_ARG(startangle, 3);
+	JS_DOUBLE_ARG(endangle, 4);
+	JS_BOOL_ARG(counterclockwise, 5);
+	pthis->record(kPathArc, x, y, radius, startangle, endangle, counterclockwise ? 1 : 0);
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Path2D, arcTo)
+{
+	JS_BEGIN_ARG_THIS(Path2D);
+	JS_DOUBLE_ARG(x1, 0);
+	JS_DOUBLE_ARG(y1, 1);
+	JS_DOUBLE_ARG(x2, 2);
+	JS_DOUBLE_ARG(y2, 3);
+	JS_DOUBLE_ARG(radius, 4);
+	pthis->record(kPathArcTo, x1, y1, x2, y2, radius);
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Path2D, rect)
+{
+	JS_BEGIN_ARG_THIS(Path2D);
+	JS_DOUBLE_ARG(x, 0);
+	JS_DOUBLE_ARG(y, 1);
+	JS_DOUBLE_ARG(w, 2);
+	JS_DOUBLE_ARG(h, 3);
+	pthis->record(kPathMoveTo, x, y);
+	pthis->record(kPathLineTo, x + w, y);
+	pthis->record(kPathLineTo, x + w, y + h);
+	pthis->record(kPathLineTo, x, y + h);
+	pthis->record(kPathClosePath);
+	JS_RETURN;
+}
+
+NS_REK_END
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "rekka.h"
+#include "path.h"
+#include "script_core.h"
+
+NS_REK_BEGIN
+
+// A path built once and drawn many times, e.g. a gauge or a rounded window frame.
+// Commands are recorded in path space, flattened and tessellated on first use,
+// later draws only transform the cached points.
+class Path2D : public ObjectWrap {
+public:
+	Path2D();
+	~Path2D();
+	static void jsb_register(JSContext *ctx, JS::HandleObject parent);
+	static bool is_js_instance(JS::HandleObject obj);
+	// the tessellated fill area in target space, valid until the next call
+	const FillMesh& transformedFillMesh(const AffineTransform* transform, FillRule rule);
+	// the outline in target space, style.width is in path space, valid until the next call
+	const FillMesh& transformedStrokeMesh(const AffineTransform* transform, const StrokeStyle& style);
+private:
+	static bool constructor(JSContext *ctx, unsigned argc, JS::Value *vp);
+	JS_FUNC_DECL(addPath)
+	JS_FUNC_DECL(closePath)
+	JS_FUNC_DECL(moveTo)
+	JS_FUNC_DECL(lineTo)
+	JS_FUNC_DECL(bezierCurveTo)
+	JS_FUNC_DECL(quadraticCurveTo)
+	JS_FUNC_DECL(arc)
+	JS_FUNC_DECL(arcTo)
+	JS_FUNC_DECL(rect)
+private:
+	typedef enum {
+		kPathClosePath = 0,
+		kPathMoveTo,
+		kPathLineTo,
+		kPathBezierCurveTo,
+		kPathQuadraticCurveTo,
+		kPathArc,
+		kPathArcTo
+	} PathCommandType;
+	struct command_t {
+		PathCommandType type;
+		float args[6];
+	};
+	void record(PathCommandType type, float a0 = 0, float a1 = 0, float a2 = 0, float a3 = 0, float a4 = 0, float a5 = 0);
+	void flatten(const AffineTransform* transform);
+	const FillMesh& transformMesh(const FillMesh& mesh, const AffineTransform* transform);
+private:
+	std::vector<command_t> _commands;
+	Path _flattened;	// in path space
+	FillMesh _transformedMesh;
+	float _flattenScale;	// 0 if _flattened is stale
+};
+
+NS_REK_END
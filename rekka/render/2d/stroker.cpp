@@ -0,0 +1,213 @@
+#include "stroker.h"
+
+NS_REK_BEGIN
+
+// points closer than this are merged, px
+#define STROKER_POINT_EPSILON 1.0e-4f
+#define STROKER_COLLINEARITY_EPSILON 1.0e-6f
+#define STROKER_STEPS_FOR_CIRCLE 48.0f
+
+bool Stroker::reserve(FillMesh& mesh, size_t vertices)
+{
+	if (mesh.vertices.size() / 2 + vertices > FILL_MESH_MAX_VERTICES) {
+		_overflow = true;
+		return false;
+	}
+	return true;
+}
+
+unsigned short Stroker::vertex(FillMesh& mesh, float x, float y)
+{
+	mesh.vertices.push_back(x);
+	mesh.vertices.push_back(y);
+	return (unsigned short)(mesh.vertices.size() / 2 - 1);
+}
+
+void Stroker::triangle(FillMesh& mesh, unsigned short a, unsigned short b, unsigned short c)
+{
+	mesh.indices.push_back(a);
+	mesh.indices.push_back(b);
+	mesh.indices.push_back(c);
+}
+
+void Stroker::arc(const GPU_Point& center, const GPU_Point& fanCenter, float angle0, float angle1, FillMesh& mesh)
+{
+	float span = angle1 - angle0;
+	int steps = (int)ceilf(fabsf(span) * (STROKER_STEPS_FOR_CIRCLE / (2 * M_PI)));
+	if (steps < 1) steps = 1;
+	if (!reserve(mesh, steps + 2)) return;
+	float step = span / steps;
+	unsigned short c = vertex(mesh, fanCenter.x, fanCenter.y);
+	unsigned short last = vertex(mesh, center.x + cosf(angle0) * _halfWidth, center.y + sinf(angle0) * _halfWidth);
+	for (int i = 1; i <= steps; i++) {
+		float angle = angle0 + step * i;
+		unsigned short v = vertex(mesh, center.x + cosf(angle) * _halfWidth, center.y + sinf(angle) * _halfWidth);
+		triangle(mesh, c, last, v);
+		last = v;
+	}
+}
+
+void Stroker::prepareJoint(size_t i, const dir_t& d0, float len0, const dir_t& d1, float len1)
+{
+	joint_t& joint = _joints[i];
+	joint.trimmed = false;
+	float cross = d0.x * d1.y - d0.y * d1.x;
+	float dot = d0.x * d1.x + d0.y * d1.y;
+	if (fabsf(cross) < STROKER_COLLINEARITY_EPSILON) {
+		joint.side = dot > 0 ? 0 : 1; // straight on, or a U-turn
+		return;
+	}
+	// the segment quads leave a gap on the outer side of the turn
+	joint.side = cross > 0 ? -1.0f : 1.0f;
+	// and cross on the inner side, at half width / cos(half the turn) from the point
+	float mx = (-d0.y - d1.y) * joint.side, my = (d0.x + d1.x) * joint.side;
+	float mlen = sqrtf(mx * mx + my * my);
+	float cosHalf = (mx * -d0.y + my * d0.x) * joint.side / mlen;
+	float dist = _halfWidth / cosHalf;
+	const GPU_Point& p = _points[i];
+	GPU_Point inner = { p.x - mx / mlen * dist, p.y - my / mlen * dist };
+	// usable if the cut stays within the first half of both segments
+	float back = -((inner.x - p.x) * d0.x + (inner.y - p.y) * d0.y);
+	float ahead = (inner.x - p.x) * d1.x + (inner.y - p.y) * d1.y;
+	if (back >= 0 && back <= len0 / 2 && ahead >= 0 && ahead <= len1 / 2) {
+		joint.trimmed = true;
+		joint.inner = inner;
+	}
+}
+
+void Stroker::join(const GPU_Point& p, const joint_t& joint, const dir_t& d0, const dir_t& d1, FillMesh& mesh)
+{
+	if (joint.side == 0) return;
+	float n0x = -d0.y * joint.side, n0y = d0.x * joint.side;
+	float n1x = -d1.y * joint.side, n1y = d1.x * joint.side;
+	const GPU_Point& center = joint.trimmed ? joint.inner : p;
+	if (_style.join == kLineJoinRound) {
+		float angle0 = atan2f(n0y, n0x);
+		float angle1 = atan2f(n1y, n1x);
+		// the short way round, through the outer side
+		if (angle1 - angle0 > M_PI) angle1 -= 2 * M_PI;
+		else if (angle0 - angle1 > M_PI) angle1 += 2 * M_PI;
+		arc(p, center, angle0, angle1, mesh);
+		return;
+	}
+	if (!reserve(mesh, 4)) return;
+	unsigned short c = vertex(mesh, center.x, center.y);
+	unsigned short a = vertex(mesh, p.x + n0x * _halfWidth, p.y + n0y * _halfWidth);
+	unsigned short b = vertex(mesh, p.x + n1x * _halfWidth, p.y + n1y * _halfWidth);
+	if (_style.join == kLineJoinMiter) {
+		// the tip is 1 / cos(half the turn) half widths away
+		float mx = n0x + n1x, my = n0y + n1y;
+		float mlen = sqrtf(mx * mx + my * my);
+		if (mlen > STROKER_COLLINEARITY_EPSILON) {
+			mx /= mlen; my /= mlen;
+			float cosHalf = mx * n0x + my * n0y;
+			float ratio = 1.0f / cosHalf;
+			if (cosHalf > 0 && ratio <= _style.miterLimit) {
+				unsigned short tip = vertex(mesh, p.x + mx * _halfWidth * ratio, p.y + my * _halfWidth * ratio);
+				triangle(mesh, c, a, tip);
+				triangle(mesh, c, tip, b);
+				return;
+			}
+		}
+	}
+	triangle(mesh, c, a, b); // bevel
+}
+
+void Stroker::cap(const GPU_Point& p, const dir_t& d, FillMesh& mesh)
+{
+	float nx = -d.y * _halfWidth, ny = d.x * _halfWidth;
+	if (_style.cap == kLineCapSquare) {
+		if (!reserve(mesh, 4)) return;
+		float ex = d.x * _halfWidth, ey = d.y * _halfWidth;
+		unsigned short a = vertex(mesh, p.x + nx, p.y + ny);
+		unsigned short b = vertex(mesh, p.x - nx, p.y - ny);
+		unsigned short c = vertex(mesh, p.x - nx + ex, p.y - ny + ey);
+		unsigned short e = vertex(mesh, p.x + nx + ex, p.y + ny + ey);
+		triangle(mesh, a, b, c);
+		triangle(mesh, a, c, e);
+	}
+	else if (_style.cap == kLineCapRound) {
+		// from the normal through the outward direction to the opposite normal
+		float angle = atan2f(ny, nx);
+		arc(p, p, angle, angle - M_PI, mesh);
+	}
+}
+
+void Stroker::stroke(const GPU_Point* points, size_t count, bool closed, const StrokeStyle& style, FillMesh& mesh)
+{
+	_style = style;
+	_halfWidth = style.width / 2;
+	_overflow = false;
+	if (_halfWidth <= 0) return;
+	_points.clear();
+	for (size_t i = 0; i < count; i++) {
+		if (!_points.empty()) {
+			const GPU_Point& last = _points.back();
+			if (fabsf(points[i].x - last.x) < STROKER_POINT_EPSILON && fabsf(points[i].y - last.y) < STROKER_POINT_EPSILON) continue;
+		}
+		_points.push_back(points[i]);
+	}
+	if (closed && _points.size() > 2) {
+		const GPU_Point& first = _points.front();
+		const GPU_Point& last = _points.back();
+		if (fabsf(first.x - last.x) < STROKER_POINT_EPSILON && fabsf(first.y - last.y) < STROKER_POINT_EPSILON) _points.pop_back();
+	}
+	size_t n = _points.size();
+	if (n < 2) return;
+	if (n == 2) closed = false;
+	size_t numSegments = closed ? n : n - 1;
+	_dirs.resize(numSegments);
+	_lengths.resize(numSegments);
+	for (size_t i = 0; i < numSegments; i++) {
+		const GPU_Point& p = _points[i];
+		const GPU_Point& q = _points[(i + 1) % n];
+		float dx = q.x - p.x, dy = q.y - p.y;
+		float len = sqrtf(dx * dx + dy * dy);
+		_dirs[i].x = dx / len;
+		_dirs[i].y = dy / len;
+		_lengths[i] = len;
+	}
+	// joint i is between segments i - 1 and i, open polylines have none at the ends
+	_joints.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		if (!closed && (i == 0 || i == n - 1)) {
+			_joints[i].side = 0;
+			_joints[i].trimmed = false;
+			continue;
+		}
+		size_t prev = (i + numSegments - 1) % numSegments;
+		prepareJoint(i, _dirs[prev], _lengths[prev], _dirs[i], _lengths[i]);
+	}
+	for (size_t i = 0; i < numSegments && !_overflow; i++) {
+		if (!reserve(mesh, 4)) break;
+		const GPU_Point& p = _points[i];
+		const GPU_Point& q = _points[(i + 1) % n];
+		const joint_t& start = _joints[i];
+		const joint_t& end = _joints[(i + 1) % n];
+		float nx = -_dirs[i].y * _halfWidth, ny = _dirs[i].x * _halfWidth;
+		GPU_Point startLeft = { p.x + nx, p.y + ny }, startRight = { p.x - nx, p.y - ny };
+		GPU_Point endLeft = { q.x + nx, q.y + ny }, endRight = { q.x - nx, q.y - ny };
+		// the inner side is opposite to the outer one
+		if (start.trimmed) (start.side > 0 ? startRight : startLeft) = start.inner;
+		if (end.trimmed) (end.side > 0 ? endRight : endLeft) = end.inner;
+		unsigned short a = vertex(mesh, startLeft.x, startLeft.y);
+		unsigned short b = vertex(mesh, startRight.x, startRight.y);
+		unsigned short c = vertex(mesh, endRight.x, endRight.y);
+		unsigned short d = vertex(mesh, endLeft.x, endLeft.y);
+		triangle(mesh, a, b, c);
+		triangle(mesh, a, c, d);
+	}
+	for (size_t i = 0; i < n && !_overflow; i++) {
+		if (_joints[i].side == 0) continue;
+		size_t prev = (i + numSegments - 1) % numSegments;
+		join(_points[i], _joints[i], _dirs[prev], _dirs[i], mesh);
+	}
+	if (!closed && !_overflow) {
+		dir_t back = { -_dirs[0].x, -_dirs[0].y };
+		cap(_points[0], back, mesh);
+		cap(_points[n - 1], _dirs[numSegments - 1], mesh);
+	}
+	if (_overflow) SDL_LogError(0, "Path is too complex to stroke, %d vertices at most", FILL_MESH_MAX_VERTICES);
+}
+
+NS_REK_END
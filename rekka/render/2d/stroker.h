@@ -0,0 +1,72 @@
+#pragma once
+
+#include "rekka.h"
+#include "tessellator.h"
+
+NS_REK_BEGIN
+
+typedef enum {
+	kLineCapButt = 0,
+	kLineCapRound,
+	kLineCapSquare
+} LineCap;
+static const char *_lineCap_enum_names[] = {
+	"butt",
+	"round",
+	"square",
+	nullptr
+};
+
+typedef enum {
+	kLineJoinMiter = 0,
+	kLineJoinBevel,
+	kLineJoinRound
+} LineJoin;
+static const char *_lineJoin_enum_names[] = {
+	"miter",
+	"bevel",
+	"round",
+	nullptr
+};
+
+struct StrokeStyle {
+	float width;
+	LineCap cap;
+	LineJoin join;
+	float miterLimit;
+	bool operator==(const StrokeStyle& other) const {
+		return width == other.width && cap == other.cap && join == other.join && miterLimit == other.miterLimit;
+	}
+};
+
+// Turns polylines into one triangle mesh: a quad per segment, a wedge on the outer
+// side of each join and the caps of open polylines. On the inner side of a join the
+// segments are cut where they meet, so translucent strokes blend evenly.
+class Stroker {
+public:
+	void stroke(const GPU_Point* points, size_t count, bool closed, const StrokeStyle& style, FillMesh& mesh);
+private:
+	struct dir_t { float x, y; };
+	struct joint_t {
+		float side;		// 0 straight on, -1 the outer side is along the right normal, 1 the left
+		bool trimmed;	// the inner sides of the segments end at inner instead of overlapping
+		GPU_Point inner;
+	};
+	void prepareJoint(size_t i, const dir_t& d0, float len0, const dir_t& d1, float len1);
+	void join(const GPU_Point& p, const joint_t& joint, const dir_t& d0, const dir_t& d1, FillMesh& mesh);
+	void cap(const GPU_Point& p, const dir_t& d, FillMesh& mesh);	// d points out of the line
+	void arc(const GPU_Point& center, const GPU_Point& fanCenter, float angle0, float angle1, FillMesh& mesh);
+	bool reserve(FillMesh& mesh, size_t vertices);
+	unsigned short vertex(FillMesh& mesh, float x, float y);
+	void triangle(FillMesh& mesh, unsigned short a, unsigned short b, unsigned short c);
+private:
+	StrokeStyle _style;
+	float _halfWidth;
+	std::vector<GPU_Point> _points;
+	std::vector<dir_t> _dirs;
+	std::vector<float> _lengths;
+	std::vector<joint_t> _joints;
+	bool _overflow;
+};
+
+NS_REK_END
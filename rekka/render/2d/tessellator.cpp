@@ -0,0 +1,167 @@
+#include "tessellator.h"
+#include <algorithm>
+
+NS_REK_BEGIN
+
+// crossings closer than this to a slab boundary don't split it, px
+#define TESSELLATOR_MIN_SLAB 1.0e-3
+#define TESSELLATOR_MAX_SPLITS 8
+
+void Tessellator::addContour(const GPU_Point* points, size_t count)
+{
+	if (count < 3) return;
+	for (size_t i = 0; i < count; i++) {
+		const GPU_Point& p = points[i];
+		const GPU_Point& q = points[i + 1 < count ? i + 1 : 0];
+		if (p.y == q.y) continue; // horizontal edges bound no span
+		edge_t edge;
+		const GPU_Point& top = p.y < q.y ? p : q;
+		const GPU_Point& bottom = p.y < q.y ? q : p;
+		edge.x0 = top.x;
+		edge.y0 = top.y;
+		edge.y1 = bottom.y;
+		edge.dxdy = ((double)bottom.x - top.x) / ((double)bottom.y - top.y);
+		edge.winding = p.y < q.y ? 1 : -1;
+		_edges.push_back(edge);
+	}
+}
+
+bool Tessellator::isConvex(const GPU_Point* points, size_t count)
+{
+	if (count < 3) return false;
+	int sign = 0;
+	int xflips = 0, yflips = 0;
+	float lastdx = 0, lastdy = 0;
+	for (size_t i = 0; i < count + 1; i++) {
+		const GPU_Point& p = points[i % count];
+		const GPU_Point& q = points[(i + 1) % count];
+		const GPU_Point& r = points[(i + 2) % count];
+		float dx = q.x - p.x, dy = q.y - p.y;
+		float cross = dx * (r.y - q.y) - dy * (r.x - q.x);
+		if (cross != 0) {
+			int s = cross > 0 ? 1 : -1;
+			if (sign != 0 && s != sign) return false;
+			sign = s;
+		}
+		// a convex contour turns around once, its direction flips sign twice on each axis
+		if (i < count) {
+			if (dx != 0) {
+				if (lastdx != 0 && (dx > 0) != (lastdx > 0)) xflips++;
+				lastdx = dx;
+			}
+			if (dy != 0) {
+				if (lastdy != 0 && (dy > 0) != (lastdy > 0)) yflips++;
+				lastdy = dy;
+			}
+		}
+	}
+	return sign != 0 && xflips <= 2 && yflips <= 2;
+}
+
+void Tessellator::emit(const span_t& span, double bottom, FillMesh& mesh)
+{
+	if (bottom <= span.top) return;
+	size_t base = mesh.vertices.size() / 2;
+	if (base + 4 > FILL_MESH_MAX_VERTICES) {
+		_overflow = true;
+		return;
+	}
+	const edge_t& left = _edges[span.left];
+	const edge_t& right = _edges[span.right];
+	float quad[] = {
+		(float)left.xAt(span.top), (float)span.top,
+		(float)right.xAt(span.top), (float)span.top,
+		(float)right.xAt(bottom), (float)bottom,
+		(float)left.xAt(bottom), (float)bottom
+	};
+	mesh.vertices.insert(mesh.vertices.end(), quad, quad + 8);
+	unsigned short indices[] = {
+		(unsigned short)base, (unsigned short)(base + 1), (unsigned short)(base + 2),
+		(unsigned short)base, (unsigned short)(base + 2), (unsigned short)(base + 3)
+	};
+	mesh.indices.insert(mesh.indices.end(), indices, indices + 6);
+}
+
+void Tessellator::tessellate(FillRule rule, FillMesh& mesh)
+{
+	mesh.clear();
+	_overflow = false;
+	if (_edges.empty()) return;
+	std::sort(_edges.begin(), _edges.end(), [](const edge_t& a, const edge_t& b) { return a.y0 < b.y0; });
+	_ys.clear();
+	for (const auto& edge : _edges) {
+		_ys.push_back(edge.y0);
+		_ys.push_back(edge.y1);
+	}
+	std::sort(_ys.begin(), _ys.end());
+	_ys.erase(std::unique(_ys.begin(), _ys.end()), _ys.end());
+
+	_active.clear();
+	_spans.clear();
+	size_t nextEdge = 0, nextY = 0;
+	double y = _ys[0];
+	while (true) {
+		_active.erase(std::remove_if(_active.begin(), _active.end(), [this, y](int e) { return _edges[e].y1 <= y; }), _active.end());
+		while (nextEdge < _edges.size() && _edges[nextEdge].y0 <= y) {
+			if (_edges[nextEdge].y1 > y) _active.push_back((int)nextEdge);
+			nextEdge++;
+		}
+		while (nextY < _ys.size() && _ys[nextY] <= y) nextY++;
+		if (nextY == _ys.size()) break;
+		double bottom = _ys[nextY];
+
+		// order the edges in the middle of the slab, then move the bottom up to
+		// the first crossing of neighbours, so the order holds for the whole slab
+		for (int split = 0; split < TESSELLATOR_MAX_SPLITS; split++) {
+			double middle = (y + bottom) * 0.5;
+			_order.clear();
+			for (int e : _active) _order.push_back(std::make_pair(_edges[e].xAt(middle), e));
+			std::sort(_order.begin(), _order.end());
+			double crossing = bottom;
+			for (size_t i = 0; i + 1 < _order.size(); i++) {
+				const edge_t& a = _edges[_order[i].second];
+				const edge_t& b = _edges[_order[i + 1].second];
+				double dtop = a.xAt(y) - b.xAt(y);
+				double dbottom = a.xAt(bottom) - b.xAt(bottom);
+				if (dtop <= 0 && dbottom <= 0) continue;
+				double yc = y - dtop / (a.dxdy - b.dxdy);
+				if (yc > y + TESSELLATOR_MIN_SLAB && yc < crossing - TESSELLATOR_MIN_SLAB) crossing = yc;
+			}
+			if (crossing == bottom) break;
+			bottom = crossing;
+		}
+
+		_nextSpans.clear();
+		int winding = 0;
+		int left = -1;
+		for (const auto& item : _order) {
+			bool wasInside = rule == kFillRuleNonZero ? winding != 0 : (winding & 1) != 0;
+			winding += _edges[item.second].winding;
+			bool inside = rule == kFillRuleNonZero ? winding != 0 : (winding & 1) != 0;
+			if (!wasInside && inside) {
+				left = item.second;
+			}
+			else if (wasInside && !inside) {
+				span_t span = { left, item.second, y };
+				// continue the trapezoid of the slab above if it has the same sides
+				for (auto& above : _spans) {
+					if (above.left == span.left && above.right == span.right) {
+						span.top = above.top;
+						above.left = -1;
+						break;
+					}
+				}
+				_nextSpans.push_back(span);
+			}
+		}
+		for (const auto& above : _spans) {
+			if (above.left >= 0) emit(above, y, mesh);
+		}
+		_spans.swap(_nextSpans);
+		y = bottom;
+	}
+	for (const auto& above : _spans) emit(above, y, mesh);
+	if (_overflow) SDL_LogError(0, "Path is too complex to fill, %d vertices at most", FILL_MESH_MAX_VERTICES);
+}
+
+NS_REK_END
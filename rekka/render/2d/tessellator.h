@@ -0,0 +1,62 @@
+#pragma once
+
+#include "rekka.h"
+
+NS_REK_BEGIN
+
+typedef enum {
+	kFillRuleNonZero = 0,
+	kFillRuleEvenOdd
+} FillRule;
+static const char *_fillRule_enum_names[] = {
+	"nonzero",
+	"evenodd",
+	nullptr
+};
+
+// gpu::TrianglesFilled takes at most 60000 vertices
+#define FILL_MESH_MAX_VERTICES 60000
+
+// Indexed triangle list, as taken by gpu::TrianglesFilled
+struct FillMesh {
+	std::vector<float> vertices;	// x, y pairs
+	std::vector<unsigned short> indices;
+	void clear() { vertices.clear(); indices.clear(); }
+};
+
+// Scanline tessellator: the contours are cut into horizontal slabs at every vertex
+// and every edge crossing, inside a slab no edges cross, so the spans between them
+// are trapezoids whose insideness follows from the winding numbers.
+// Handles concave, self-intersecting and multiple contours under both fill rules.
+class Tessellator {
+public:
+	void beginContours() { _edges.clear(); }
+	// the contour is closed implicitly
+	void addContour(const GPU_Point* points, size_t count);
+	void tessellate(FillRule rule, FillMesh& mesh);
+	// a single convex contour, drawn as a triangle fan without tessellating
+	static bool isConvex(const GPU_Point* points, size_t count);
+private:
+	struct edge_t {
+		double x0, y0;	// top
+		double y1;		// bottom
+		double dxdy;
+		int winding;	// +1 downwards, -1 upwards
+		double xAt(double y) const { return x0 + (y - y0) * dxdy; }
+	};
+	struct span_t {
+		int left, right;	// edges
+		double top;
+	};
+	void emit(const span_t& span, double bottom, FillMesh& mesh);
+private:
+	std::vector<edge_t> _edges;
+	std::vector<double> _ys;
+	std::vector<int> _active;
+	std::vector<std::pair<double, int> > _order;
+	std::vector<span_t> _spans;
+	std::vector<span_t> _nextSpans;
+	bool _overflow;
+};
+
+NS_REK_END
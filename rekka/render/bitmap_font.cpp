@@ -0,0 +1,158 @@
+#include "bitmap_font.h"
+#include "image_manager.h"
+
+NS_REK_BEGIN
+
+// page ids of a descriptor are small, a larger one is taken as malformed
+#define BITMAP_FONT_MAX_PAGES 256
+
+typedef std::vector<std::pair<std::string, std::string>> Attributes;
+
+// one line of "tag key=value key="quoted value" ...", returns the start of the next line
+static const char* parseLine(const char* p, const char* end, std::string& tag, Attributes& attrs)
+{
+	tag.clear();
+	attrs.clear();
+	while (p < end && (*p == ' ' || *p == '\t')) p++;
+	while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') tag += *p++;
+	while (p < end && *p != '\n') {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+		if (p >= end || *p == '\n') break;
+		std::string key, value;
+		while (p < end && *p != '=' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') key += *p++;
+		if (p < end && *p == '=') {
+			p++;
+			if (p < end && *p == '"') {
+				p++;
+				while (p < end && *p != '"' && *p != '\n') value += *p++;
+				if (p < end && *p == '"') p++;
+			}
+			else {
+				while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') value += *p++;
+			}
+		}
+		attrs.push_back({ key, value });
+	}
+	return p < end ? p + 1 : end;
+}
+
+static const std::string* findAttr(const Attributes& attrs, const char* name)
+{
+	for (auto& attr : attrs) {
+		if (attr.first == name) return &attr.second;
+	}
+	return nullptr;
+}
+
+static int intAttr(const Attributes& attrs, const char* name, int value = 0)
+{
+	const std::string* str = findAttr(attrs, name);
+	return str ? atoi(str->c_str()) : value;
+}
+
+BitmapFont::BitmapFont()
+: _size(0), _lineHeight(0), _base(0)
+{
+}
+
+BitmapFont::~BitmapFont()
+{
+	for (auto page : _pages) {
+		if (page) gpu::FreeImage(page);
+	}
+}
+
+bool BitmapFont::load(const char* fileName)
+{
+	SDL_RWops* rw = SDL_RWFromFile(fileName, "rb");
+	Sint64 size = rw ? SDL_RWsize(rw) : -1;
+	std::vector<char> data(size > 0 ? (size_t)size : 0);
+	bool loaded = size > 0 && SDL_RWread(rw, &data.front(), 1, (size_t)size) == (size_t)size;
+	if (rw) SDL_RWclose(rw);
+	if (!loaded) {
+		SDL_LogError(0, "Failed to load the bitmap font %s: %s", fileName, SDL_GetError());
+		return false;
+	}
+	// sheets are relative to the descriptor
+	std::string dir = fileName;
+	size_t slash = dir.find_last_of("/\\");
+	dir = slash == std::string::npos ? "" : dir.substr(0, slash + 1);
+
+	std::string tag;
+	Attributes attrs;
+	std::vector<std::string> pageFiles;
+	const char* p = &data.front();
+	const char* end = p + data.size();
+	while (p < end) {
+		p = parseLine(p, end, tag, attrs);
+		if (tag == "info") {
+			const std::string* face = findAttr(attrs, "face");
+			if (face) _face = *face;
+			// negative when it matches the character height instead of the cell height
+			_size = abs(intAttr(attrs, "size"));
+		}
+		else if (tag == "common") {
+			_lineHeight = intAttr(attrs, "lineHeight");
+			_base = intAttr(attrs, "base");
+		}
+		else if (tag == "page") {
+			int id = intAttr(attrs, "id", -1);
+			const std::string* file = findAttr(attrs, "file");
+			if (id < 0 || id >= BITMAP_FONT_MAX_PAGES || !file) continue;
+			if ((size_t)id >= pageFiles.size()) pageFiles.resize(id + 1);
+			pageFiles[id] = dir + *file;
+		}
+		else if (tag == "char") {
+			int id = intAttr(attrs, "id", -1);
+			if (id < 0) continue;
+			_glyphs[(Uint32)id] = { intAttr(attrs, "x"), intAttr(attrs, "y"),
+				intAttr(attrs, "width"), intAttr(attrs, "height"),
+				intAttr(attrs, "xoffset"), intAttr(attrs, "yoffset"),
+				intAttr(attrs, "xadvance"), intAttr(attrs, "page") };
+		}
+		else if (tag == "kerning") {
+			Uint64 first = (Uint32)intAttr(attrs, "first"), second = (Uint32)intAttr(attrs, "second");
+			_kernings[first << 32 | second] = intAttr(attrs, "amount");
+		}
+	}
+	if (_glyphs.empty() || pageFiles.empty()) {
+		SDL_LogError(0, "Failed to load the bitmap font %s: no glyphs or pages", fileName);
+		return false;
+	}
+	if (_size == 0) _size = _lineHeight;
+	_pages.resize(pageFiles.size(), nullptr);
+	for (size_t i = 0; i < pageFiles.size(); i++) {
+		if (!pageFiles[i].empty()) fetchPage(i, pageFiles[i]);
+	}
+	return true;
+}
+
+void BitmapFont::fetchPage(int page, const std::string& fileName)
+{
+	ImageManager::getInstance()->fetchImageAsync(fileName, [this, page, fileName](gpu::Image* image) {
+		if (!image) {
+			SDL_LogError(0, "Failed to load the bitmap font page %s", fileName.c_str());
+			return;
+		}
+		// pixel art stays sharp when scaled, glyph quads are placed by their top-left
+		gpu::SetImageFilter(image, gpu::FILTER_NEAREST);
+		image->anchor_fixed = true;
+		gpu::SetAnchor(image, 0, 0);
+		_pages[page] = image;
+	});
+}
+
+const BitmapGlyph* BitmapFont::getGlyph(Uint32 ch) const
+{
+	auto itr = _glyphs.find(ch);
+	return itr == _glyphs.end() ? nullptr : &itr->second;
+}
+
+int BitmapFont::getKerning(Uint32 first, Uint32 second) const
+{
+	if (_kernings.empty()) return 0;
+	auto itr = _kernings.find((Uint64)first << 32 | second);
+	return itr == _kernings.end() ? 0 : itr->second;
+}
+
+NS_REK_END
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "rekka.h"
+#include <unordered_map>
+
+NS_REK_BEGIN
+
+// in pixels of the sheet, offsets from the pen at the top of the line
+struct BitmapGlyph {
+	int x, y;
+	int width, height;
+	int xoffset, yoffset;
+	int xadvance;
+	int page;
+};
+
+// a BMFont text format descriptor and its glyph sheets, drawn without FreeType
+class BitmapFont {
+public:
+	BitmapFont();
+	~BitmapFont();
+	// parses the descriptor, the sheets are fetched by ImageManager and drawn once loaded
+	bool load(const char* fileName);
+	const BitmapGlyph* getGlyph(Uint32 ch) const;
+	int getKerning(Uint32 first, Uint32 second) const;
+	// nullptr until fetched
+	gpu::Image* getPage(int page) const { return page >= 0 && (size_t)page < _pages.size() ? _pages[page] : nullptr; }
+	const std::string& getFace() const { return _face; }
+	int getSize() const { return _size; }
+	int getLineHeight() const { return _lineHeight; }
+	int getBase() const { return _base; }
+private:
+	void fetchPage(int page, const std::string& fileName);
+	std::string _face;
+	int _size;
+	int _lineHeight;
+	int _base;
+	std::unordered_map<Uint32, BitmapGlyph> _glyphs;
+	std::unordered_map<Uint64, int> _kernings;	// by first << 32 | second
+	std::vector<gpu::Image*> _pages;
+};
+
+NS_REK_END
@@ -2,6 +2,7 @@
 #include "core.h"
 #include "2d/context_2d.h"
 #include "image_manager.h"
+#include "texture_pool.h"
 
 
 NS_REK_BEGIN
@@ -72,29 +73,49 @@ Canvas::Canvas(bool offscreen)
 Canvas::~Canvas()
 {
 	SAFE_DELETE(_context);
-	if (_texture) gpu::FreeImage(_texture);	
+	releaseTexture();
+}
+
+void Canvas::releaseTexture()
+{
+	if (!_texture) return;
+	// the target goes with the texture, a new one is made on the next draw
+	TexturePool::getInstance()->release(_texture);
+	_texture = nullptr;
+	_target = nullptr;
+	if (_context) _context->_target = nullptr;
 }
 
 void Canvas::resize()
 {
 	if (_isOffscreen) {
-		if (_texture) {
-			gpu::FreeImage(_texture);
-			_texture = nullptr;
-		}
-		if (_width > 0 && _height > 0) {
-			_texture = gpu::CreateImage(_width, _height, gpu::FORMAT_RGBA);
+		if (TexturePool::getInstance()->fits(_texture, _width, _height) && gpu::SetImageSize(_texture, _width, _height)) {
+			// the same texture, resizing clears the canvas
+			gpu::ClearRGBA(_texture->target, 0, 0, 0, 0);
+			_target = nullptr;
+			if (_context) _context->_target = nullptr;
+			return;
 		}
+		releaseTexture();
 	}
 	else {
 		gpu::SetVirtualResolution(_target, _width, _height);
 	}
 }
 
+gpu::Image* Canvas::getTexture()
+{
+	if (!_texture && _isOffscreen && _width > 0 && _height > 0) {
+		_texture = TexturePool::getInstance()->acquire(_width, _height);
+	}
+	return _texture;
+}
+
 void Canvas::makeTarget()
 {
-	if (!_target && _texture) {
-		_target = gpu::LoadTarget(_texture);
+	if (!_target && getTexture()) {
+		// pooled textures come with their target
+		_target = _texture->target ? _texture->target : gpu::LoadTarget(_texture);
 		if (_context) _context->_target = _target;
 	}
 }
@@ -260,10 +281,7 @@ JS_PROPSET_IMPL(Canvas, src)
 		JS_STRING_ARG(fileName, 0);
 		decodeURIComponent(fileName);		
 		pthis->_src = fileName;
-		if (pthis->_texture) {
-			gpu::FreeImage(pthis->_texture);
-			pthis->_texture = nullptr;
-		}
+		pthis->releaseTexture();
 		pthis->ref(ctx);
 		ImageManager::getInstance()->fetchImageAsync(pthis->_src, std::bind(&Canvas::fetchCallback, pthis, std::placeholders::_1));
 	}
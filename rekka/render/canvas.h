@@ -35,9 +35,12 @@ public:
 private:
 	void resize();
 	void fetchCallback(gpu::Image* image);
+	void releaseTexture();
 public:		
 	gpu::Image* _texture;
 	gpu::Target* _target;
+	// offscreen storage is allocated on the first draw or use as a source
+	gpu::Image* getTexture();
 	void makeTarget();
 private:
 	CanvasContext* _context;
@@ -173,9 +173,10 @@ varying vec2 texCoord;
 uniform sampler2D tex;
 uniform vec2 uvScale;
 uniform vec2 uvOffset;
+uniform vec2 uvExtent;
 void main(void)
 {
-    gl_FragColor = texture2D(tex, fract(texCoord * uvScale + uvOffset)) * color;	
+    gl_FragColor = texture2D(tex, fract(texCoord * uvScale + uvOffset) * uvExtent) * color;	
 }
 )";
 ShaderData _shaderTextureRepeat;
@@ -183,13 +184,16 @@ void CanvasExtra::beginNPOTRepeat(gpu::Target * target, gpu::Image * image, floa
 {
 	uint16_t frame_w = target->w;
 	uint16_t frame_h = target->h;
-	uint16_t tex_w = image->texture_w;
-	uint16_t tex_h = image->texture_h;
-	float uvScale[2] = { (float)frame_w / tex_w, (float)frame_h / tex_h };
-	float uvOffset[2] = { (0 - texture_x) / tex_w, (0 - texture_y) / tex_h };
+	// repeats every image size, only the image part of a padded texture is sampled
+	float image_w = image->w;
+	float image_h = image->h;
+	float uvScale[2] = { frame_w / image_w, frame_h / image_h };
+	float uvOffset[2] = { (0 - texture_x) / image_w, (0 - texture_y) / image_h };
+	float uvExtent[2] = { image_w / image->texture_w, image_h / image->texture_h };
 	gpu::ActivateShaderProgram(_shaderTextureRepeat.program, &_shaderTextureRepeat.block);
 	gpu::SetUniformfv(_shaderTextureRepeat.locations[0], 2, 1, uvScale);
 	gpu::SetUniformfv(_shaderTextureRepeat.locations[1], 2, 1, uvOffset);
+	gpu::SetUniformfv(_shaderTextureRepeat.locations[2], 2, 1, uvExtent);
 }
 
 void CanvasExtra::endNPOTRepeat()
@@ -197,6 +201,125 @@ void CanvasExtra::endNPOTRepeat()
 	gpu::DeactivateShaderProgram();
 }
 
+// variants by the defines RADIAL and MASKED
+const char* gradient_shader_frag = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+varying vec4 color;
+varying vec2 texCoord;
+uniform sampler2D tex;
+#ifdef MASKED
+uniform sampler2D lookup;
+#else
+#define lookup tex
+#endif
+#ifdef RADIAL
+uniform vec3 pointRows[2];
+uniform vec3 start;	// x0, y0, r0
+uniform vec3 delta;	// x1 - x0, y1 - y0, r1 - r0
+#else
+uniform vec3 tRow;
+#endif
+void main(void)
+{
+	vec3 uv = vec3(texCoord, 1.0);
+#ifdef RADIAL
+	// the largest t with |p - center(t)| = radius(t) and radius(t) >= 0
+	vec2 p = vec2(dot(pointRows[0], uv), dot(pointRows[1], uv)) - start.xy;
+	float a = dot(delta.xy, delta.xy) - delta.z * delta.z;
+	float b = dot(p, delta.xy) + start.z * delta.z;
+	float c = dot(p, p) - start.z * start.z;
+	float t;
+	if (abs(a) < 0.000001) {
+		if (abs(b) < 0.000001) discard;
+		t = c / (2.0 * b);
+	}
+	else {
+		float d = b * b - a * c;
+		if (d < 0.0) discard;
+		d = sqrt(d);
+		float t0 = (b + d) / a;
+		float t1 = (b - d) / a;
+		t = max(t0, t1);
+		if (start.z + t * delta.z < 0.0) t = min(t0, t1);
+	}
+	if (start.z + t * delta.z < 0.0) discard;
+#else
+	float t = dot(tRow, uv);
+#endif
+	vec4 clr = texture2D(lookup, vec2(clamp(t, 0.0, 1.0) * (255.0 / 256.0) + 0.5 / 256.0, 0.5));
+	clr.rgb *= clr.a;
+#ifdef MASKED
+	clr *= texture2D(tex, texCoord).a;
+#endif
+	gl_FragColor = clr * color;
+}
+)";
+ShaderData _shaderGradients[4];	// linear, radial, masked linear, masked radial
+static ShaderData* gradientShader(gpu::Image* lookup, bool radial, bool masked)
+{
+	ShaderData* shader = &_shaderGradients[(masked ? 2 : 0) + (radial ? 1 : 0)];
+	if (!shader->program) return nullptr;
+	gpu::ActivateShaderProgram(shader->program, &shader->block);
+	if (masked) gpu::SetShaderImage(lookup, shader->locations[3], 1);
+	return shader;
+}
+
+bool CanvasExtra::beginLinearGradient(gpu::Image* lookup, bool masked, float tRow[3])
+{
+	ShaderData* shader = gradientShader(lookup, false, masked);
+	if (!shader) return false;
+	gpu::SetUniformfv(shader->locations[0], 3, 1, tRow);
+	return true;
+}
+
+bool CanvasExtra::beginRadialGradient(gpu::Image* lookup, bool masked, float pointRows[6], float start[3], float delta[3])
+{
+	ShaderData* shader = gradientShader(lookup, true, masked);
+	if (!shader) return false;
+	gpu::SetUniformfv(shader->locations[0], 3, 2, pointRows);
+	gpu::SetUniformfv(shader->locations[1], 3, 1, start);
+	gpu::SetUniformfv(shader->locations[2], 3, 1, delta);
+	return true;
+}
+
+void CanvasExtra::endGradient()
+{
+	gpu::DeactivateShaderProgram();
+}
+
+const char* distance_field_shader_frag = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+varying vec4 color;
+varying vec2 texCoord;
+uniform sampler2D tex;
+uniform vec2 band;
+uniform float smoothing;
+void main(void)
+{
+	float d = texture2D(tex, texCoord).a;
+	float a = smoothstep(band.x - smoothing, band.x + smoothing, d) - smoothstep(band.y - smoothing, band.y + smoothing, d);
+	gl_FragColor = color * a;
+}
+)";
+ShaderData _shaderDistanceField;
+bool CanvasExtra::beginDistanceField(float band[2], float smoothing)
+{
+	if (!_shaderDistanceField.program) return false;
+	gpu::ActivateShaderProgram(_shaderDistanceField.program, &_shaderDistanceField.block);
+	gpu::SetUniformfv(_shaderDistanceField.locations[0], 2, 1, band);
+	gpu::SetUniformf(_shaderDistanceField.locations[1], smoothing);
+	return true;
+}
+
+void CanvasExtra::endDistanceField()
+{
+	gpu::DeactivateShaderProgram();
+}
+
 bool CanvasExtra::supportNPOTRepeat = true;
 void CanvasExtra::initialize()
 {	
@@ -241,18 +364,54 @@ void CanvasExtra::initialize()
 		_shaderGrayToneBlend.locations[1] = gpu::GetUniformLocation(p, "toneColor");
 	}
 
-	if (!supportNPOTRepeat) {
-		uint32_t texturerepeat_f = gpu::CompileShader(gpu::FRAGMENT_SHADER, texture_repeat_shader_frag);
-		if (texturerepeat_f) {
+	for (int i = 0; i < 4; i++) {
+		bool radial = (i & 1) != 0, masked = (i & 2) != 0;
+		std::string source = std::string(radial ? "#define RADIAL\n" : "") + (masked ? "#define MASKED\n" : "") + gradient_shader_frag;
+		uint32_t gradient_f = gpu::CompileShader(gpu::FRAGMENT_SHADER, source.c_str());
+		if (gradient_f) {
 			uint32_t p = gpu::CreateShaderProgram();
 			gpu::AttachShader(p, v);
-			gpu::AttachShader(p, texturerepeat_f);
+			gpu::AttachShader(p, gradient_f);
 			gpu::LinkShaderProgram(p);
-			_shaderTextureRepeat.program = p;
-			_shaderTextureRepeat.block = gpu::LoadShaderBlock(p, "gpu_Vertex", "gpu_TexCoord", "gpu_Color", "gpu_ModelViewProjectionMatrix");
-			_shaderTextureRepeat.locations[0] = gpu::GetUniformLocation(p, "uvScale");
-			_shaderTextureRepeat.locations[1] = gpu::GetUniformLocation(p, "uvOffset");
+			ShaderData& shader = _shaderGradients[i];
+			shader.program = p;
+			shader.block = gpu::LoadShaderBlock(p, "gpu_Vertex", "gpu_TexCoord", "gpu_Color", "gpu_ModelViewProjectionMatrix");
+			if (radial) {
+				shader.locations[0] = gpu::GetUniformLocation(p, "pointRows");
+				shader.locations[1] = gpu::GetUniformLocation(p, "start");
+				shader.locations[2] = gpu::GetUniformLocation(p, "delta");
+			}
+			else {
+				shader.locations[0] = gpu::GetUniformLocation(p, "tRow");
+			}
+			if (masked) shader.locations[3] = gpu::GetUniformLocation(p, "lookup");
 		}
 	}
+
+	// also for padded textures when NPOT repeat is supported
+	uint32_t texturerepeat_f = gpu::CompileShader(gpu::FRAGMENT_SHADER, texture_repeat_shader_frag);
+	if (texturerepeat_f) {
+		uint32_t p = gpu::CreateShaderProgram();
+		gpu::AttachShader(p, v);
+		gpu::AttachShader(p, texturerepeat_f);
+		gpu::LinkShaderProgram(p);
+		_shaderTextureRepeat.program = p;
+		_shaderTextureRepeat.block = gpu::LoadShaderBlock(p, "gpu_Vertex", "gpu_TexCoord", "gpu_Color", "gpu_ModelViewProjectionMatrix");
+		_shaderTextureRepeat.locations[0] = gpu::GetUniformLocation(p, "uvScale");
+		_shaderTextureRepeat.locations[1] = gpu::GetUniformLocation(p, "uvOffset");
+		_shaderTextureRepeat.locations[2] = gpu::GetUniformLocation(p, "uvExtent");
+	}
+
+	uint32_t distancefield_f = gpu::CompileShader(gpu::FRAGMENT_SHADER, distance_field_shader_frag);
+	if (distancefield_f) {
+		uint32_t p = gpu::CreateShaderProgram();
+		gpu::AttachShader(p, v);
+		gpu::AttachShader(p, distancefield_f);
+		gpu::LinkShaderProgram(p);
+		_shaderDistanceField.program = p;
+		_shaderDistanceField.block = gpu::LoadShaderBlock(p, "gpu_Vertex", "gpu_TexCoord", "gpu_Color", "gpu_ModelViewProjectionMatrix");
+		_shaderDistanceField.locations[0] = gpu::GetUniformLocation(p, "band");
+		_shaderDistanceField.locations[1] = gpu::GetUniformLocation(p, "smoothing");
+	}
 }
 NS_REK_END
\ No newline at end of file
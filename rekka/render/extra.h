@@ -20,6 +20,15 @@ public:
 	static void tintImage(gpu::Image* image, gpu::Target* target, float x, float y, float w, float h, GPU_Color blendColor, GPU_Color toneColor = { 0, 0, 0, 0 });
 	static void beginNPOTRepeat(gpu::Target* target, gpu::Image* image, float texture_x, float texture_y);
 	static void endNPOTRepeat();
+	// t is evaluated per pixel from the texture coordinates and looks up the color in lookup,
+	// masked binds lookup to the 2nd unit and masks it with the alpha of the drawn image
+	static bool beginLinearGradient(gpu::Image* lookup, bool masked, float tRow[3]);
+	static bool beginRadialGradient(gpu::Image* lookup, bool masked, float pointRows[6], float start[3], float delta[3]);
+	static void endGradient();
+	// the drawn image holds distance fields, 0.5 on the outline, covered between band[0] and band[1],
+	// smoothing is half the antialiasing ramp in the same units
+	static bool beginDistanceField(float band[2], float smoothing);
+	static void endDistanceField();
 };
 
 NS_REK_END
\ No newline at end of file
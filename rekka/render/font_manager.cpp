@@ -1,5 +1,8 @@
 #include "font_manager.h"
+#include "scheduler.h"
+#include "trace.h"
 #include <algorithm>
+#include <unordered_set>
 
 NS_REK_BEGIN
 
@@ -10,18 +13,26 @@ FontManager* FontManager::getInstance()
 	return s_sharedFontManager;
 }
 
-FontManager::FontManager() : _time(0)
+FontManager::FontManager()
+: _distanceFieldText(false), _prepareRefCount(0), _prepareDoneSchedulerId(0)
 {
 	TTF_Init();	
 	loadFont("fonts/micross.ttf", "sans-serif");
-	_timeToCheck = TEXT_CACHE_CHECKTIME;
 }
 FontManager::~FontManager()
 {
-	for (auto& itr : _textImageCache) {
-		gpu::FreeImage(itr.second.image);
-	}
 	_textImageCache.clear();
+	for (auto& itr : _glyphAtlases) {
+		delete itr.second;
+	}
+	_glyphAtlases.clear();
+	for (auto& family : _familyTable) {
+		delete family.bitmapFont;
+	}
+	for (auto& itr : _distanceFieldAtlases) {
+		delete itr.second;
+	}
+	_distanceFieldAtlases.clear();
 	for (auto& itr : _fontTable) {
 		TTF_CloseFont(itr.second);
 	}
@@ -30,21 +41,49 @@ FontManager::~FontManager()
 		TTF_CloseFont(itr.second);
 	}
 	_strokeFontTable.clear();
+	for (auto& itr : _workerFonts) {
+		TTF_CloseFont(itr.second);
+	}
+	_workerFonts.clear();
+	for (auto& itr : _workerFaces) {
+		TTF_CloseFontFace(itr.second);
+	}
+	_workerFaces.clear();
+	// the faces read the file data in place
+	for (auto& itr : _fontFiles) {
+		TTF_CloseFontFace(itr.second.face);
+		SDL_free(itr.second.data);
+	}
+	_fontFiles.clear();
 	TTF_Quit();
 }
 
 void FontManager::loadFont(const char * fileName, const char * familyName)
 {
-	if (familyName) {
+	size_t len = strlen(fileName);
+	if (len > 4 && strcasecmp(fileName + len - 4, ".fnt") == 0) {
+		BitmapFont* bmfont = new (std::nothrow) BitmapFont();
+		if (!bmfont) return;
+		if (!bmfont->load(fileName)) {
+			delete bmfont;
+			return;
+		}
+		std::string namestr = familyName ? familyName : bmfont->getFace();
+		std::transform(namestr.begin(), namestr.end(), namestr.begin(), ::tolower);
+		_familyTable.push_back({ namestr, fileName, bmfont });
+	}
+	else if (familyName) {
 		std::string namestr = familyName;
 		std::transform(namestr.begin(), namestr.end(), namestr.begin(), ::tolower);
-		_familyTable.push_back({ namestr, fileName });
+		_familyTable.push_back({ namestr, fileName, nullptr });
 	}
 	else {
-		TTF_Font* ttf = TTF_OpenFont(fileName, 10);		
+		const fontfile_t* fontfile = fontFile(fileName);
+		TTF_Font* ttf = fontfile ? TTF_OpenFontFromFace(fontfile->face, 10) : nullptr;
+		if (!ttf) return;
 		std::string namestr = TTF_FontFaceFamilyName(ttf);
 		std::transform(namestr.begin(), namestr.end(), namestr.begin(), ::tolower);
-		_familyTable.push_back({ namestr, fileName });
+		_familyTable.push_back({ namestr, fileName, nullptr });
 		TTF_CloseFont(ttf);
 	}
 }
@@ -69,45 +108,279 @@ const char* FontManager::familyNameById(int fontId)
 	return _familyTable[fontId].family.c_str();
 }
 
-gpu::Image * FontManager::drawText(const char * text, bool isOffscreen, const Font & font, TextBaseline textBaseline, TextAlign textAlign, int lineWidth, int lineCap, int lineJoin, int miterLimit)
+BitmapFont* FontManager::bitmapFont(const Font& font) const
 {
-	auto descriptor = fontDescriptor(font, lineWidth, lineCap, lineJoin, miterLimit);
-	TTF_Font* ttf = nullptr;
-	if (lineWidth > 0) {
-		auto itr = _strokeFontTable.find(descriptor);
-		ttf = itr == _strokeFontTable.end() ? openFont(font, lineWidth, lineCap, lineJoin, miterLimit) : itr->second;
+	if (font.familyId < 0 || font.familyId >= _familyTable.size()) return nullptr;
+	return _familyTable[font.familyId].bitmapFont;
+}
+
+// 	֧ "italic bold|bolder 12px|40pt arial, sans-serif"
+bool FontManager::parseFont(char* fontdesc, Font& font)
+{
+	std::vector<std::string> familyNames;	
+	bool italic = false;
+	bool bold = false;
+	float size = 0;
+	char *p = strtok(fontdesc, " ,");
+	while (p) {
+		if (strcasecmp(p, "italic") == 0) {
+			italic = true;
+		}
+		else if (strcasecmp(p, "bold") == 0 || strcasecmp(p, "bolder") == 0) {
+			bold = true;
+		}
+		else {
+			int ptx = 0; // intԷֹMSC
+			sscanf(p, "%fp%1[tx]", &size, (char *)&ptx);
+			if (size > 0 && (ptx == 't' || ptx == 'x')) {
+				if (ptx == 't') size = ceilf(size * 4.0 / 3.0);
+			}
+			else { // ٶ
+				familyNames.push_back(p);
+			}
+		}
+		p = strtok(0, " ,");
 	}
-	else {
-		auto itr = _fontTable.find(descriptor);
-		ttf = itr == _fontTable.end() ? openFont(font) : itr->second;
+	int fontId = findFontId(familyNames);
+	if (fontId == -1) return false;
+	font.italic = italic;
+	font.bold = bold;
+	font.familyId = fontId;
+	font.size = roundf(size);
+	return true;
+}
+
+static TextKey textKey(const Font& font, int lineWidth, int lineCap, int lineJoin, int miterLimit)
+{
+	TextKey key = { font.familyId, font.size, font.italic, font.bold, 0, 0, 0, 0 };
+	if (lineWidth > 0) {
+		key.lineWidth = lineWidth;
+		key.lineCap = lineCap;
+		key.lineJoin = lineJoin;
+		key.miterLimit = miterLimit;
 	}
+	return key;
+}
+
+gpu::Image * FontManager::drawText(const char * text, bool cached, const Font & font, TextBaseline textBaseline, TextAlign textAlign, int lineWidth, int lineCap, int lineJoin, int miterLimit)
+{
+	TTF_Font* ttf = findFont(font, lineWidth, lineCap, lineJoin, miterLimit);
 	if (!ttf) return nullptr;
 
 	gpu::Image* image = nullptr;
-	if (isOffscreen) { // Ʋ
+	TextKey key = textKey(font, lineWidth, lineCap, lineJoin, miterLimit);
+	size_t hash = cached ? hashTextKey(text, key) : 0;
+	if (cached) image = _textImageCache.find(hash, text, key);
+	if (image == nullptr) {
 		auto surf = TTF_RenderUTF8_Blended_PremultipliedAlpha(ttf, text);
-		image = gpu::CopyImageFromSurface(surf);		
+		if (!surf) return nullptr;
+		image = gpu::CopyImageFromSurface(surf);
 		SDL_FreeSurface(surf);
-	}
-	else { // 򵥻
-		std::string cacheId = std::string(text) + descriptor;
-		image = fetch(cacheId);
-		if (image == nullptr) {
-			auto surf = TTF_RenderUTF8_Blended_PremultipliedAlpha(ttf, text);
-			image = gpu::CopyImageFromSurface(surf);			
-			SDL_FreeSurface(surf);			
-			_textImageCache[cacheId] = { image, _time };
-		}
+		if (!image) return nullptr;
+		if (cached) _textImageCache.insert(hash, text, key, image);
 	}
 	makeTextAnchor(image, ttf, textBaseline, textAlign, lineWidth);
 	return image;
 }
 
+bool FontManager::layoutText(const char * text, const Font & font, TextBaseline textBaseline, TextAlign textAlign, std::vector<TextQuad>& quads, int lineWidth, int lineCap, int lineJoin, int miterLimit)
+{
+	quads.clear();
+	BitmapFont* bmfont = bitmapFont(font);
+	if (bmfont) {
+		// no outlines, strokes draw nothing
+		return lineWidth > 0 || layoutBitmapText(bmfont, text, font, textBaseline, textAlign, quads);
+	}
+	TTF_Font* ttf = findFont(font, lineWidth, lineCap, lineJoin, miterLimit);
+	if (!ttf) return false;
+	const TextLayout* layout = textLayout(ttf, text, textKey(font, lineWidth, lineCap, lineJoin, miterLimit));
+	if (!layout) return false;
+	GlyphAtlas* atlas = glyphAtlas(ttf);
+	if (!atlas) return false;
+	if (!collectGlyphs(atlas, layout->chars)) {
+		// the atlas is full, start over with the glyphs of this text
+		atlas->reset();
+		if (!collectGlyphs(atlas, layout->chars)) return false;
+	}
+	float anchor_x, anchor_y;
+	textAnchor(layout->width, layout->height, TTF_FontAscent(ttf), textBaseline, textAlign, lineWidth, anchor_x, anchor_y);
+	for (size_t i = 0; i < _layoutGlyphs.size(); i++) {
+		const AtlasGlyph* glyph = _layoutGlyphs[i];
+		if (glyph->page < 0) continue;
+		quads.push_back({ atlas->getPage(glyph->page), glyph->rect,
+			layout->shift + layout->pens[i] + glyph->minx - anchor_x, glyph->yoffset - anchor_y, 1 });
+	}
+	return true;
+}
+
+bool FontManager::layoutDistanceFieldText(const char * text, const Font & font, TextBaseline textBaseline, TextAlign textAlign, std::vector<TextQuad>& quads)
+{
+	quads.clear();
+	// placed by the font's own layout, so it measures as the other paths
+	TTF_Font* ttf = findFont(font);
+	if (!ttf) return false;
+	const TextLayout* layout = textLayout(ttf, text, textKey(font, 0, -1, -1, 0));
+	if (!layout) return false;
+	Font baseFont = font;
+	baseFont.size = SDF_FONT_SIZE;
+	TTF_Font* basettf = findFont(baseFont);
+	if (!basettf) return false;
+	GlyphAtlas*& atlas = _distanceFieldAtlases[basettf];
+	if (!atlas) atlas = new (std::nothrow) GlyphAtlas(basettf, SDF_SPREAD);
+	if (!atlas) return false;
+	if (!collectGlyphs(atlas, layout->chars)) {
+		atlas->reset();
+		if (!collectGlyphs(atlas, layout->chars)) return false;
+	}
+	float scale = (float)font.size / SDF_FONT_SIZE;
+	float anchor_x, anchor_y;
+	textAnchor(layout->width, layout->height, TTF_FontAscent(ttf), textBaseline, textAlign, 0, anchor_x, anchor_y);
+	int ascent = TTF_FontAscent(ttf), baseAscent = TTF_FontAscent(basettf);
+	for (size_t i = 0; i < _layoutGlyphs.size(); i++) {
+		const AtlasGlyph* glyph = _layoutGlyphs[i];
+		if (glyph->page < 0) continue;
+		// the glyph's top is baseAscent - yoffset above the baseline, the field's is spread more
+		quads.push_back({ atlas->getPage(glyph->page), glyph->rect,
+			layout->shift + layout->pens[i] + (glyph->minx - SDF_SPREAD) * scale - anchor_x,
+			ascent - (baseAscent - glyph->yoffset + SDF_SPREAD) * scale - anchor_y, scale });
+	}
+	return true;
+}
+
+const TextLayout * FontManager::getTextLayout(const char * text, const Font & font, int lineWidth, int lineCap, int lineJoin, int miterLimit)
+{
+	BitmapFont* bmfont = bitmapFont(font);
+	if (bmfont) return bitmapTextLayout(bmfont, text, font);
+	TTF_Font* ttf = findFont(font, lineWidth, lineCap, lineJoin, miterLimit);
+	if (!ttf) return nullptr;
+	return textLayout(ttf, text, textKey(font, lineWidth, lineCap, lineJoin, miterLimit));
+}
+
+// placed and bounded as TTF_RenderUTF8_Blended_PremultipliedAlpha and TTF_SizeUTF8 do
+static bool buildTextLayout(TTF_Font* ttf, const char* text, TextLayout& layout)
+{
+	layout.chars.clear();
+	layout.pens.clear();
+	layout.shift = 0;
+	int pen = 0, minx = 0, maxx = 0, miny = 0;
+	Uint32 prevIndex = 0;
+	TTF_GlyphPixmap glyph;
+	const char* p = text;
+	size_t textlen = strlen(text);
+	while (textlen > 0) {
+		Uint32 ch = TTF_UTF8NextChar(&p, &textlen);
+		if (ch == 0xFEFF || ch == 0xFFFE) continue; // byte order marks
+		if (TTF_GetGlyphPixmapMetrics(ttf, ch, &glyph) < 0) return false;
+		pen += TTF_GetGlyphIndexKerning(ttf, prevIndex, glyph.index);
+		if (layout.chars.empty()) layout.shift = std::max<int>(-glyph.minx, 0);
+		minx = std::min<int>(minx, pen + glyph.minx);
+		maxx = std::max<int>(maxx, pen + glyph.extent);
+		miny = std::min<int>(miny, glyph.miny);
+		layout.chars.push_back(ch);
+		layout.pens.push_back(pen);
+		pen += glyph.advance;
+		prevIndex = glyph.index;
+	}
+	layout.pens.push_back(pen);
+	int outlineDelta = TTF_GetFontOutline(ttf) * 2;
+	layout.width = maxx - minx + outlineDelta;
+	layout.height = std::max<int>(TTF_FontAscent(ttf) - miny + outlineDelta, TTF_FontHeight(ttf));
+	return true;
+}
+
+const TextLayout * FontManager::textLayout(TTF_Font * ttf, const char * text, const TextKey & key)
+{
+	size_t hash = hashTextKey(text, key);
+	const TextLayout* cached = _textLayoutCache.find(hash, text, key);
+	if (cached) return cached;
+	TextLayout layout;
+	if (!buildTextLayout(ttf, text, layout)) return nullptr;
+	return _textLayoutCache.insert(hash, text, key, layout);
+}
+
+static float bitmapFontScale(BitmapFont* bmfont, const Font& font)
+{
+	return bmfont->getSize() > 0 ? (float)font.size / bmfont->getSize() : 1;
+}
+
+// pens and bounds at the font's size, the sheet's glyphs are scaled from the descriptor's size
+const TextLayout * FontManager::bitmapTextLayout(BitmapFont * bmfont, const char * text, const Font & font)
+{
+	TextKey key = textKey(font, 0, -1, -1, 0);
+	size_t hash = hashTextKey(text, key);
+	const TextLayout* cached = _textLayoutCache.find(hash, text, key);
+	if (cached) return cached;
+	float scale = bitmapFontScale(bmfont, font);
+	TextLayout layout;
+	layout.shift = 0;
+	int pen = 0;
+	Uint32 prev = 0;
+	const char* p = text;
+	size_t textlen = strlen(text);
+	while (textlen > 0) {
+		Uint32 ch = TTF_UTF8NextChar(&p, &textlen);
+		if (ch == 0xFEFF || ch == 0xFFFE) continue; // byte order marks
+		const BitmapGlyph* glyph = bmfont->getGlyph(ch);
+		if (prev) pen += bmfont->getKerning(prev, ch);
+		layout.chars.push_back(ch);
+		layout.pens.push_back(roundf(pen * scale));
+		if (glyph) pen += glyph->xadvance;
+		prev = ch;
+	}
+	layout.pens.push_back(roundf(pen * scale));
+	layout.width = layout.pens.back();
+	layout.height = roundf(bmfont->getLineHeight() * scale);
+	return _textLayoutCache.insert(hash, text, key, layout);
+}
+
+bool FontManager::layoutBitmapText(BitmapFont * bmfont, const char * text, const Font & font, TextBaseline textBaseline, TextAlign textAlign, std::vector<TextQuad>& quads)
+{
+	const TextLayout* layout = bitmapTextLayout(bmfont, text, font);
+	if (!layout) return false;
+	float scale = bitmapFontScale(bmfont, font);
+	float anchor_x, anchor_y;
+	textAnchor(layout->width, layout->height, roundf(bmfont->getBase() * scale), textBaseline, textAlign, 0, anchor_x, anchor_y);
+	for (size_t i = 0; i < layout->chars.size(); i++) {
+		const BitmapGlyph* glyph = bmfont->getGlyph(layout->chars[i]);
+		if (!glyph || glyph->width <= 0 || glyph->height <= 0) continue;
+		// sheets still loading are skipped
+		gpu::Image* page = bmfont->getPage(glyph->page);
+		if (!page) continue;
+		quads.push_back({ page, { (float)glyph->x, (float)glyph->y, (float)glyph->width, (float)glyph->height },
+			layout->pens[i] + glyph->xoffset * scale - anchor_x, glyph->yoffset * scale - anchor_y, scale });
+	}
+	return true;
+}
+
+GlyphAtlas * FontManager::glyphAtlas(TTF_Font * ttf)
+{
+	GlyphAtlas*& atlas = _glyphAtlases[ttf];
+	if (!atlas) atlas = new (std::nothrow) GlyphAtlas(ttf);
+	return atlas;
+}
+
+bool FontManager::collectGlyphs(GlyphAtlas * atlas, const std::vector<Uint32>& chars)
+{
+	_layoutGlyphs.clear();
+	for (Uint32 ch : chars) {
+		const AtlasGlyph* glyph = atlas->getGlyph(ch);
+		if (!glyph) return false;
+		_layoutGlyphs.push_back(glyph);
+	}
+	return true;
+}
+
 void FontManager::makeTextAnchor(gpu::Image * image, TTF_Font * ttf, TextBaseline textBaseline, TextAlign textAlign, int lineWidth)
 {
-	float anchor_x = 0, anchor_y = 0;
-	float ascent, descent, margin = 0;
-	image->anchor_fixed = true;	
+	float anchor_x, anchor_y;
+	image->anchor_fixed = true;
+	textAnchor(image->base_w, image->base_h, TTF_FontAscent(ttf), textBaseline, textAlign, lineWidth, anchor_x, anchor_y);
+	gpu::SetAnchor(image, anchor_x, anchor_y);
+}
+
+void FontManager::textAnchor(int width, int height, int ascent, TextBaseline textBaseline, TextAlign textAlign, int lineWidth, float & anchor_x, float & anchor_y)
+{
+	anchor_x = anchor_y = 0;
 	switch (textBaseline) {
 	case kTextBaselineTop:
 	case kTextBaselineHanging:
@@ -115,13 +388,12 @@ void FontManager::makeTextAnchor(gpu::Image * image, TTF_Font * ttf, TextBaselin
 		break;
 	case kTextBaselineBottom:
 	case kTextBaselineIdeographic:
-		anchor_y = image->base_h - lineWidth * 0.5;
+		anchor_y = height - lineWidth * 0.5;
 		break;
 	case kTextBaselineMiddle:
-		anchor_y = image->base_h * 0.5;
+		anchor_y = height * 0.5;
 		break;
 	case kTextBaselineAlphabetic:
-		ascent = TTF_FontAscent(ttf);
 		anchor_y = ascent + lineWidth * 0.5;
 		break;
 	}
@@ -132,40 +404,18 @@ void FontManager::makeTextAnchor(gpu::Image * image, TTF_Font * ttf, TextBaselin
 		break;
 	case kTextAlignEnd:
 	case kTextAlignRight:
-		anchor_x = image->base_w  - lineWidth * 0.5;
+		anchor_x = width - lineWidth * 0.5;
 		break;
 	case kTextAlignCenter:
-		anchor_x = 0.5 * image->base_w;
+		anchor_x = 0.5 * width;
 		break;
 	}
-	gpu::SetAnchor(image, anchor_x, anchor_y);
 }
 
 int FontManager::measureText(const char * text, const Font & font)
 {
-	auto descriptor = fontDescriptor(font);
-	auto itr = _fontTable.find(descriptor);	
-	TTF_Font* ttf = itr == _fontTable.end() ? openFont(font) : itr->second;
-	int w, h;
-	TTF_SizeUTF8(ttf, text, &w, &h);
-	return w;
-}
-
-void FontManager::update(float deltaTime)
-{
-	_time += deltaTime;
-	_timeToCheck -= deltaTime;
-	if (_timeToCheck < 0) {
-		// 黺
-		for (auto itr = _textImageCache.begin(); itr != _textImageCache.end(); ) {
-			if (_time - itr->second.fetchTime > TEXT_CACHE_LIFETIME) {
-				gpu::FreeImage(itr->second.image);
-				itr = _textImageCache.erase(itr);
-			}
-			else itr++;
-		}
-		_timeToCheck += TEXT_CACHE_CHECKTIME;
-	}
+	const TextLayout* layout = getTextLayout(text, font);
+	return layout ? layout->width : 0;
 }
 
 const std::string& FontManager::fontDescriptor(const Font& font, int lineWidth, int lineCap, int lineJoin, int miterLimit)
@@ -182,12 +432,8 @@ const std::string& FontManager::fontDescriptor(const Font& font, int lineWidth,
 	return descriptor;
 }
 
-TTF_Font* FontManager::openFont(const Font & font, int lineWidth, int lineCap, int lineJoin, int miterLimit)
+static void setupFont(TTF_Font* ttf, const Font& font, int lineWidth, int lineCap, int lineJoin, int miterLimit)
 {
-	if (font.familyId < 0 || font.familyId >= _familyTable.size()) return nullptr;
-	TTF_Font* ttf = TTF_OpenFont(_familyTable[font.familyId].file.c_str(), font.size);
-	if (!ttf) return nullptr;
-	auto descriptor = fontDescriptor(font, lineWidth, lineCap, lineJoin, miterLimit);
 	TTF_SetFontHinting(ttf, TTF_HINTING_LIGHT);
 	int style = 0;
 	if (font.italic) style |= TTF_STYLE_ITALIC;
@@ -198,6 +444,19 @@ TTF_Font* FontManager::openFont(const Font & font, int lineWidth, int lineCap, i
 		TTF_SetFontOutlineLineCap(ttf, lineCap);
 		TTF_SetFontOutlineLineJoin(ttf, lineJoin);		
 		TTF_SetFontOutlineMiterLimit(ttf, miterLimit);
+	}
+}
+
+TTF_Font* FontManager::openFont(const Font & font, int lineWidth, int lineCap, int lineJoin, int miterLimit)
+{
+	if (font.familyId < 0 || font.familyId >= _familyTable.size()) return nullptr;
+	if (_familyTable[font.familyId].bitmapFont) return nullptr;
+	const fontfile_t* fontfile = fontFile(_familyTable[font.familyId].file);
+	TTF_Font* ttf = fontfile ? TTF_OpenFontFromFace(fontfile->face, font.size) : nullptr;
+	if (!ttf) return nullptr;
+	auto descriptor = fontDescriptor(font, lineWidth, lineCap, lineJoin, miterLimit);
+	setupFont(ttf, font, lineWidth, lineCap, lineJoin, miterLimit);
+	if (lineWidth > 0) {
 		_strokeFontTable[descriptor] = ttf;
 	}
 	else {
@@ -206,12 +465,199 @@ TTF_Font* FontManager::openFont(const Font & font, int lineWidth, int lineCap, i
 	return ttf;
 }
 
-gpu::Image* FontManager::fetch(const std::string & cacheId)
+const FontManager::fontfile_t* FontManager::fontFile(const std::string& file)
+{
+	auto itr = _fontFiles.find(file);
+	if (itr != _fontFiles.end()) return &itr->second;
+	TTF_FontFace* face = nullptr;
+	SDL_RWops* rw = SDL_RWFromFile(file.c_str(), "rb");
+	Sint64 size = rw ? SDL_RWsize(rw) : -1;
+	void* data = size > 0 ? SDL_malloc((size_t)size) : nullptr;
+	if (data && SDL_RWread(rw, data, 1, (size_t)size) == (size_t)size) {
+		// the data is kept for the worker's faces too
+		face = TTF_OpenFontFaceMem(data, (size_t)size, 0);
+	}
+	if (rw) SDL_RWclose(rw);
+	if (!face) {
+		SDL_free(data);
+		SDL_LogError(0, "Failed to load the font %s: %s", file.c_str(), TTF_GetError());
+		return nullptr;
+	}
+	fontfile_t& fontfile = _fontFiles[file];
+	fontfile = { data, (size_t)size, face };
+	return &fontfile;
+}
+
+TTF_CacheStats FontManager::getGlyphCacheStats()
+{
+	TTF_CacheStats total = { 0, 0, 0, 0 };
+	TTF_CacheStats stats;
+	for (auto table : { &_fontTable, &_strokeFontTable }) {
+		for (auto& itr : *table) {
+			TTF_GetFontCacheStats(itr.second, &stats);
+			total.hits += stats.hits;
+			total.misses += stats.misses;
+			total.glyphs += stats.glyphs;
+			total.bytes += stats.bytes;
+		}
+	}
+	return total;
+}
+
+void FontManager::prepareText(const Font & font, const std::vector<std::string>& texts)
+{
+	TTF_Font* ttf = findFont(font);
+	GlyphAtlas* atlas = ttf ? glyphAtlas(ttf) : nullptr;
+	if (!atlas) return;
+	PrepareStruct* prepareStruct = new (std::nothrow) PrepareStruct();
+	if (!prepareStruct) return;
+	prepareStruct->ttf = ttf;
+	prepareStruct->key = textKey(font, 0, -1, -1, 0);
+	prepareStruct->descriptor = fontDescriptor(font);
+	prepareStruct->file = _familyTable[font.familyId].file;
+	prepareStruct->fontFile = fontFile(prepareStruct->file);
+	prepareStruct->font = font;
+	std::unordered_set<Uint32> seen;
+	for (auto& text : texts) {
+		if (!_textLayoutCache.contains(hashTextKey(text.c_str(), prepareStruct->key), text.c_str(), prepareStruct->key)) {
+			prepareStruct->texts.push_back(text);
+		}
+		const char* p = text.c_str();
+		size_t textlen = text.size();
+		while (textlen > 0) {
+			Uint32 ch = TTF_UTF8NextChar(&p, &textlen);
+			if (ch == 0xFEFF || ch == 0xFFFE) continue; // byte order marks
+			if (!atlas->hasGlyph(ch) && seen.insert(ch).second) prepareStruct->chars.push_back(ch);
+		}
+	}
+	if (prepareStruct->texts.empty() && prepareStruct->chars.empty()) {
+		delete prepareStruct;
+		return;
+	}
+
+	if (0 == _prepareRefCount) {
+		_prepareDoneSchedulerId = Scheduler::getInstance()->scheduleCallback(std::bind(&FontManager::prepareDoneCallBack, this), 0, true);
+	}
+	++_prepareRefCount;
+	_requestMutex.lock();
+	bool hasthread = !_requestQueue.empty();
+	_requestQueue.push_back(prepareStruct);
+	if (!hasthread) std::thread(&FontManager::prepareTextFunc, this).detach();
+	_requestMutex.unlock();
+}
+
+void FontManager::prepareTextFunc()
+{
+	if (Tracer::isEnabled()) Tracer::getInstance()->setThreadName("FontManager");
+	bool firstloop = true;
+	while (true) {
+		PrepareStruct* prepareStruct = nullptr;
+		_requestMutex.lock();
+		if (firstloop) firstloop = false;
+		else _requestQueue.pop_front();
+		if (!_requestQueue.empty()) prepareStruct = _requestQueue.front();
+		_requestMutex.unlock();
+		// exit thread when request queue is empty
+		if (!prepareStruct) break;
+		prepare(prepareStruct);
+		_responseMutex.lock();
+		_responseQueue.push_back(prepareStruct);
+		_responseMutex.unlock();
+	}
+}
+
+// runs on the worker, only its own fonts are touched
+void FontManager::prepare(PrepareStruct * prepareStruct)
+{
+	TRACE_SCOPE("FontManager::prepare");
+	TTF_Font* ttf = workerFont(prepareStruct);
+	if (!ttf) return;
+	prepareStruct->layouts.resize(prepareStruct->texts.size());
+	for (size_t i = 0; i < prepareStruct->texts.size(); i++) {
+		if (!buildTextLayout(ttf, prepareStruct->texts[i].c_str(), prepareStruct->layouts[i])) {
+			prepareStruct->layouts[i].pens.clear();
+		}
+	}
+	TTF_GlyphPixmap pixmap;
+	for (Uint32 ch : prepareStruct->chars) {
+		if (TTF_RenderGlyphPixmap(ttf, ch, &pixmap) != 0) continue;
+		prepareStruct->glyphs.push_back({ ch, pixmap, std::vector<Uint8>() });
+		PreparedGlyph& glyph = prepareStruct->glyphs.back();
+		// the pixmap is overwritten by the next glyph
+		glyph.pixels.resize(pixmap.width * pixmap.rows);
+		for (int row = 0; row < pixmap.rows; ++row) {
+			memcpy(glyph.pixels.data() + row * pixmap.width, pixmap.pixels + row * pixmap.pitch, pixmap.width);
+		}
+		glyph.pixmap.pitch = pixmap.width;
+		glyph.pixmap.pixels = nullptr;
+	}
+}
+
+TTF_Font * FontManager::workerFont(PrepareStruct * prepareStruct)
+{
+	auto itr = _workerFonts.find(prepareStruct->descriptor);
+	if (itr != _workerFonts.end()) return itr->second;
+	if (!prepareStruct->fontFile) return nullptr;
+	TTF_FontFace*& face = _workerFaces[prepareStruct->file];
+	if (!face) {
+		const fontfile_t* fontfile = prepareStruct->fontFile;
+		face = TTF_OpenFontFaceMemEx(fontfile->data, fontfile->size, 0, 1);
+		if (!face) {
+			SDL_LogError(0, "Failed to load the font %s: %s", prepareStruct->file.c_str(), TTF_GetError());
+			_workerFaces.erase(prepareStruct->file);
+			return nullptr;
+		}
+	}
+	TTF_Font* ttf = TTF_OpenFontFromFace(face, prepareStruct->font.size);
+	if (!ttf) return nullptr;
+	setupFont(ttf, prepareStruct->font, 0, -1, -1, 0);
+	_workerFonts[prepareStruct->descriptor] = ttf;
+	return ttf;
+}
+
+void FontManager::prepareDoneCallBack()
+{
+	std::deque<PrepareStruct*> responses;
+	_responseMutex.lock();
+	responses.swap(_responseQueue);
+	_responseMutex.unlock();
+
+	for (PrepareStruct* prepareStruct : responses) {
+		TRACE_SCOPE("FontManager::prepareDone");
+		const TextKey& key = prepareStruct->key;
+		for (size_t i = 0; i < prepareStruct->layouts.size(); i++) {
+			TextLayout& layout = prepareStruct->layouts[i];
+			const char* text = prepareStruct->texts[i].c_str();
+			size_t hash = hashTextKey(text, key);
+			if (layout.pens.empty() || _textLayoutCache.contains(hash, text, key)) continue;
+			_textLayoutCache.insert(hash, text, key, layout);
+		}
+		GlyphAtlas* atlas = glyphAtlas(prepareStruct->ttf);
+		for (PreparedGlyph& glyph : prepareStruct->glyphs) {
+			if (!atlas) break;
+			if (atlas->hasGlyph(glyph.ch)) continue;
+			glyph.pixmap.pixels = glyph.pixels.data();
+			// full, the glyphs already packed may be in use
+			if (!atlas->addGlyph(glyph.ch, glyph.pixmap)) break;
+		}
+		delete prepareStruct;
+		--_prepareRefCount;
+	}
+	if (!responses.empty() && 0 == _prepareRefCount) {
+		Scheduler::getInstance()->cancel(_prepareDoneSchedulerId);
+		_prepareDoneSchedulerId = 0;
+	}
+}
+
+TTF_Font* FontManager::findFont(const Font & font, int lineWidth, int lineCap, int lineJoin, int miterLimit)
 {
-	auto itr = _textImageCache.find(cacheId);
-	if (itr == _textImageCache.end()) return nullptr;
-	itr->second.fetchTime = _time;
-	return itr->second.image;
+	auto& descriptor = fontDescriptor(font, lineWidth, lineCap, lineJoin, miterLimit);
+	if (lineWidth > 0) {
+		auto itr = _strokeFontTable.find(descriptor);
+		return itr == _strokeFontTable.end() ? openFont(font, lineWidth, lineCap, lineJoin, miterLimit) : itr->second;
+	}
+	auto itr = _fontTable.find(descriptor);
+	return itr == _fontTable.end() ? openFont(font) : itr->second;
 }
 
 NS_REK_END
\ No newline at end of file
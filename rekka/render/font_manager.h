@@ -2,14 +2,17 @@
 
 #include "rekka.h"
 #include "SDL_ttf.h"
+#include "glyph_atlas.h"
+#include "text_image_cache.h"
+#include "text_layout_cache.h"
+#include "bitmap_font.h"
 #include <map>
+#include <mutex>
+#include <thread>
+#include <deque>
 
 NS_REK_BEGIN
 
-#define TEXT_CACHE_LIFETIME		8.0
-#define TEXT_CACHE_CHECKTIME	2.0
-
-
 typedef enum {
 	kTextBaselineAlphabetic = 0,
 	kTextBaselineMiddle,
@@ -51,6 +54,18 @@ struct Font {
 	bool bold;	
 };
 
+struct TextQuad {
+	gpu::Image* page;
+	GPU_Rect rect;	// in the page
+	float x, y;		// top-left from the text position
+	float scale;	// of distance field and bitmap font glyphs, 1 for the others
+};
+
+// distance field glyphs are rendered once at this size and scaled to the others,
+// the field reaches SDF_SPREAD pixels of it outside and inside the outline
+#define SDF_FONT_SIZE 32
+#define SDF_SPREAD 6
+
 class FontManager {
 private:
 	static FontManager* s_sharedFontManager;	
@@ -59,32 +74,99 @@ public:
 	~FontManager();
 	static FontManager* getInstance();
 public:
+	// TrueType fonts, or BMFont text format descriptors (.fnt) drawn from their glyph sheets
 	void loadFont(const char* fileName, const char* familyName = nullptr);
 	int findFontId(const std::vector<std::string>& familyNames);
 	const char* familyNameById(int fontId);
-	gpu::Image* drawText(const char* text, bool isOffscreen, const Font& font, TextBaseline textBaseline, TextAlign textAlign, int lineWidth = 0, int lineCap = -1, int lineJoin = -1, int miterLimit = 0);	
+	int getFamilyCount() const { return (int)_familyTable.size(); }
+	// bitmap fonts have no outlines and no other path than their layouts and glyph quads
+	BitmapFont* bitmapFont(const Font& font) const;
+	// a CSS font shorthand, e.g. "italic bold 12px arial, sans-serif", modifies fontdesc
+	bool parseFont(char* fontdesc, Font& font);
+	// cached images are owned by the text image cache, others are freed by the caller
+	gpu::Image* drawText(const char* text, bool cached, const Font& font, TextBaseline textBaseline, TextAlign textAlign, int lineWidth = 0, int lineCap = -1, int lineJoin = -1, int miterLimit = 0);	
+	// lays the text out as quads of the font's glyph atlas, false if its glyphs don't fit in the atlas
+	bool layoutText(const char* text, const Font& font, TextBaseline textBaseline, TextAlign textAlign, std::vector<TextQuad>& quads, int lineWidth = 0, int lineCap = -1, int lineJoin = -1, int miterLimit = 0);
+	// lays the fill's glyphs out as scaled quads of the family's distance field atlas
+	bool layoutDistanceFieldText(const char* text, const Font& font, TextBaseline textBaseline, TextAlign textAlign, std::vector<TextQuad>& quads);
+	void setDistanceFieldText(bool enable) { _distanceFieldText = enable; }
+	bool isDistanceFieldText() const { return _distanceFieldText; }
 	int measureText(const char* text, const Font& font);
-	void update(float deltaTime);
+	// the cached layout of the text, valid until the next layout is made
+	const TextLayout* getTextLayout(const char* text, const Font& font, int lineWidth = 0, int lineCap = -1, int lineJoin = -1, int miterLimit = 0);
+	unsigned int getTextCacheHits() const { return _textImageCache.getHits(); }
+	unsigned int getTextCacheMisses() const { return _textImageCache.getMisses(); }
+	unsigned int getTextCacheBytes() const { return _textImageCache.getBytes(); }
+	// SDL_ttf's rendered glyph caches, summed over the open fonts
+	TTF_CacheStats getGlyphCacheStats();
+	// lays out and rasterises the texts' fills on a worker thread, the results are put
+	// into the layout cache and the glyph atlas on a later frame
+	void prepareText(const Font& font, const std::vector<std::string>& texts);
 private:
+	struct fontfile_t {
+		void* data;
+		size_t size;
+		TTF_FontFace* face;
+	};
+	struct PreparedGlyph {
+		Uint32 ch;
+		TTF_GlyphPixmap pixmap;
+		std::vector<Uint8> pixels;	// pitch is the width
+	};
+	struct PrepareStruct {
+		TTF_Font* ttf;				// the main thread's font
+		TextKey key;
+		std::string descriptor;
+		std::string file;
+		const fontfile_t* fontFile;
+		Font font;
+		std::vector<std::string> texts;	// without a cached layout
+		std::vector<Uint32> chars;		// missing from the atlas
+		std::vector<TextLayout> layouts;	// one per text, no pens if it failed
+		std::vector<PreparedGlyph> glyphs;
+	};
+	void prepareTextFunc();
+	void prepareDoneCallBack();
+	void prepare(PrepareStruct* prepareStruct);
+	TTF_Font* workerFont(PrepareStruct* prepareStruct);
+	GlyphAtlas* glyphAtlas(TTF_Font* ttf);
+	const fontfile_t* fontFile(const std::string& file);
 	const std::string& fontDescriptor(const Font& font, int lineWidth = 0, int lineCap = -1, int lineJoin = -1, int miterLimit = 0);
 	TTF_Font* openFont(const Font& font, int lineWidth = 0, int lineCap = -1, int lineJoin = -1, int miterLimit = 0);
-	gpu::Image* fetch(const std::string& cacheId);
+	TTF_Font* findFont(const Font& font, int lineWidth = 0, int lineCap = -1, int lineJoin = -1, int miterLimit = 0);
+	const TextLayout* textLayout(TTF_Font* ttf, const char* text, const TextKey& key);
+	bool collectGlyphs(GlyphAtlas* atlas, const std::vector<Uint32>& chars);
+	const TextLayout* bitmapTextLayout(BitmapFont* bmfont, const char* text, const Font& font);
+	bool layoutBitmapText(BitmapFont* bmfont, const char* text, const Font& font, TextBaseline textBaseline, TextAlign textAlign, std::vector<TextQuad>& quads);
+	void textAnchor(int width, int height, int ascent, TextBaseline textBaseline, TextAlign textAlign, int lineWidth, float& anchor_x, float& anchor_y);
 	void makeTextAnchor(gpu::Image* image, TTF_Font* ttf, TextBaseline textBaseline, TextAlign textAlign, int lineWidth = 0);
 private:
 	struct fontfamily_t {
 		std::string family;
 		std::string file;
+		BitmapFont* bitmapFont;	// nullptr for TrueType fonts
 	};
 	std::vector<fontfamily_t> _familyTable;
+	// font files are read and parsed once, every size and stroke font is opened from the face
+	std::map<std::string, fontfile_t> _fontFiles;
 	std::map<std::string, TTF_Font*> _fontTable;
 	std::map<std::string, TTF_Font*> _strokeFontTable;
-	struct cachedimage_t {
-		gpu::Image* image;
-		float fetchTime;
-	};
-	std::map<std::string, cachedimage_t> _textImageCache;
-	float _time;
-	float _timeToCheck;
+	std::map<TTF_Font*, GlyphAtlas*> _glyphAtlases;
+	// by the SDF_FONT_SIZE font of the family and style
+	std::map<TTF_Font*, GlyphAtlas*> _distanceFieldAtlases;
+	bool _distanceFieldText;
+	std::vector<const AtlasGlyph*> _layoutGlyphs;
+	TextImageCache _textImageCache;
+	TextLayoutCache _textLayoutCache;
+	// the worker's own faces and fonts, each face with its own FreeType instance
+	std::map<std::string, TTF_FontFace*> _workerFaces;
+	std::map<std::string, TTF_Font*> _workerFonts;
+	int _prepareRefCount;
+	int _prepareDoneSchedulerId;
+	std::deque<PrepareStruct*> _requestQueue;
+	std::deque<PrepareStruct*> _responseQueue;
+	std::mutex _requestMutex;
+	std::mutex _responseMutex;
 };
 
 NS_REK_END
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "glyph_atlas.h"
+
+NS_REK_BEGIN
+
+#define GLYPH_ATLAS_PAGE_SIZE 512
+#define GLYPH_ATLAS_MAX_PAGES 4
+// empty texels around each glyph, so linear filtering doesn't pick up the neighbours
+#define GLYPH_ATLAS_PADDING 1
+
+GlyphAtlas::GlyphAtlas(TTF_Font* ttf, int spread) : _ttf(ttf), _spread(spread)
+{
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+	for (auto& page : _pages) {
+		gpu::FreeImage(page.image);
+	}
+}
+
+const AtlasGlyph* GlyphAtlas::getGlyph(Uint32 ch)
+{
+	auto itr = _glyphs.find(ch);
+	if (itr != _glyphs.end()) return &itr->second;
+
+	TTF_GlyphPixmap pixmap;
+	if (TTF_RenderGlyphPixmap(_ttf, ch, &pixmap) != 0) return nullptr;
+	return addGlyph(ch, pixmap);
+}
+
+const AtlasGlyph* GlyphAtlas::addGlyph(Uint32 ch, const TTF_GlyphPixmap& pixmap)
+{
+	AtlasGlyph glyph;
+	glyph.page = -1;
+	glyph.rect = { 0, 0, 0, 0 };
+	glyph.minx = pixmap.minx;
+	glyph.miny = pixmap.miny;
+	glyph.extent = pixmap.extent;
+	glyph.yoffset = pixmap.yoffset;
+	glyph.advance = pixmap.advance;
+	glyph.index = pixmap.index;
+	if (pixmap.width > 0 && pixmap.rows > 0 && _spread > 0) {
+		int w = pixmap.width + _spread * 2, h = pixmap.rows + _spread * 2;
+		if (!pack(w, h, glyph.page, glyph.rect)) return nullptr;
+		distanceField(pixmap);
+		gpu::UpdateImageBytes(_pages[glyph.page].image, &glyph.rect, &_uploadBuffer.front(), w * 4);
+	}
+	else if (pixmap.width > 0 && pixmap.rows > 0) {
+		if (!pack(pixmap.width, pixmap.rows, glyph.page, glyph.rect)) return nullptr;
+		_uploadBuffer.resize(pixmap.width * pixmap.rows * 4);
+		Uint8* dst = &_uploadBuffer.front();
+		for (int row = 0; row < pixmap.rows; ++row) {
+			const Uint8* src = pixmap.pixels + row * pixmap.pitch;
+			for (int col = 0; col < pixmap.width; ++col) {
+				Uint8 alpha = *src++;
+				*dst++ = alpha;
+				*dst++ = alpha;
+				*dst++ = alpha;
+				*dst++ = alpha;
+			}
+		}
+		gpu::UpdateImageBytes(_pages[glyph.page].image, &glyph.rect, &_uploadBuffer.front(), pixmap.width * 4);
+	}
+	return &(_glyphs[ch] = glyph);
+}
+
+#define EDT_INF 1e20f
+
+// squared distances along one row or column, Felzenszwalb and Huttenlocher's lower envelope of parabolas
+static void edt1d(float* grid, int offset, int stride, int length, float* f, int* v, float* z)
+{
+	for (int q = 0; q < length; q++) f[q] = grid[offset + q * stride];
+	int k = 0;
+	v[0] = 0;
+	z[0] = -EDT_INF;
+	z[1] = EDT_INF;
+	for (int q = 1; q < length; q++) {
+		float s;
+		do {
+			int r = v[k];
+			s = (f[q] - f[r] + q * q - r * r) / (2.0f * (q - r));
+		} while (s <= z[k] && --k > -1);
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = EDT_INF;
+	}
+	k = 0;
+	for (int q = 0; q < length; q++) {
+		while (z[k + 1] < q) k++;
+		int r = v[k];
+		grid[offset + q * stride] = f[r] + (q - r) * (q - r);
+	}
+}
+
+static void edt2d(float* grid, int width, int height, float* f, int* v, float* z)
+{
+	for (int x = 0; x < width; x++) edt1d(grid, x, width, height, f, v, z);
+	for (int y = 0; y < height; y++) edt1d(grid, y * width, 1, width, f, v, z);
+}
+
+// fills the upload buffer with the field of the pixmap and the spread around it,
+// partly covered pixels are taken as an outline crossing the pixel at the coverage
+void GlyphAtlas::distanceField(const TTF_GlyphPixmap& pixmap)
+{
+	int w = pixmap.width + _spread * 2, h = pixmap.rows + _spread * 2;
+	int size = w * h, length = std::max<int>(w, h);
+	_outer.assign(size, EDT_INF);
+	_inner.assign(size, 0);
+	_f.resize(length);
+	_z.resize(length + 1);
+	_v.resize(length);
+	for (int row = 0; row < pixmap.rows; ++row) {
+		const Uint8* src = pixmap.pixels + row * pixmap.pitch;
+		for (int col = 0; col < pixmap.width; ++col) {
+			float a = src[col] / 255.0f;
+			if (a == 0) continue;
+			int i = (row + _spread) * w + col + _spread;
+			if (a == 1) {
+				_outer[i] = 0;
+				_inner[i] = EDT_INF;
+			}
+			else {
+				float d = 0.5f - a;
+				_outer[i] = d > 0 ? d * d : 0;
+				_inner[i] = d < 0 ? d * d : 0;
+			}
+		}
+	}
+	edt2d(&_outer.front(), w, h, &_f.front(), &_v.front(), &_z.front());
+	edt2d(&_inner.front(), w, h, &_f.front(), &_v.front(), &_z.front());
+	_uploadBuffer.resize(size * 4);
+	Uint8* dst = &_uploadBuffer.front();
+	for (int i = 0; i < size; i++) {
+		float d = sqrtf(_outer[i]) - sqrtf(_inner[i]);
+		float value = 0.5f - d / (_spread * 2);
+		Uint8 v = (Uint8)roundf(255 * std::min<float>(std::max<float>(value, 0), 1));
+		*dst++ = v;
+		*dst++ = v;
+		*dst++ = v;
+		*dst++ = v;
+	}
+}
+
+bool GlyphAtlas::pack(int w, int h, int& page, GPU_Rect& rect)
+{
+	int paddedW = w + GLYPH_ATLAS_PADDING;
+	int paddedH = h + GLYPH_ATLAS_PADDING;
+	if (paddedW > GLYPH_ATLAS_PAGE_SIZE || paddedH > GLYPH_ATLAS_PAGE_SIZE) return false;
+	// only the last page has room, the earlier ones are full
+	page_t* current = _pages.empty() ? nullptr : &_pages.back();
+	if (current && current->shelfX + paddedW > GLYPH_ATLAS_PAGE_SIZE) {
+		// next shelf
+		current->shelfY += current->shelfHeight;
+		current->shelfX = GLYPH_ATLAS_PADDING;
+		current->shelfHeight = 0;
+	}
+	if (!current || current->shelfY + paddedH > GLYPH_ATLAS_PAGE_SIZE) {
+		if (_pages.size() >= GLYPH_ATLAS_MAX_PAGES) return false;
+		gpu::Image* image = gpu::CreateImage(GLYPH_ATLAS_PAGE_SIZE, GLYPH_ATLAS_PAGE_SIZE, gpu::FORMAT_RGBA);
+		if (!image) return false;
+		// glyph quads are placed by their top-left
+		image->anchor_fixed = true;
+		gpu::SetAnchor(image, 0, 0);
+		_pages.push_back({ image, GLYPH_ATLAS_PADDING, GLYPH_ATLAS_PADDING, 0 });
+		current = &_pages.back();
+	}
+	page = (int)_pages.size() - 1;
+	rect = { (float)current->shelfX, (float)current->shelfY, (float)w, (float)h };
+	current->shelfX += paddedW;
+	current->shelfHeight = std::max<int>(current->shelfHeight, paddedH);
+	return true;
+}
+
+void GlyphAtlas::reset()
+{
+	_glyphs.clear();
+	if (_pages.empty()) return;
+	// queued glyph quads may still sample the pages
+	gpu::FlushBlitBuffer();
+	// refill from the first page
+	for (size_t i = 1; i < _pages.size(); ++i) gpu::FreeImage(_pages[i].image);
+	_pages.resize(1);
+	page_t& page = _pages.front();
+	std::vector<Uint8> zeros(GLYPH_ATLAS_PAGE_SIZE * GLYPH_ATLAS_PAGE_SIZE * 4, 0);
+	gpu::UpdateImageBytes(page.image, nullptr, &zeros.front(), GLYPH_ATLAS_PAGE_SIZE * 4);
+	page.shelfX = page.shelfY = GLYPH_ATLAS_PADDING;
+	page.shelfHeight = 0;
+}
+
+NS_REK_END
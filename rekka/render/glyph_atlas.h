@@ -0,0 +1,57 @@
+#pragma once
+
+#include "rekka.h"
+#include "SDL_ttf.h"
+#include <unordered_map>
+
+NS_REK_BEGIN
+
+struct AtlasGlyph {
+	int page;		// -1 for glyphs without pixels, e.g. spaces
+	GPU_Rect rect;	// in the page, with the spread around distance field glyphs
+	int minx;
+	int miny;
+	int extent;
+	int yoffset;
+	int advance;
+	Uint32 index;	// FreeType glyph index, for kerning
+};
+
+// glyphs of one TTF_Font (family, size, style and outline) packed on shelves into shared pages,
+// the pages are premultiplied white and tinted when drawn.
+// With a spread the glyphs are stored as distance fields, 0.5 on the outline and falling
+// to 0 and rising to 1 spread pixels outside and inside, drawn at any size by CanvasExtra
+class GlyphAtlas {
+public:
+	GlyphAtlas(TTF_Font* ttf, int spread = 0);
+	~GlyphAtlas();
+	// rasterises and packs the glyph on a miss, nullptr if it fails or the pages are full
+	const AtlasGlyph* getGlyph(Uint32 ch);
+	// packs a glyph rendered elsewhere from the same face and settings
+	const AtlasGlyph* addGlyph(Uint32 ch, const TTF_GlyphPixmap& pixmap);
+	bool hasGlyph(Uint32 ch) const { return _glyphs.count(ch) > 0; }
+	gpu::Image* getPage(int page) const { return _pages[page].image; }
+	// drop every glyph, the pages are cleared and reused
+	void reset();
+	TTF_Font* getFont() const { return _ttf; }
+	int getSpread() const { return _spread; }
+private:
+	bool pack(int w, int h, int& page, GPU_Rect& rect);
+	void distanceField(const TTF_GlyphPixmap& pixmap);
+	struct page_t {
+		gpu::Image* image;
+		int shelfX;
+		int shelfY;
+		int shelfHeight;
+	};
+	TTF_Font* _ttf;
+	int _spread;
+	std::vector<page_t> _pages;
+	std::unordered_map<Uint32, AtlasGlyph> _glyphs;
+	std::vector<Uint8> _uploadBuffer;
+	// scratch of distanceField
+	std::vector<float> _outer, _inner, _f, _z;
+	std::vector<int> _v;
+};
+
+NS_REK_END
@@ -1,5 +1,6 @@
 #include "image_manager.h"
 #include "scheduler.h"
+#include "trace.h"
 #include "stb_image.h"
 
 NS_REK_BEGIN
@@ -12,7 +13,7 @@ ImageManager* ImageManager::getInstance()
 }
 
 ImageManager::ImageManager()
-: _asyncRefCount(0), _fechDoneSchedulerId(0)
+: _asyncRefCount(0), _fechDoneSchedulerId(0), _decodedCount(0)
 {
 }
 
@@ -36,6 +37,7 @@ void ImageManager::fetchImageAsync(const std::string & filepath, const std::func
 
 void ImageManager::fetchImageFunc()
 {	 
+	if (Tracer::isEnabled()) Tracer::getInstance()->setThreadName("ImageManager");
 	bool firstloop = true;	
 	while (true) {
 		// get any request
@@ -67,11 +69,13 @@ void ImageManager::fetchDoneCallBack()
 	_responseMutex.unlock();
 
 	if (fetchStruct) {
+		TRACE_SCOPE("ImageManager::fetchDone");
 		gpu::Image* image = nullptr;
 		if (fetchStruct->data) {
 			image = gpu::CreateImage(fetchStruct->width, fetchStruct->height, gpu::FORMAT_RGBA);
 			gpu::UpdateImageBytes(image, NULL, fetchStruct->data, 4 * fetchStruct->width);
 			stbi_image_free(fetchStruct->data);
+			_decodedCount++;
 		}
 		if (fetchStruct->callback) fetchStruct->callback(image);
 		delete fetchStruct;
@@ -90,6 +94,7 @@ void ImageManager::fetchDoneCallBack()
     ((unsigned)(unsigned char)(va) << 24))
 void ImageManager::loadImageData(const std::string& fileName, FetchStruct* fetchStruct)
 {
+	TRACE_SCOPE("ImageManager::loadImageData");
 	SDL_RWops* rwops = SDL_RWFromFile(fileName.c_str(), "rb");
 	fetchStruct->data = nullptr;
 	fetchStruct->width = 0;
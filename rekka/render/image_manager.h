@@ -16,6 +16,7 @@ public:
 	~ImageManager();
 	static ImageManager* getInstance();	
 	void fetchImageAsync(const std::string &filepath, const std::function<void(gpu::Image*)>& callback);
+	unsigned int getDecodedCount() const { return _decodedCount; }
 private:
 	struct FetchStruct {
 		std::string filename;
@@ -29,6 +30,7 @@ private:
 	void loadImageData(const std::string& fileName, FetchStruct* fetchStruct);	
 	int _asyncRefCount;
 	int _fechDoneSchedulerId;
+	unsigned int _decodedCount;
 	std::deque<FetchStruct*> _requestQueue;
 	std::deque<FetchStruct*> _responseQueue;
 	std::mutex _requestMutex;
@@ -0,0 +1,105 @@
+#include "text_image_cache.h"
+
+NS_REK_BEGIN
+
+// 64-bit FNV-1a
+#define HASH_OFFSET 14695981039346656037ULL
+#define HASH_PRIME 1099511628211ULL
+
+static inline Uint64 hashBytes(Uint64 h, const void* data, size_t len)
+{
+	const Uint8* p = (const Uint8*)data;
+	while (len-- > 0) {
+		h = (h ^ *p++) * HASH_PRIME;
+	}
+	return h;
+}
+
+static inline unsigned int imageBytes(gpu::Image* image)
+{
+	return image->texture_w * image->texture_h * 4;
+}
+
+TextImageCache::TextImageCache(unsigned int budget)
+: _budget(budget), _bytes(0), _hits(0), _misses(0)
+{
+}
+
+TextImageCache::~TextImageCache()
+{
+	clear();
+}
+
+size_t hashTextKey(const char* text, const TextKey& key)
+{
+	Uint64 h = hashBytes(HASH_OFFSET, text, strlen(text));
+	int fields[] = { key.familyId, key.size, key.italic ? 1 : 0, key.bold ? 1 : 0,
+		key.lineWidth, key.lineCap, key.lineJoin, key.miterLimit };
+	h = hashBytes(h, fields, sizeof(fields));
+	return (size_t)(h ^ (h >> 32));
+}
+
+gpu::Image* TextImageCache::find(size_t hash, const char* text, const TextKey& key)
+{
+	auto range = _index.equal_range(hash);
+	for (auto itr = range.first; itr != range.second; ++itr) {
+		auto entry = itr->second;
+		if (entry->key == key && entry->text == text) {
+			_entries.splice(_entries.begin(), _entries, entry);
+			_hits++;
+			return entry->image;
+		}
+	}
+	_misses++;
+	return nullptr;
+}
+
+void TextImageCache::insert(size_t hash, const char* text, const TextKey& key, gpu::Image* image)
+{
+	unsigned int bytes = imageBytes(image);
+	_entries.push_front({ hash, key, text, image, bytes });
+	_index.insert({ hash, _entries.begin() });
+	_bytes += bytes;
+	evict(_budget);
+}
+
+void TextImageCache::clear()
+{
+	for (auto& entry : _entries) {
+		gpu::FreeImage(entry.image);
+	}
+	_entries.clear();
+	_index.clear();
+	_bytes = 0;
+}
+
+void TextImageCache::setBudget(unsigned int budget)
+{
+	_budget = budget;
+	evict(_budget);
+}
+
+void TextImageCache::evict(unsigned int budget)
+{
+	// the front entry is the one just drawn
+	while (_bytes > budget && _entries.size() > 1) {
+		auto entry = std::prev(_entries.end());
+		unindex(entry);
+		_bytes -= entry->bytes;
+		gpu::FreeImage(entry->image);
+		_entries.erase(entry);
+	}
+}
+
+void TextImageCache::unindex(EntryList::iterator entry)
+{
+	auto range = _index.equal_range(entry->hash);
+	for (auto itr = range.first; itr != range.second; ++itr) {
+		if (itr->second == entry) {
+			_index.erase(itr);
+			return;
+		}
+	}
+}
+
+NS_REK_END
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "rekka.h"
+#include <list>
+#include <unordered_map>
+
+NS_REK_BEGIN
+
+// rendered text images kept for reuse, the least recently used are freed over the budget
+#define TEXT_CACHE_BUDGET (16 * 1024 * 1024)
+
+// what a text is rendered with besides the text, stroke fields are 0 for fills
+struct TextKey {
+	int familyId;
+	int size;
+	bool italic;
+	bool bold;
+	int lineWidth;
+	int lineCap;
+	int lineJoin;
+	int miterLimit;
+	bool operator==(const TextKey& other) const {
+		return familyId == other.familyId && size == other.size && italic == other.italic && bold == other.bold &&
+			lineWidth == other.lineWidth && lineCap == other.lineCap && lineJoin == other.lineJoin && miterLimit == other.miterLimit;
+	}
+};
+
+// hashes the text bytes and the key in place, nothing is allocated
+size_t hashTextKey(const char* text, const TextKey& key);
+
+// shared by the screen and offscreen canvases, images stay owned by the cache
+// and are valid until the next insert
+class TextImageCache {
+public:
+	TextImageCache(unsigned int budget = TEXT_CACHE_BUDGET);
+	~TextImageCache();
+	// hash is hashTextKey(text, key), counts a hit or a miss
+	gpu::Image* find(size_t hash, const char* text, const TextKey& key);
+	// takes the image, evicts the least recently used ones over the budget but never the new one
+	void insert(size_t hash, const char* text, const TextKey& key, gpu::Image* image);
+	void clear();
+	void setBudget(unsigned int budget);
+	unsigned int getHits() const { return _hits; }
+	unsigned int getMisses() const { return _misses; }
+	unsigned int getBytes() const { return _bytes; }
+	unsigned int getCount() const { return (unsigned int)_entries.size(); }
+private:
+	struct entry_t {
+		size_t hash;
+		TextKey key;
+		std::string text;
+		gpu::Image* image;
+		unsigned int bytes;
+	};
+	typedef std::list<entry_t> EntryList;
+	void evict(unsigned int budget);
+	void unindex(EntryList::iterator entry);
+	EntryList _entries;	// the most recently used at the front
+	std::unordered_multimap<size_t, EntryList::iterator> _index;
+	unsigned int _budget;
+	unsigned int _bytes;
+	unsigned int _hits;
+	unsigned int _misses;
+};
+
+NS_REK_END
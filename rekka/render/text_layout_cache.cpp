@@ -0,0 +1,62 @@
+#include "text_layout_cache.h"
+
+NS_REK_BEGIN
+
+TextLayoutCache::TextLayoutCache(unsigned int capacity)
+: _capacity(capacity), _hits(0), _misses(0)
+{
+}
+
+TextLayoutCache::EntryList::iterator TextLayoutCache::lookup(size_t hash, const char* text, const TextKey& key) const
+{
+	auto range = _index.equal_range(hash);
+	for (auto itr = range.first; itr != range.second; ++itr) {
+		auto entry = itr->second;
+		if (entry->key == key && entry->text == text) return entry;
+	}
+	return const_cast<EntryList&>(_entries).end();
+}
+
+const TextLayout* TextLayoutCache::find(size_t hash, const char* text, const TextKey& key)
+{
+	auto entry = lookup(hash, text, key);
+	if (entry == _entries.end()) {
+		_misses++;
+		return nullptr;
+	}
+	_entries.splice(_entries.begin(), _entries, entry);
+	_hits++;
+	return &entry->layout;
+}
+
+bool TextLayoutCache::contains(size_t hash, const char* text, const TextKey& key) const
+{
+	return lookup(hash, text, key) != _entries.end();
+}
+
+const TextLayout* TextLayoutCache::insert(size_t hash, const char* text, const TextKey& key, TextLayout& layout)
+{
+	_entries.push_front({ hash, key, text, TextLayout() });
+	_entries.front().layout = std::move(layout);
+	_index.insert({ hash, _entries.begin() });
+	while (_entries.size() > _capacity && _entries.size() > 1) {
+		auto entry = std::prev(_entries.end());
+		auto range = _index.equal_range(entry->hash);
+		for (auto itr = range.first; itr != range.second; ++itr) {
+			if (itr->second == entry) {
+				_index.erase(itr);
+				break;
+			}
+		}
+		_entries.erase(entry);
+	}
+	return &_entries.front().layout;
+}
+
+void TextLayoutCache::clear()
+{
+	_entries.clear();
+	_index.clear();
+}
+
+NS_REK_END
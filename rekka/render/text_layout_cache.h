@@ -0,0 +1,53 @@
+#pragma once
+
+#include "rekka.h"
+#include "text_image_cache.h"
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+NS_REK_BEGIN
+
+// laid out strings kept for measureText and the glyph drawing path
+#define TEXT_LAYOUT_CACHE_SIZE 2048
+
+// a line of text placed as TTF_RenderUTF8_Blended_PremultipliedAlpha does
+struct TextLayout {
+	std::vector<Uint32> chars;	// code points, byte order marks skipped
+	std::vector<int> pens;		// pen x of each glyph with kerning, one more for the end of the text
+	int width, height;			// as TTF_SizeUTF8
+	int shift;					// the first glyph is shifted right when it extends to the left of the pen
+	// advance width of the first count characters
+	int prefixWidth(size_t count) const { return pens[std::min(count, chars.size())]; }
+};
+
+class TextLayoutCache {
+public:
+	TextLayoutCache(unsigned int capacity = TEXT_LAYOUT_CACHE_SIZE);
+	// hash is hashTextKey(text, key), counts a hit or a miss
+	const TextLayout* find(size_t hash, const char* text, const TextKey& key);
+	// without counting or touching the order
+	bool contains(size_t hash, const char* text, const TextKey& key) const;
+	// takes the layout, evicts the least recently used over the capacity but never the new one
+	const TextLayout* insert(size_t hash, const char* text, const TextKey& key, TextLayout& layout);
+	void clear();
+	unsigned int getHits() const { return _hits; }
+	unsigned int getMisses() const { return _misses; }
+	unsigned int getCount() const { return (unsigned int)_entries.size(); }
+private:
+	struct entry_t {
+		size_t hash;
+		TextKey key;
+		std::string text;
+		TextLayout layout;
+	};
+	typedef std::list<entry_t> EntryList;
+	EntryList::iterator lookup(size_t hash, const char* text, const TextKey& key) const;
+	EntryList _entries;	// the most recently used at the front
+	std::unordered_multimap<size_t, EntryList::iterator> _index;
+	unsigned int _capacity;
+	unsigned int _hits;
+	unsigned int _misses;
+};
+
+NS_REK_END
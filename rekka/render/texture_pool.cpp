@@ -0,0 +1,127 @@
+#include "texture_pool.h"
+
+NS_REK_BEGIN
+
+// textures kept for reuse, the least recently released are freed first
+#define TEXTURE_POOL_BUDGET (32 * 1024 * 1024)
+
+TexturePool* TexturePool::s_sharedTexturePool = nullptr;
+TexturePool* TexturePool::getInstance()
+{
+	if (!s_sharedTexturePool) s_sharedTexturePool = new (std::nothrow) TexturePool();
+	return s_sharedTexturePool;
+}
+
+void TexturePool::destroyInstance()
+{
+	SAFE_DELETE(s_sharedTexturePool);
+}
+
+TexturePool::TexturePool()
+: _pooledBytes(0), _reuseCount(0)
+{
+}
+
+TexturePool::~TexturePool()
+{
+	purge();
+}
+
+static inline unsigned int textureBytes(gpu::Image* image)
+{
+	return image->texture_w * image->texture_h * 4;
+}
+
+static inline Uint16 powerOfTwoAbove(int n)
+{
+	Uint16 result = 1;
+	while (result < n) result <<= 1;
+	return result;
+}
+
+void TexturePool::bucketSize(int w, int h, Uint16& bucketW, Uint16& bucketH)
+{
+	bucketW = w;
+	bucketH = h;
+	// the texture CreateImage would make, so pooled textures are found by their size
+	if (!gpu::IsFeatureEnabled(gpu::FEATURE_NON_POWER_OF_TWO)) {
+		bucketW = powerOfTwoAbove(bucketW);
+		bucketH = powerOfTwoAbove(bucketH);
+	}
+}
+
+bool TexturePool::fits(gpu::Image* image, int w, int h)
+{
+	if (!image || w <= 0 || h <= 0) return false;
+	Uint16 bucketW, bucketH;
+	bucketSize(w, h, bucketW, bucketH);
+	return image->texture_w == bucketW && image->texture_h == bucketH;
+}
+
+gpu::Image* TexturePool::acquire(int w, int h)
+{
+	if (w <= 0 || h <= 0) return nullptr;
+	Uint16 bucketW, bucketH;
+	bucketSize(w, h, bucketW, bucketH);
+	gpu::Image* image = nullptr;
+	for (auto it = _images.rbegin(); it != _images.rend(); ++it) {
+		if ((*it)->texture_w == bucketW && (*it)->texture_h == bucketH) {
+			image = *it;
+			_images.erase(std::next(it).base());
+			_pooledBytes -= textureBytes(image);
+			_reuseCount++;
+			break;
+		}
+	}
+	if (!image) {
+		image = gpu::CreateImage(bucketW, bucketH, gpu::FORMAT_RGBA);
+		if (!image) return nullptr;
+		if (!gpu::LoadTarget(image)) {
+			gpu::FreeImage(image);
+			return nullptr;
+		}
+	}
+	gpu::SetImageSize(image, w, h);
+	// as a new image would be
+	gpu::SetColor(image, { 0xff, 0xff, 0xff, 0xff });
+	gpu::SetBlending(image, true);
+	gpu::SetBlendMode(image, gpu::BLEND_PREMULTIPLIED_ALPHA);
+	gpu::SetImageFilter(image, gpu::FILTER_LINEAR);
+	gpu::SetWrapMode(image, gpu::WRAP_NONE, gpu::WRAP_NONE);
+	gpu::UnsetTargetColor(image->target);
+	gpu::ClearRGBA(image->target, 0, 0, 0, 0);
+	return image;
+}
+
+void TexturePool::release(gpu::Image* image)
+{
+	if (!image) return;
+	// a pattern may still sample an alias of the texture
+	bool reusable = image->format == gpu::FORMAT_RGBA && !image->is_alias && !image->has_mipmaps &&
+		!image->using_virtual_resolution && image->target && !gpu::IsImageShared(image);
+	if (!reusable || textureBytes(image) > TEXTURE_POOL_BUDGET) {
+		gpu::FreeImage(image);
+		return;
+	}
+	evict(TEXTURE_POOL_BUDGET - textureBytes(image));
+	_images.push_back(image);
+	_pooledBytes += textureBytes(image);
+}
+
+void TexturePool::evict(unsigned int budget)
+{
+	size_t count = 0;
+	while (count < _images.size() && _pooledBytes > budget) {
+		_pooledBytes -= textureBytes(_images[count]);
+		gpu::FreeImage(_images[count]);
+		count++;
+	}
+	_images.erase(_images.begin(), _images.begin() + count);
+}
+
+void TexturePool::purge()
+{
+	evict(0);
+}
+
+NS_REK_END
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "rekka.h"
+#include <vector>
+
+NS_REK_BEGIN
+
+// recycles the render-to-texture storage of offscreen canvases of the same size.
+// Textures are not shared by smaller sizes, linear filtering would blend the unused
+// texels into the right and bottom edges of scaled draws
+class TexturePool {
+private:
+	static TexturePool* s_sharedTexturePool;
+public:
+	TexturePool();
+	~TexturePool();
+	static TexturePool* getInstance();
+	static void destroyInstance();
+	// a cleared RGBA image of w x h with its target loaded, the texture is only
+	// larger where power of two textures are required
+	gpu::Image* acquire(int w, int h);
+	// whether the image's texture is the one acquire(w, h) would give
+	bool fits(gpu::Image* image, int w, int h);
+	// give back an image from acquire(), images in use elsewhere are freed instead
+	void release(gpu::Image* image);
+	void purge();
+	unsigned int getPooledBytes() const { return _pooledBytes; }
+	unsigned int getReuseCount() const { return _reuseCount; }
+private:
+	void bucketSize(int w, int h, Uint16& bucketW, Uint16& bucketH);
+	void evict(unsigned int budget);
+	std::vector<gpu::Image*> _images;	// the most recently released at the back
+	unsigned int _pooledBytes;
+	unsigned int _reuseCount;
+};
+
+NS_REK_END
@@ -91,7 +91,11 @@ bool Timer::update(float dt)
 	_cooldown -= dt;
 	if (_cooldown <= 0) {
 		fire();
-		if (_repeat) _cooldown += _interval;
+		if (_repeat) {
+			_cooldown += _interval;
+			// missed ticks (e.g. throttled while paused) are dropped, not replayed in a burst
+			if (_cooldown <= 0) _cooldown = _interval;
+		}
 		if (!_repeat) return false;
 	}
 	return true;
@@ -1,4 +1,5 @@
 #include "script_core.h"
+#include "trace.h"
 #include "SDL.h"
 
 NS_REK_BEGIN
@@ -15,8 +16,11 @@ void ScriptCore::destroyInstance()
 	SAFE_DELETE(s_sharedScriptCore);
 }
 
+const JSClass* ScriptCore::s_domClasses[kDOMProtoCount] = { nullptr };
+static const js::DOMCallbacks s_domCallbacks = { ScriptCore::instanceClassMatchesProto };
+
 ScriptCore::ScriptCore()
-: _rt(nullptr), _ctx(nullptr), _global(nullptr)
+: _rt(nullptr), _ctx(nullptr), _global(nullptr), _gcStart(0), _gcTime(0), _gcNumber(0)
 {
 }
 
@@ -26,6 +30,8 @@ bool ScriptCore::initEngine(uint32_t maxBytes, size_t stackSize)
 	_rt = JS_NewRuntime(maxBytes);
 	_ctx = JS_NewContext(_rt, stackSize);
 	JS_SetErrorReporter(_rt, ScriptCore::reportError);
+	JS_SetGCCallback(_rt, ScriptCore::gcCallback, this);
+	js::SetDOMCallbacks(_rt, &s_domCallbacks);
 
 	static JSClass global_class = {
 		"global", JSCLASS_GLOBAL_FLAGS,
@@ -65,6 +71,80 @@ void ScriptCore::forceGC()
 	JS_GC(_rt);	
 }
 
+void ScriptCore::gcCallback(JSRuntime* rt, JSGCStatus status, void* data)
+{
+	ScriptCore* scripter = (ScriptCore*)data;
+	if (status == JSGC_BEGIN) {
+		scripter->_gcStart = SDL_GetPerformanceCounter();
+		scripter->_gcNumber++;
+	}
+	else if (status == JSGC_END && scripter->_gcStart) {
+		Uint64 now = SDL_GetPerformanceCounter();
+		scripter->_gcTime += (now - scripter->_gcStart) * 1000.0 / SDL_GetPerformanceFrequency();
+		if (Tracer::isEnabled()) Tracer::getInstance()->addZone("GC", scripter->_gcStart, now);
+		scripter->_gcStart = 0;
+	}
+}
+
+void ScriptCore::registerDOMClass(DOMProtoID protoID, const JSClass* clasp)
+{
+	s_domClasses[protoID] = clasp;
+}
+
+bool ScriptCore::instanceClassMatchesProto(const js::Class* clasp, uint32_t protoID, uint32_t depth)
+{
+	// no DOM inheritance here, every class is its own prototype
+	return protoID < kDOMProtoCount && depth == 0 && s_domClasses[protoID] && js::Valueify(s_domClasses[protoID]) == clasp;
+}
+
+void* ScriptCore::unwrapDOMThis(JSContext* ctx, const JS::CallArgs& args, const JSJitInfo* info, JS::MutableHandleObject obj)
+{
+	if (args.thisv().isObject()) {
+		obj.set(&args.thisv().toObject());
+		if (instanceClassMatchesProto(js::GetObjectClass(obj), info->protoID, info->depth)) {
+			return JS_GetReservedSlot(obj, 0).toPrivate();
+		}
+	}
+	JS_ReportError(ctx, "Illegal invocation");
+	return nullptr;
+}
+
+bool ScriptCore::jitGenericMethod(JSContext* ctx, unsigned argc, JS::Value* vp)
+{
+	JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+	const JSJitInfo* info = FUNCTION_VALUE_TO_JITINFO(args.calleev());
+	JS::RootedObject obj(ctx);
+	void* self = unwrapDOMThis(ctx, args, info, &obj);
+	if (!self) return false;
+	return info->method(ctx, obj, self, JSJitMethodCallArgs(args));
+}
+
+bool ScriptCore::jitGenericGetter(JSContext* ctx, unsigned argc, JS::Value* vp)
+{
+	JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+	const JSJitInfo* info = FUNCTION_VALUE_TO_JITINFO(args.calleev());
+	JS::RootedObject obj(ctx);
+	void* self = unwrapDOMThis(ctx, args, info, &obj);
+	if (!self) return false;
+	return info->getter(ctx, obj, self, JSJitGetterCallArgs(args));
+}
+
+bool ScriptCore::jitGenericSetter(JSContext* ctx, unsigned argc, JS::Value* vp)
+{
+	JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+	const JSJitInfo* info = FUNCTION_VALUE_TO_JITINFO(args.calleev());
+	JS::RootedObject obj(ctx);
+	void* self = unwrapDOMThis(ctx, args, info, &obj);
+	if (!self) return false;
+	if (args.length() == 0) {
+		JS_ReportError(ctx, "Setter requires an argument");
+		return false;
+	}
+	if (!info->setter(ctx, obj, self, JSJitSetterCallArgs(args))) return false;
+	args.rval().setUndefined();
+	return true;
+}
+
 void ScriptCore::reportError(JSContext* ctx, const char* message, JSErrorReport* report)
 {
 	std::string fileName = report->filename ? report->filename : "<no filename>";
@@ -75,6 +155,7 @@ void ScriptCore::reportError(JSContext* ctx, const char* message, JSErrorReport*
 
 bool ScriptCore::runScript(const char* fileName)
 {
+	TRACE_SCOPE("ScriptCore::runScript");
 	JS::RootedValue rval(_ctx);
 	JS::CompileOptions opts(_ctx);
 	opts.setUTF8(true);
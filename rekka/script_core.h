@@ -11,7 +11,35 @@
 #define JS_PROPGET_IMPL(klass, name) bool klass::js_get_##name(JSContext *ctx, unsigned argc, JS::Value *vp)
 #define JS_PROPSET_IMPL(klass, name) bool klass::js_set_##name(JSContext *ctx, unsigned argc, JS::Value *vp)
 
+// DOM-style natives described by JSJitInfo, Ion calls them directly once the class of this is known.
+// The class needs JSCLASS_IS_DOMJSCLASS, the native pointer in reserved slot 0 and ScriptCore::registerDOMClass
+#define JS_JIT_FUNC_DECL(name) static bool jit_##name(JSContext *ctx, JS::HandleObject js_this, void *self, const JSJitMethodCallArgs &args);
+#define JS_JIT_FUNC_IMPL(klass, name) bool klass::jit_##name(JSContext *ctx, JS::HandleObject js_this, void *self, const JSJitMethodCallArgs &args)
+#define JS_JIT_PROPGET_DECL(name) static bool jit_get_##name(JSContext *ctx, JS::HandleObject js_this, void *self, JSJitGetterCallArgs args);
+#define JS_JIT_PROPSET_DECL(name) static bool jit_set_##name(JSContext *ctx, JS::HandleObject js_this, void *self, JSJitSetterCallArgs args);
+#define JS_JIT_PROPGET_IMPL(klass, name) bool klass::jit_get_##name(JSContext *ctx, JS::HandleObject js_this, void *self, JSJitGetterCallArgs args)
+#define JS_JIT_PROPSET_IMPL(klass, name) bool klass::jit_set_##name(JSContext *ctx, JS::HandleObject js_this, void *self, JSJitSetterCallArgs args)
+
+// Methods and setters change the state read by the getters, so they alias everything, and the getters
+// are neither movable nor eliminatable, Ion must not reuse a value read before a save/restore.
+// The op union can only be initialised through its first member, void (*)() keeps the casts warning free
+#define JS_JIT_OP(op) (JSJitGetterOp)(void (*)())(op)
+#define JS_JIT_METHOD_INFO(klass, name, protoID, argTypes) \
+	{ { { JS_JIT_OP(klass::jit_##name) }, { protoID }, 0, JSJitInfo::Method, JSJitInfo::AliasEverything, JSVAL_TYPE_UNDEFINED, \
+	false, false, false, false, false, true, 0 }, argTypes }
+#define JS_JIT_GETTER_INFO(klass, name, protoID, returnType) \
+	{ { klass::jit_get_##name }, { protoID }, 0, JSJitInfo::Getter, JSJitInfo::AliasDOMSets, returnType, \
+	true, false, false, false, false, false, 0 }
+#define JS_JIT_SETTER_INFO(klass, name, protoID) \
+	{ { JS_JIT_OP(klass::jit_set_##name) }, { protoID }, 0, JSJitInfo::Setter, JSJitInfo::AliasEverything, JSVAL_TYPE_UNDEFINED, \
+	false, false, false, false, false, false, 0 }
+
 #define JS_FUNC_DEF(klass, func) JS_FN(#func, klass::js_##func, 0, JSPROP_PERMANENT | JSPROP_ENUMERATE)
+#define JS_JIT_FUNC_DEF(func, info) JS_FNINFO(#func, ScriptCore::jitGenericMethod, &info.base, 0, JSPROP_PERMANENT | JSPROP_ENUMERATE)
+#define JS_JIT_PROP_DEF(prop, getinfo, setinfo) { #prop, uint8_t(JSPROP_PERMANENT | JSPROP_ENUMERATE | JSPROP_SHARED), \
+	{ { ScriptCore::jitGenericGetter, &getinfo } }, { { ScriptCore::jitGenericSetter, &setinfo } } }
+#define JS_JIT_PROP_SET_DEF(klass, prop, setinfo) { #prop, uint8_t(JSPROP_PERMANENT | JSPROP_ENUMERATE | JSPROP_SHARED), \
+	{ { klass::js_get_##prop, nullptr } }, { { ScriptCore::jitGenericSetter, &setinfo } } }
 #define JS_PROP_DEF(klass, prop) JS_PSGS(#prop, klass::js_get_##prop, klass::js_set_##prop, JSPROP_PERMANENT | JSPROP_ENUMERATE)
 #define JS_PROP_GET_DEF(klass, prop) JS_PSG(#prop, klass::js_get_##prop, JSPROP_PERMANENT | JSPROP_ENUMERATE)
 
@@ -20,6 +48,8 @@
 	JS::RootedObject js_this(ctx, args.thisv().toObjectOrNull()); \
 	klass* pthis = (klass*)JS_GetPrivate(js_this)
 
+#define JS_BEGIN_JIT_ARG_THIS(klass) klass* pthis = (klass*)self
+
 #define JS_REF_ARG(name, index) const auto& name = args.get(index)
 #define JS_ROOT_OBJECT_ARG(name, index) JS::RootedObject name(ctx, JS::ToObject(ctx, args.get(index)));
 
@@ -53,6 +83,13 @@ inline void _SetRetval(JSContext* ctx, JS::MutableHandleValue rval, const char*
 
 NS_REK_BEGIN
 
+// JSJitInfo prototype ids of the DOM-style classes
+typedef enum {
+	kDOMProtoNone = 0,
+	kDOMProtoCanvasContext2D,
+	kDOMProtoCount
+} DOMProtoID;
+
 class ScriptCore {
 private:
 	ScriptCore();
@@ -69,13 +106,30 @@ public:
 	JS::PersistentRootedObject& getDebugGlobalObject() { return *_debugGlobal; }
 	static void printJSStack(JSContext *ctx);
 	void forceGC();
+	// total time (ms) spent in garbage collection
+	double getGCTime() const { return _gcTime; }
+	// number of garbage collections so far
+	uint32_t getGCNumber() const { return _gcNumber; }
+
+	static void registerDOMClass(DOMProtoID protoID, const JSClass* clasp);
+	static bool instanceClassMatchesProto(const js::Class* clasp, uint32_t protoID, uint32_t depth);
+	// JSNatives of the JSJitInfo ops for the interpreter and baseline, they check and unwrap this
+	static bool jitGenericMethod(JSContext* ctx, unsigned argc, JS::Value* vp);
+	static bool jitGenericGetter(JSContext* ctx, unsigned argc, JS::Value* vp);
+	static bool jitGenericSetter(JSContext* ctx, unsigned argc, JS::Value* vp);
 private:
 	static void reportError(JSContext *ctx, const char *message, JSErrorReport *report);	
+	static void gcCallback(JSRuntime* rt, JSGCStatus status, void* data);
+	static void* unwrapDOMThis(JSContext* ctx, const JS::CallArgs& args, const JSJitInfo* info, JS::MutableHandleObject obj);
+	static const JSClass* s_domClasses[kDOMProtoCount];
 private:
 	JSRuntime* _rt;
 	JSContext* _ctx;
 	JS::PersistentRootedObject*	_global;
 	JS::PersistentRootedObject*	_debugGlobal;
+	Uint64 _gcStart;
+	double _gcTime;
+	uint32_t _gcNumber;
 };
 
 NS_REK_END
\ No newline at end of file
@@ -0,0 +1,224 @@
+#include "stats.h"
+#include "render/font_manager.h"
+#include "render/image_manager.h"
+#include "audio/audio_manager.h"
+
+NS_REK_BEGIN
+
+#define OVERLAY_FONT_SIZE 12
+#define OVERLAY_MARGIN 4
+
+Stats* Stats::s_sharedStats = nullptr;
+Stats* Stats::getInstance()
+{
+	if (!s_sharedStats) s_sharedStats = new (std::nothrow) Stats();
+	return s_sharedStats;
+}
+
+void Stats::destroyInstance()
+{
+	SAFE_DELETE(s_sharedStats);
+}
+
+Stats::Stats()
+: _enabled(false), _overlay(false), _frameStart(0), _scriptTime(0), _gcTimeBase(0),
+_textHitsBase(0), _textMissesBase(0), _glyphHitsBase(0), _glyphMissesBase(0), _imagesDecodedBase(0), _soundsLoadedBase(0)
+{
+	memset(&_last, 0, sizeof(_last));
+	memset(&_overlayRender, 0, sizeof(_overlayRender));
+	memset(_overlayImages, 0, sizeof(_overlayImages));
+}
+
+Stats::~Stats()
+{
+	releaseOverlay();
+}
+
+void Stats::releaseOverlay()
+{
+	for (int i = 0; i < STATS_OVERLAY_LINES; i++) {
+		if (_overlayImages[i]) gpu::FreeImage(_overlayImages[i]);
+		_overlayImages[i] = nullptr;
+		_overlayTexts[i].clear();
+	}
+}
+
+void Stats::setEnabled(bool enable)
+{
+	if (enable && !_enabled) {
+		// the counters kept running while off, start the next frame from here
+		gpu::ResetRenderStats();
+		memset(&_overlayRender, 0, sizeof(_overlayRender));
+		_gcTimeBase = ScriptCore::getInstance()->getGCTime();
+		auto fontmgr = FontManager::getInstance();
+		_textHitsBase = fontmgr->getTextCacheHits();
+		_textMissesBase = fontmgr->getTextCacheMisses();
+		auto glyphs = fontmgr->getGlyphCacheStats();
+		_glyphHitsBase = glyphs.hits;
+		_glyphMissesBase = glyphs.misses;
+		_imagesDecodedBase = ImageManager::getInstance()->getDecodedCount();
+		_soundsLoadedBase = AudioManager::getInstance()->getLoadedCount();
+	}
+	_enabled = enable;
+	if (!enable) {
+		_overlay = false;
+		releaseOverlay();
+	}
+}
+
+void Stats::beginFrame()
+{
+	_frameStart = SDL_GetPerformanceCounter();
+	_scriptTime = 0;
+}
+
+void Stats::endFrame()
+{
+	auto render = gpu::GetRenderStats();
+	gpu::ResetRenderStats();
+	_last.flushes = render.flushes - _overlayRender.flushes;
+	_last.drawCalls = render.draw_calls - _overlayRender.draw_calls;
+	_last.vertices = render.vertices - _overlayRender.vertices;
+	_last.textureBinds = render.texture_binds - _overlayRender.texture_binds;
+	_last.framebufferBinds = render.framebuffer_binds - _overlayRender.framebuffer_binds;
+	_last.shaderSwitches = render.shader_switches - _overlayRender.shader_switches;
+	_last.uploadBytes = render.upload_bytes - _overlayRender.upload_bytes;
+	memset(&_overlayRender, 0, sizeof(_overlayRender));
+
+	_last.frameTime = _frameStart ? (SDL_GetPerformanceCounter() - _frameStart) * 1000.0 / SDL_GetPerformanceFrequency() : 0;
+	_last.jsTime = _scriptTime;
+	double gcTime = ScriptCore::getInstance()->getGCTime();
+	_last.gcTime = gcTime - _gcTimeBase;
+	_gcTimeBase = gcTime;
+
+	// the managers count since startup, report the difference
+	auto fontmgr = FontManager::getInstance();
+	_last.textCacheHits = fontmgr->getTextCacheHits() - _textHitsBase;
+	_last.textCacheMisses = fontmgr->getTextCacheMisses() - _textMissesBase;
+	_textHitsBase = fontmgr->getTextCacheHits();
+	_textMissesBase = fontmgr->getTextCacheMisses();
+	_last.textCacheBytes = fontmgr->getTextCacheBytes();
+	auto glyphs = fontmgr->getGlyphCacheStats();
+	_last.glyphCacheHits = glyphs.hits - _glyphHitsBase;
+	_last.glyphCacheMisses = glyphs.misses - _glyphMissesBase;
+	_glyphHitsBase = glyphs.hits;
+	_glyphMissesBase = glyphs.misses;
+	auto imagemgr = ImageManager::getInstance();
+	_last.imagesDecoded = imagemgr->getDecodedCount() - _imagesDecodedBase;
+	_imagesDecodedBase = imagemgr->getDecodedCount();
+	auto audiomgr = AudioManager::getInstance();
+	_last.soundsLoaded = audiomgr->getLoadedCount() - _soundsLoadedBase;
+	_soundsLoadedBase = audiomgr->getLoadedCount();
+	_last.soundsPlaying = audiomgr->getPlayingCount();
+}
+
+void Stats::drawOverlay(gpu::Target* screen)
+{
+	if (!_overlay) return;
+	char lines[STATS_OVERLAY_LINES][0x80];
+	sprintf(lines[0], "frame %.2fms js %.2fms gc %.2fms", _last.frameTime, _last.jsTime, _last.gcTime);
+	sprintf(lines[1], "draw %u vert %u flush %u tex %u fbo %u shader %u upload %uKB",
+		_last.drawCalls, _last.vertices, _last.flushes, _last.textureBinds, _last.framebufferBinds, _last.shaderSwitches, _last.uploadBytes >> 10);
+	sprintf(lines[2], "text %u/%u image %u sound %u/%d",
+		_last.textCacheHits, _last.textCacheHits + _last.textCacheMisses, _last.imagesDecoded, _last.soundsLoaded, _last.soundsPlaying);
+
+	bool useClip = screen->use_clip_rect;
+	GPU_Rect clipRect = screen->clip_rect;
+	bool useColor = screen->use_color;
+	SDL_Color color = screen->color;
+	gpu::BlendMode blend = gpu::GetContextTarget()->context->shapes_blend_mode;
+	gpu::UnsetClip(screen);
+	gpu::UnsetTargetColor(screen);
+
+	// the frame's own batch goes first, so that only the overlay's work is measured below
+	gpu::FlushBlitBuffer();
+	auto renderBase = gpu::GetRenderStats();
+	auto fontmgr = FontManager::getInstance();
+	auto glyphsBase = fontmgr->getGlyphCacheStats();
+
+	float lineHeight = OVERLAY_FONT_SIZE + 2;
+	gpu::SetShapeBlendFunction(gpu::FUNC_ONE, gpu::FUNC_ONE_MINUS_SRC_ALPHA, gpu::FUNC_ONE, gpu::FUNC_ONE_MINUS_SRC_ALPHA);
+	gpu::RectangleFilled(screen, 0, 0, screen->w, lineHeight * STATS_OVERLAY_LINES + OVERLAY_MARGIN * 2, { 0, 0, 0, 0xa0 });
+	Font font = { 0/* sans-serif */, OVERLAY_FONT_SIZE, false, false };
+	for (int i = 0; i < STATS_OVERLAY_LINES; i++) {
+		// kept out of the text cache, which would fill up with numbers of past frames
+		if (_overlayTexts[i] != lines[i]) {
+			if (_overlayImages[i]) gpu::FreeImage(_overlayImages[i]);
+			_overlayImages[i] = fontmgr->drawText(lines[i], false, font, kTextBaselineTop, kTextAlignLeft);
+			_overlayTexts[i] = lines[i];
+		}
+		if (_overlayImages[i]) gpu::Blit(_overlayImages[i], nullptr, screen, OVERLAY_MARGIN, OVERLAY_MARGIN + lineHeight * i);
+	}
+
+	gpu::FlushBlitBuffer();
+	auto render = gpu::GetRenderStats();
+	_overlayRender.flushes = render.flushes - renderBase.flushes;
+	_overlayRender.draw_calls = render.draw_calls - renderBase.draw_calls;
+	_overlayRender.vertices = render.vertices - renderBase.vertices;
+	_overlayRender.texture_binds = render.texture_binds - renderBase.texture_binds;
+	_overlayRender.framebuffer_binds = render.framebuffer_binds - renderBase.framebuffer_binds;
+	_overlayRender.shader_switches = render.shader_switches - renderBase.shader_switches;
+	_overlayRender.upload_bytes = render.upload_bytes - renderBase.upload_bytes;
+	// the overlay's glyphs are not the frame's either, move the bases past them
+	auto glyphs = fontmgr->getGlyphCacheStats();
+	_glyphHitsBase += glyphs.hits - glyphsBase.hits;
+	_glyphMissesBase += glyphs.misses - glyphsBase.misses;
+
+	gpu::SetShapeBlendFunction(blend.source_color, blend.dest_color, blend.source_alpha, blend.dest_alpha);
+	if (useClip) gpu::SetClipRect(screen, clipRect);
+	if (useColor) gpu::SetTargetColor(screen, color);
+}
+
+JS_FUNC_IMPL(Stats, stats)
+{
+	JS_BEGIN_ARG;
+	bool enable = args.length() == 0 || JS::ToBoolean(args[0]);
+	auto pthis = Stats::getInstance();
+	// stats(false) turns collecting off, otherwise it is turned on and the numbers are valid from the next frame
+	pthis->setEnabled(enable);
+	if (!enable) JS_RETURN;
+	const FrameStats& s = pthis->_last;
+	JS::RootedObject result(ctx, JS_NewObject(ctx, nullptr));
+	JS::RootedValue v(ctx);
+#define SET_STAT(name, value) v.setNumber((double)(value)); JS_SetProperty(ctx, result, name, v)
+	SET_STAT("frameTime", s.frameTime);
+	SET_STAT("jsTime", s.jsTime);
+	SET_STAT("gcTime", s.gcTime);
+	SET_STAT("drawCalls", s.drawCalls);
+	SET_STAT("vertices", s.vertices);
+	SET_STAT("flushes", s.flushes);
+	SET_STAT("textureBinds", s.textureBinds);
+	SET_STAT("framebufferBinds", s.framebufferBinds);
+	SET_STAT("shaderSwitches", s.shaderSwitches);
+	SET_STAT("uploadBytes", s.uploadBytes);
+	SET_STAT("textCacheHits", s.textCacheHits);
+	SET_STAT("textCacheMisses", s.textCacheMisses);
+	SET_STAT("textCacheBytes", s.textCacheBytes);
+	SET_STAT("glyphCacheHits", s.glyphCacheHits);
+	SET_STAT("glyphCacheMisses", s.glyphCacheMisses);
+	SET_STAT("imagesDecoded", s.imagesDecoded);
+	SET_STAT("soundsLoaded", s.soundsLoaded);
+	SET_STAT("soundsPlaying", s.soundsPlaying);
+#undef SET_STAT
+	JS_RET(result);
+}
+
+JS_FUNC_IMPL(Stats, showStats)
+{
+	JS_BEGIN_ARG;
+	JS_BOOL_ARG(enable, 0);
+	Stats::getInstance()->setOverlay(enable);
+	JS_RETURN;
+}
+
+void Stats::jsb_register(JSContext* ctx, JS::HandleObject rekkaobj)
+{
+	static JSFunctionSpec stats_funcs[] = {
+		JS_FUNC_DEF(Stats, stats),
+		JS_FUNC_DEF(Stats, showStats),
+		JS_FS_END
+	};
+	JS_DefineFunctions(ctx, rekkaobj, stats_funcs);
+}
+
+NS_REK_END
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "rekka.h"
+#include "script_core.h"
+
+NS_REK_BEGIN
+
+// per-frame counters, gathered from the renderer and the managers
+struct FrameStats {
+	// renderer
+	Uint32 flushes;
+	Uint32 drawCalls;
+	Uint32 vertices;
+	Uint32 textureBinds;
+	Uint32 framebufferBinds;
+	Uint32 shaderSwitches;
+	Uint32 uploadBytes;
+	// runtime, ms
+	float frameTime;
+	float jsTime;
+	float gcTime;
+	// managers
+	Uint32 textCacheHits;
+	Uint32 textCacheMisses;
+	Uint32 textCacheBytes;	// held by the text image cache
+	Uint32 glyphCacheHits;
+	Uint32 glyphCacheMisses;
+	Uint32 imagesDecoded;
+	Uint32 soundsLoaded;
+	int soundsPlaying;
+};
+
+#define STATS_OVERLAY_LINES 3
+
+class Stats {
+private:
+	Stats();
+	~Stats();
+	static Stats* s_sharedStats;
+public:
+	static Stats* getInstance();
+	static void destroyInstance();
+	static void jsb_register(JSContext* ctx, JS::HandleObject rekkaobj);
+public:
+	JS_FUNC_DECL(stats)
+	JS_FUNC_DECL(showStats)
+public:
+	bool isEnabled() const { return _enabled; }
+	// turning it off also hides the overlay
+	void setEnabled(bool enable);
+	void setOverlay(bool enable) { setEnabled(enable); _overlay = enable; }
+
+	void beginFrame();
+	// time spent in script callbacks of the frame
+	void addScriptTime(double ms) { _scriptTime += ms; }
+	// draw the overlay of the last frame, call before Flip, its own work is left out of the counters
+	void drawOverlay(gpu::Target* screen);
+	// snapshot the counters of the frame and reset the renderer's
+	void endFrame();
+	const FrameStats& getLastFrame() const { return _last; }
+private:
+	bool _enabled;
+	bool _overlay;
+	FrameStats _last;
+	Uint64 _frameStart;
+	double _scriptTime;
+	double _gcTimeBase;
+	Uint32 _textHitsBase;
+	Uint32 _textMissesBase;
+	Uint32 _glyphHitsBase;
+	Uint32 _glyphMissesBase;
+	Uint32 _imagesDecodedBase;
+	Uint32 _soundsLoadedBase;
+	gpu::RenderStats _overlayRender;
+	// rendered again only when their text changes
+	std::string _overlayTexts[STATS_OVERLAY_LINES];
+	gpu::Image* _overlayImages[STATS_OVERLAY_LINES];
+	void releaseOverlay();
+};
+
+NS_REK_END
@@ -1,5 +1,6 @@
 #include "file_loader.h"
 #include "scheduler.h"
+#include "trace.h"
 
 NS_REK_BEGIN
 
@@ -36,6 +37,7 @@ void FileLoader::loadFileAsync(const std::string &filepath, const std::function<
 
 void FileLoader::fetchFileFunc()
 {	 
+	if (Tracer::isEnabled()) Tracer::getInstance()->setThreadName("FileLoader");
 	bool firstloop = true;	
 	while (true) {
 		// get any request
@@ -48,7 +50,10 @@ void FileLoader::fetchFileFunc()
 		// exit thread when request queue is empty
 		if (!fetchStruct) break;
 		// handle request, load image		
-		fetchStruct->data = fetchFileContent(fetchStruct->filename.c_str(), &fetchStruct->dataLength);
+		{
+			TRACE_SCOPE("FileLoader::fetchFileContent");
+			fetchStruct->data = fetchFileContent(fetchStruct->filename.c_str(), &fetchStruct->dataLength);
+		}
 		// response
 		_responseMutex.lock();
 		_responseQueue.push_back(fetchStruct);
@@ -67,6 +72,7 @@ void FileLoader::fetchDoneCallBack()
 	_responseMutex.unlock();
 
 	if (fetchStruct) {
+		TRACE_SCOPE("FileLoader::fetchDone");
 		fetchStruct->callback(fetchStruct->data, fetchStruct->dataLength);
 		delete fetchStruct;
 		--_asyncRefCount;
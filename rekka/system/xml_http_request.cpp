@@ -2,6 +2,7 @@
 #include "core.h"
 #include "scheduler.h"
 #include "file_loader.h"
+#include "trace.h"
 #include <regex>
 #include <algorithm>
 
@@ -170,13 +171,20 @@ void XMLHttpRequest::fetchFile()
 }
 void XMLHttpRequest::sendHTTPAsyncThread()
 {
-	curl_easy_perform(_curl);
+	if (Tracer::isEnabled()) Tracer::getInstance()->setThreadName("XMLHttpRequest");
+	{
+		TRACE_SCOPE("XMLHttpRequest::send");
+		curl_easy_perform(_curl);
+	}
 	_readyState = 4;
 	Scheduler::getInstance()->performInMainThread(std::bind(&XMLHttpRequest::sendDone, this, true));
 }
 void XMLHttpRequest::sendHTTP()
 {
-	curl_easy_perform(_curl);
+	{
+		TRACE_SCOPE("XMLHttpRequest::send");
+		curl_easy_perform(_curl);
+	}
 	_readyState = 4;
 	sendDone(false);
 }
@@ -0,0 +1,216 @@
+#include "trace.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+NS_REK_BEGIN
+
+namespace {
+// hands the buffer back when the thread exits, loader threads come and go
+struct ThreadTraceBuffer {
+	TraceBuffer* buffer;
+	int tid;
+	ThreadTraceBuffer() : buffer(nullptr), tid(0) {}
+	~ThreadTraceBuffer() { if (buffer) Tracer::getInstance()->releaseBuffer(buffer); }
+};
+thread_local ThreadTraceBuffer t_traceBuffer;
+}
+
+Tracer* Tracer::s_sharedTracer = nullptr;
+std::atomic<bool> Tracer::s_enabled(false);
+Tracer* Tracer::getInstance()
+{
+	if (!s_sharedTracer) s_sharedTracer = new (std::nothrow) Tracer();
+	return s_sharedTracer;
+}
+
+Tracer::Tracer()
+: _tidCounter(0), _defaultPath("trace.json")
+{
+	_baseTicks = SDL_GetPerformanceCounter();
+}
+
+void Tracer::setEnabled(bool enable)
+{
+	s_enabled.store(enable);
+	// the renderer lives on the main thread, so does this call
+	gpu::SetFlushCallback(enable ? Tracer::flushCallback : nullptr);
+}
+
+void Tracer::flushCallback(Uint64 start, Uint64 end, int numVertices)
+{
+	Tracer::getInstance()->addZone("FlushBlitBuffer", start, end);
+}
+
+TraceBuffer* Tracer::acquireBuffer()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto buffer : _buffers) {
+		if (!buffer->inUse) {
+			buffer->inUse = true;
+			return buffer;
+		}
+	}
+	TraceBuffer* buffer = new (std::nothrow) TraceBuffer();
+	if (!buffer) return nullptr;
+	buffer->inUse = true;
+	_buffers.push_back(buffer);
+	return buffer;
+}
+
+void Tracer::releaseBuffer(TraceBuffer* buffer)
+{
+	// keep the events, the next thread appends after them
+	std::lock_guard<std::mutex> lock(_mutex);
+	buffer->inUse = false;
+}
+
+void Tracer::setThreadName(const char* name)
+{
+	auto& local = t_traceBuffer;
+	if (!local.tid) local.tid = ++_tidCounter;
+	std::lock_guard<std::mutex> lock(_mutex);
+	_threadNames[local.tid] = name;
+}
+
+void Tracer::addZone(const char* name, Uint64 start, Uint64 end)
+{
+	auto& local = t_traceBuffer;
+	if (!local.buffer) {
+		if (!local.tid) local.tid = ++_tidCounter;
+		local.buffer = acquireBuffer();
+		if (!local.buffer) return;
+	}
+	Uint32 head = local.buffer->head.load(std::memory_order_relaxed);
+	TraceEvent& event = local.buffer->events[head % TRACE_BUFFER_CAPACITY];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	event.tid = local.tid;
+	local.buffer->head.store(head + 1, std::memory_order_release);
+}
+
+const char* Tracer::intern(const char* name)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _names.insert(name).first->c_str();
+}
+
+bool Tracer::dump(const char* path)
+{
+	double tickToUs = 1000000.0 / SDL_GetPerformanceFrequency();
+	rapidjson::StringBuffer sb;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+	writer.StartObject();
+	writer.Key("traceEvents");
+	writer.StartArray();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& itr : _threadNames) {
+			writer.StartObject();
+			writer.Key("name"); writer.String("thread_name");
+			writer.Key("ph"); writer.String("M");
+			writer.Key("pid"); writer.Int(1);
+			writer.Key("tid"); writer.Int(itr.first);
+			writer.Key("args"); writer.StartObject();
+			writer.Key("name"); writer.String(itr.second.c_str());
+			writer.EndObject();
+			writer.EndObject();
+		}
+		std::vector<TraceEvent> events;
+		for (auto buffer : _buffers) {
+			// writers go on meanwhile, copy the slots first and check the head again afterwards
+			Uint32 head = buffer->head.load(std::memory_order_acquire);
+			Uint32 count = head < TRACE_BUFFER_CAPACITY ? head : TRACE_BUFFER_CAPACITY;
+			events.resize(count);
+			for (Uint32 i = 0; i < count; i++) {
+				events[i] = buffer->events[(head - count + i) % TRACE_BUFFER_CAPACITY];
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			// the writer may be filling the slot of head, which is the one of head - capacity,
+			// anything at or before that was possibly overwritten during the copy
+			Uint32 headAfter = buffer->head.load(std::memory_order_relaxed);
+			for (Uint32 i = 0; i < count; i++) {
+				if (headAfter - (head - count + i) >= TRACE_BUFFER_CAPACITY) continue;
+				const TraceEvent& event = events[i];
+				if (!event.name || event.end < event.start || event.start < _baseTicks) continue;
+				writer.StartObject();
+				writer.Key("name"); writer.String(event.name);
+				writer.Key("cat"); writer.String("rekka");
+				writer.Key("ph"); writer.String("X");
+				writer.Key("pid"); writer.Int(1);
+				writer.Key("tid"); writer.Int(event.tid);
+				writer.Key("ts"); writer.Double((event.start - _baseTicks) * tickToUs);
+				writer.Key("dur"); writer.Double((event.end - event.start) * tickToUs);
+				writer.EndObject();
+			}
+		}
+	}
+	writer.EndArray();
+	writer.Key("displayTimeUnit"); writer.String("ms");
+	writer.EndObject();
+
+	SDL_RWops* rwops = SDL_RWFromFile(path, "wb");
+	if (!rwops) {
+		SDL_LogError(0, "Failed to write trace %s: %s", path, SDL_GetError());
+		return false;
+	}
+	SDL_RWwrite(rwops, sb.GetString(), 1, sb.GetSize());
+	SDL_RWclose(rwops);
+	SDL_Log("Trace written to %s", path);
+	return true;
+}
+
+JS_FUNC_IMPL(Tracer, traceEnable)
+{
+	JS_BEGIN_ARG;
+	JS_BOOL_ARG(enable, 0);
+	Tracer::getInstance()->setEnabled(enable);
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Tracer, traceBegin)
+{
+	JS_BEGIN_ARG;
+	auto pthis = Tracer::getInstance();
+	if (!isEnabled()) JS_RETURN;
+	JS_STRING_ARG(name, 0);
+	pthis->_jsZones.push_back(std::make_pair(pthis->intern(name), SDL_GetPerformanceCounter()));
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Tracer, traceEnd)
+{
+	JS_BEGIN_ARG;
+	auto pthis = Tracer::getInstance();
+	// unbalanced ends, or zones opened before tracing was enabled, are ignored
+	if (pthis->_jsZones.empty()) JS_RETURN;
+	auto zone = pthis->_jsZones.back();
+	pthis->_jsZones.pop_back();
+	if (isEnabled()) pthis->addZone(zone.first, zone.second, SDL_GetPerformanceCounter());
+	JS_RETURN;
+}
+
+JS_FUNC_IMPL(Tracer, traceDump)
+{
+	JS_BEGIN_ARG;
+	auto pthis = Tracer::getInstance();
+	if (args.length() > 0) {
+		JS_STRING_ARG(path, 0);
+		JS_RET(pthis->dump(path));
+	}
+	JS_RET(pthis->dump(pthis->_defaultPath.c_str()));
+}
+
+void Tracer::jsb_register(JSContext* ctx, JS::HandleObject rekkaobj)
+{
+	static JSFunctionSpec tracer_funcs[] = {
+		JS_FUNC_DEF(Tracer, traceEnable),
+		JS_FUNC_DEF(Tracer, traceBegin),
+		JS_FUNC_DEF(Tracer, traceEnd),
+		JS_FUNC_DEF(Tracer, traceDump),
+		JS_FS_END
+	};
+	JS_DefineFunctions(ctx, rekkaobj, tracer_funcs);
+}
+
+NS_REK_END
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "rekka.h"
+#include "script_core.h"
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+
+NS_REK_BEGIN
+
+// events kept per thread, the oldest are overwritten
+#define TRACE_BUFFER_CAPACITY 16384
+
+struct TraceEvent {
+	const char* name;	// static or interned string
+	Uint64 start;		// SDL_GetPerformanceCounter ticks
+	Uint64 end;
+	int tid;
+};
+
+// single writer ring buffer, owned by one thread at a time
+struct TraceBuffer {
+	TraceEvent events[TRACE_BUFFER_CAPACITY];
+	std::atomic<Uint32> head;
+	bool inUse;
+	TraceBuffer() : head(0), inUse(false) {}
+};
+
+class Tracer {
+private:
+	Tracer();
+	static Tracer* s_sharedTracer;
+	static std::atomic<bool> s_enabled;
+public:
+	static Tracer* getInstance();
+	static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+	static void jsb_register(JSContext* ctx, JS::HandleObject rekkaobj);
+public:
+	JS_FUNC_DECL(traceEnable)
+	JS_FUNC_DECL(traceBegin)
+	JS_FUNC_DECL(traceEnd)
+	JS_FUNC_DECL(traceDump)
+public:
+	void setEnabled(bool enable);
+	// name the calling thread on the timeline
+	void setThreadName(const char* name);
+	void addZone(const char* name, Uint64 start, Uint64 end);
+	// write Chrome trace_event JSON, viewable in chrome://tracing or Perfetto
+	bool dump(const char* path);
+	void setDefaultPath(const std::string& path) { _defaultPath = path; }
+	const std::string& getDefaultPath() const { return _defaultPath; }
+
+	// used by the per-thread buffer holder
+	TraceBuffer* acquireBuffer();
+	void releaseBuffer(TraceBuffer* buffer);
+private:
+	static void flushCallback(Uint64 start, Uint64 end, int numVertices);
+	const char* intern(const char* name);
+
+	std::mutex _mutex;	// guards the buffer list, thread names and interned names, never taken per event
+	std::vector<TraceBuffer*> _buffers;
+	std::map<int, std::string> _threadNames;
+	std::unordered_set<std::string> _names;
+	std::atomic<int> _tidCounter;
+	// open zones of JS, main thread only
+	std::vector<std::pair<const char*, Uint64>> _jsZones;
+	Uint64 _baseTicks;
+	std::string _defaultPath;
+};
+
+class TraceScope {
+public:
+	TraceScope(const char* name) : _name(Tracer::isEnabled() ? name : nullptr), _start(_name ? SDL_GetPerformanceCounter() : 0) {}
+	~TraceScope() { if (_name) Tracer::getInstance()->addZone(_name, _start, SDL_GetPerformanceCounter()); }
+private:
+	const char* _name;
+	Uint64 _start;
+};
+
+#ifdef REKKA_NO_TRACE
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE_CONCAT_(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT_(a, b)
+// records the enclosing scope as a zone, name must outlive the trace (a literal)
+#define TRACE_SCOPE(name) TraceScope TRACE_SCOPE_CONCAT(_traceScope, __LINE__)(name)
+#endif
+
+NS_REK_END
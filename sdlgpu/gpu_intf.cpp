@@ -649,6 +649,30 @@ Image* CopyImage(Image* image)
     return _gpu_current_renderer->CopyImage(image);
 }
 
+bool CopyTargetRect(Target* source, const GPU_Rect* source_rect, Image* image, int dest_x, int dest_y)
+{
+    if(_gpu_current_device == NULL || _gpu_current_device->current_context_target == NULL)
+        return false;
+
+    return _gpu_current_renderer->CopyTargetRect(source, source_rect, image, dest_x, dest_y);
+}
+
+bool SetImageSize(Image* image, Uint16 w, Uint16 h)
+{
+    if(_gpu_current_device == NULL || _gpu_current_device->current_context_target == NULL)
+        return false;
+
+    return _gpu_current_renderer->SetImageSize(image, w, h);
+}
+
+bool IsImageShared(Image* image)
+{
+    if(image == NULL || image->data == NULL)
+        return false;
+
+    return image->refcount > 1 || ((ImageData*)image->data)->refcount > 1;
+}
+
 void UpdateImage(Image* image, const GPU_Rect* image_rect, SDL_Surface* surface, const GPU_Rect* surface_rect)
 {
     if(_gpu_current_device == NULL || _gpu_current_device->current_context_target == NULL)
@@ -947,6 +971,11 @@ void BlitTransformAColor(Image * image, Target * target, float x, float y, Affin
 	_gpu_current_renderer->BlitTransformAColor(image, target, x, y, transform, colors);
 }
 
+void BlitBatchA(Image* image, Target* target, AffineTransform* transform, unsigned int num_sprites, const float* records, unsigned int stride)
+{
+	_gpu_current_renderer->BlitBatchA(image, target, transform, num_sprites, records, stride);
+}
+
 void BlitRect(Image* image, GPU_Rect* src_rect, Target* target, GPU_Rect* dest_rect)
 {
     float w = 0.0f;
@@ -1583,6 +1612,49 @@ void Flip(Target* target)
     _gpu_current_renderer->Flip(target);
 }
 
+bool GetDamageRect(Target* target, GPU_Rect* rect)
+{
+    if(!CHECK_RENDERER || target == NULL || target->context == NULL)
+        return false;
+
+    return _gpu_current_renderer->GetDamageRect(target, rect);
+}
+
+void InvalidateTarget(Target* target)
+{
+    if(!CHECK_RENDERER || target == NULL || target->context == NULL)
+        return;
+
+    _gpu_current_renderer->InvalidateTarget(target);
+}
+
+RenderStats GetRenderStats(void)
+{
+    if(!CHECK_RENDERER)
+    {
+        RenderStats stats;
+        memset(&stats, 0, sizeof(stats));
+        return stats;
+    }
+    return _gpu_current_renderer->GetRenderStats();
+}
+
+void ResetRenderStats(void)
+{
+    if(!CHECK_RENDERER)
+        return;
+
+    _gpu_current_renderer->ResetRenderStats();
+}
+
+void SetFlushCallback(FlushCallback callback)
+{
+    if(!CHECK_RENDERER)
+        return;
+
+    _gpu_current_renderer->SetFlushCallback(callback);
+}
+
 
 // Shader API
 
@@ -77,6 +77,9 @@ typedef struct ContextData
 	unsigned short* index_buffer;  // Indexes into the blit buffer so we can use 4 vertices for every 2 triangles (1 quad)
 	unsigned int index_buffer_num_vertices;
 	unsigned int index_buffer_max_num_vertices;
+
+	GPU_Rect damage_rect;  // Bounding box of everything drawn to the window since the last Flip (in target coords)
+	bool has_damage;
 	    
     unsigned int blit_VBO[2];  // For double-buffering
     unsigned int blit_IBO;
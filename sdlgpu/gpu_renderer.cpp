@@ -40,9 +40,20 @@
 #define __func__ __FUNCTION__
 #endif
 
+// Partial present via EGL_KHR_swap_buffers_with_damage (Android)
+#if defined(XGPU_USE_GLES) && defined(__ANDROID__)
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+	#define XGPU_USE_EGL_SWAP_WITH_DAMAGE
+#endif
+
 
 NS_GPU_BEGIN
 
+// Plain counters, cheap enough to be always on
+static RenderStats _render_stats;
+static FlushCallback _flush_callback = NULL;
+
 // Forces a flush when vertex limit is reached (roughly 1000 sprites)
 #define BLIT_BUFFER_VERTICES_PER_SPRITE 4
 #define BLIT_BUFFER_INIT_MAX_NUM_VERTICES (BLIT_BUFFER_VERTICES_PER_SPRITE*1000)
@@ -304,7 +315,10 @@ void Renderer::init_features()
 void Renderer::extBindFramebuffer(GLuint handle)
 {
     if(_device->enabled_features & FEATURE_RENDER_TARGETS)
+    {
         glBindFramebuffer(GL_FRAMEBUFFER, handle);
+        _render_stats.framebuffer_binds++;
+    }
 }
 
 
@@ -332,6 +346,7 @@ void Renderer::bindTexture(Image* image)
         FlushBlitBuffer();
 
         glBindTexture( GL_TEXTURE_2D, handle );
+        _render_stats.texture_binds++;
         ((ContextData*)_device->current_context_target->context->data)->last_image = image;
     }
 }
@@ -342,6 +357,7 @@ inline void Renderer::flushAndBindTexture(GLuint handle)
     FlushBlitBuffer();
 
     glBindTexture( GL_TEXTURE_2D, handle );
+    _render_stats.texture_binds++;
     ((ContextData*)_device->current_context_target->context->data)->last_image = NULL;
 }
 
@@ -664,6 +680,8 @@ void Renderer::disableTexturing()
 
 static void upload_texture(const void* pixels, GPU_Rect update_rect, Uint32 format, int alignment, int row_length, unsigned int pitch)
 {
+    if(row_length > 0)
+        _render_stats.upload_bytes += (Uint32)update_rect.w * (Uint32)update_rect.h * (pitch / row_length);
     glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
 #if defined(XGPU_USE_OPENGL) || XGPU_GLES_MAJOR_VERSION > 2
 	glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
@@ -700,6 +718,7 @@ static void upload_new_texture(void* pixels, GPU_Rect update_rect, Uint32 format
     
     glTexImage2D(GL_TEXTURE_2D, 0, format, update_rect.w, update_rect.h, 0,
                     format, GL_UNSIGNED_BYTE, pixels);
+    _render_stats.upload_bytes += (Uint32)update_rect.w * (Uint32)update_rect.h * bytes_per_pixel;
                     
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
@@ -2585,6 +2604,68 @@ Image* Renderer::gpu_copy_image_pixels_only(Image* image)
     return result;
 }
 
+bool Renderer::CopyTargetRect(Target* source, const GPU_Rect* source_rect, Image* image, int dest_x, int dest_y)
+{
+	if (source == NULL || source_rect == NULL || image == NULL) {
+		PushErrorCode("CopyTargetRect", ERROR_NULL_ARGUMENT, "source, source_rect or image");
+		return false;
+	}
+	if (source->image == image) {
+		PushErrorCode("CopyTargetRect", ERROR_USER_ERROR, "Source and destination are the same image");
+		return false;
+	}
+	if (_device != source->renderer || _device != image->renderer) {
+		PushErrorCode("CopyTargetRect", ERROR_USER_ERROR, "Mismatched _device");
+		return false;
+	}
+	makeContextCurrent(source);
+	if (_device->current_context_target == NULL) {
+		PushErrorCode("CopyTargetRect", ERROR_USER_ERROR, "NULL context");
+		return false;
+	}
+	// queued draws may write to either side
+	FlushBlitBuffer();
+	if (!bindFramebuffer(source)) {
+		PushErrorCode("CopyTargetRect", ERROR_BACKEND_ERROR, "Failed to bind framebuffer.");
+		return false;
+	}
+	bindTexture(image);
+	// render-to-texture rows are not flipped, so both sides use image coordinates
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, dest_x, dest_y, (GLint)source_rect->x, (GLint)source_rect->y, (GLsizei)source_rect->w, (GLsizei)source_rect->h);
+	return true;
+}
+
+bool Renderer::SetImageSize(Image* image, Uint16 w, Uint16 h)
+{
+	if (image == NULL) {
+		PushErrorCode("SetImageSize", ERROR_NULL_ARGUMENT, "image");
+		return false;
+	}
+	if (w == 0 || h == 0 || w > image->texture_w || h > image->texture_h) {
+		PushErrorCode("SetImageSize", ERROR_USER_ERROR, "Size %dx%d doesn't fit the %dx%d texture", w, h, image->texture_w, image->texture_h);
+		return false;
+	}
+	if (image->using_virtual_resolution) {
+		PushErrorCode("SetImageSize", ERROR_USER_ERROR, "Image uses a virtual resolution");
+		return false;
+	}
+	// queued vertices were computed for the old size
+	flushBlitBufferIfCurrentTexture(image);
+	if (image->target != NULL && isCurrentTarget(image->target))
+		FlushBlitBuffer();
+	image->w = image->base_w = w;
+	image->h = image->base_h = h;
+	Target* target = image->target;
+	if (target != NULL) {
+		target->w = w;
+		target->h = h;
+		target->viewport = MakeRect(0, 0, w, h);
+		target->use_clip_rect = false;
+		target->clip_rect = MakeRect(0, 0, w, h);
+	}
+	return true;
+}
+
 Image* Renderer::CopyImage(Image* image)
 {
     Image* result = NULL;
@@ -3951,6 +4032,167 @@ void Renderer::BlitTransformA(Image* image, GPU_Rect* src_rect, Target* target,
 	cdata->blit_buffer_num_vertices += BLIT_BUFFER_VERTICES_PER_SPRITE;
 }
 
+// Blits many regions of one image in a single call, records are BLIT_BATCH_RECORD_SIZE floats apart by stride:
+// source rect (x, y, w, h), affine (a, b, c, d, tx, ty) applied before transform, alpha
+void Renderer::BlitBatchA(Image* image, Target* target, AffineTransform* transform, unsigned int num_sprites, const float* records, unsigned int stride)
+{
+	Uint32 tex_w, tex_h;
+	float x1, y1, x2, y2;
+	float dx1, dy1, dx2, dy2;
+	float w, h;
+	ContextData* cdata;
+	float* blit_buffer;
+	unsigned short* index_buffer;
+	unsigned short blit_buffer_starting_index;
+	int vert_index;
+	int tex_index;
+	int color_index;
+	float r, g, b, a;
+	float sa, sr, sg, sb;
+	float tex_scale_x, tex_scale_y;
+	unsigned int i;
+
+	if (image == NULL) {
+		PushErrorCode("BlitBatchA", ERROR_NULL_ARGUMENT, "image");
+		return;
+	}
+	if (target == NULL) {
+		PushErrorCode("BlitBatchA", ERROR_NULL_ARGUMENT, "target");
+		return;
+	}
+	if (_device != image->renderer || _device != target->renderer) {
+		PushErrorCode("BlitBatchA", ERROR_USER_ERROR, "Mismatched _device");
+		return;
+	}
+	if (num_sprites == 0)
+		return;
+
+	makeContextCurrent(target);
+	prepareToRenderToTarget(target);
+	prepareToRenderImage(target, image);
+
+	// Bind the texture to which subsequent calls refer
+	bindTexture(image);
+
+	// Bind the FBO
+	if (!bindFramebuffer(target)) {
+		PushErrorCode("BlitBatchA", ERROR_BACKEND_ERROR, "Failed to bind framebuffer.");
+		return;
+	}
+
+	tex_w = image->texture_w;
+	tex_h = image->texture_h;
+	tex_scale_x = 1.0f / tex_w;
+	tex_scale_y = 1.0f / tex_h;
+	if (image->using_virtual_resolution) {
+		// Scale texture coords to fit the original dims
+		tex_scale_x *= image->base_w / (float)image->w;
+		tex_scale_y *= image->base_h / (float)image->h;
+	}
+
+	if (target->use_color)
+	{
+		r = MIX_COLOR_COMPONENT_NORMALIZED_RESULT(target->color.r, image->color.r);
+		g = MIX_COLOR_COMPONENT_NORMALIZED_RESULT(target->color.g, image->color.g);
+		b = MIX_COLOR_COMPONENT_NORMALIZED_RESULT(target->color.b, image->color.b);
+		a = MIX_COLOR_COMPONENT_NORMALIZED_RESULT(target->color.a, image->color.a);
+	}
+	else
+	{
+		r = image->color.r / 255.0f;
+		g = image->color.g / 255.0f;
+		b = image->color.b / 255.0f;
+		a = image->color.a / 255.0f;
+	}
+
+	cdata = (ContextData*)_device->current_context_target->context->data;
+
+	// Make room for the whole batch at once if possible
+	growBlitBuffer(cdata, cdata->blit_buffer_num_vertices + 4 * num_sprites);
+	growIndexBuffer(cdata, cdata->index_buffer_num_vertices + 6 * num_sprites);
+
+	for (i = 0; i < num_sprites; i++, records += stride) {
+		AffineTransform local, full;
+		GPU_Point p1, p2, p3, p4;
+
+		w = records[2];
+		h = records[3];
+		sa = a * records[10];
+		if (w <= 0 || h <= 0 || sa <= 0)
+			continue;
+
+		x1 = records[0] * tex_scale_x;
+		y1 = records[1] * tex_scale_y;
+		x2 = (records[0] + w) * tex_scale_x;
+		y2 = (records[1] + h) * tex_scale_y;
+
+		// Create vertices about the anchor
+		if (image->anchor_fixed) {
+			dx1 = -image->anchor_x;
+			dy1 = -image->anchor_y;
+			dx2 = w - image->anchor_x;
+			dy2 = h - image->anchor_y;
+		}
+		else {
+			dx1 = -w * image->anchor_x;
+			dy1 = -h * image->anchor_y;
+			dx2 = w - w * image->anchor_x;
+			dy2 = h - h * image->anchor_y;
+		}
+
+		// Apply the record's transform, then the target's
+		local = AffineTransformMake(records[4], records[5], records[6], records[7], records[8], records[9]);
+		full = AffineTransformConcat(&local, transform);
+		p1 = PointApplyAffineTransform(dx1, dy1, &full);
+		p2 = PointApplyAffineTransform(dx2, dy2, &full);
+		p3 = PointApplyAffineTransform(dx2, dy1, &full);
+		p4 = PointApplyAffineTransform(dx1, dy2, &full);
+
+		if (cdata->blit_buffer_num_vertices + 4 >= cdata->blit_buffer_max_num_vertices)
+		{
+			if (!growBlitBuffer(cdata, cdata->blit_buffer_num_vertices + 4))
+				FlushBlitBuffer();
+		}
+		if (cdata->index_buffer_num_vertices + 6 >= cdata->index_buffer_max_num_vertices)
+		{
+			if (!growIndexBuffer(cdata, cdata->index_buffer_num_vertices + 6))
+				FlushBlitBuffer();
+		}
+
+		blit_buffer = cdata->blit_buffer;
+		index_buffer = cdata->index_buffer;
+
+		blit_buffer_starting_index = cdata->blit_buffer_num_vertices;
+
+		vert_index = BLIT_BUFFER_VERTEX_OFFSET + cdata->blit_buffer_num_vertices*BLIT_BUFFER_FLOATS_PER_VERTEX;
+		tex_index = BLIT_BUFFER_TEX_COORD_OFFSET + cdata->blit_buffer_num_vertices*BLIT_BUFFER_FLOATS_PER_VERTEX;
+		color_index = BLIT_BUFFER_COLOR_OFFSET + cdata->blit_buffer_num_vertices*BLIT_BUFFER_FLOATS_PER_VERTEX;
+
+#ifdef PREMULTIPLIED_ALPHA
+		sr = r * sa; sg = g * sa; sb = b * sa;
+#else
+		sr = r; sg = g; sb = b;
+#endif
+
+		// 4 Quad vertices
+		SET_TEXTURED_VERTEX_UNINDEXED(p1.x, p1.y, x1, y1, sr, sg, sb, sa);
+		SET_TEXTURED_VERTEX_UNINDEXED(p3.x, p3.y, x2, y1, sr, sg, sb, sa);
+		SET_TEXTURED_VERTEX_UNINDEXED(p2.x, p2.y, x2, y2, sr, sg, sb, sa);
+		SET_TEXTURED_VERTEX_UNINDEXED(p4.x, p4.y, x1, y2, sr, sg, sb, sa);
+
+		// 6 Triangle indices
+		SET_INDEXED_VERTEX(0);
+		SET_INDEXED_VERTEX(1);
+		SET_INDEXED_VERTEX(2);
+
+		SET_INDEXED_VERTEX(0);
+		SET_INDEXED_VERTEX(2);
+		SET_INDEXED_VERTEX(3);
+
+		cdata->blit_buffer_num_vertices += BLIT_BUFFER_VERTICES_PER_SPRITE;
+	}
+}
+
 // AffineTransform is about (0, 0)
 // Colors inputed with clockwise order
 void Renderer::BlitTransformAColor(Image* image, Target* target,
@@ -4157,6 +4399,7 @@ static void upload_attribute_data(ContextData* cdata, int num_vertices)
 
             bytes_used = a->per_vertex_storage_stride_bytes * num_values_used;
             glBufferData(GL_ARRAY_BUFFER, bytes_used, a->next_value, GL_STREAM_DRAW);
+            _render_stats.upload_bytes += bytes_used;
 
             glEnableVertexAttribArray(a->attribute.location);
             glVertexAttribPointer(a->attribute.location, a->attribute.format.num_elems_per_value, a->attribute.format.type, a->attribute.format.normalize, a->per_vertex_storage_stride_bytes, (void*)(intptr_t)a->per_vertex_storage_offset_bytes);
@@ -4206,6 +4449,7 @@ static int get_lowest_attribute_num_values(ContextData* cdata, int cap)
 
 static_inline void submit_buffer_data(int bytes, float* values, int bytes_indices, unsigned short* indices)
 {
+	_render_stats.upload_bytes += bytes + (indices != NULL ? bytes_indices : 0);
 #ifdef XGPU_USE_BUFFER_MAPPING
 	// NOTE: On the Raspberry Pi, you may have to use GL_DYNAMIC_DRAW instead of GL_STREAM_DRAW for buffers to work with glMapBuffer().
 	float* data = (float*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
@@ -4274,6 +4518,10 @@ void Renderer::TriangleBatchX(Image* image, Target* target, unsigned short num_v
         return;
     }
 
+    // Vertex layout is arbitrary here, so damage the whole window
+    if(target->context != NULL)
+        InvalidateTarget(target);
+
     prepareToRenderToTarget(target);
     if(using_texture)
         prepareToRenderImage(target, image);
@@ -4454,6 +4702,8 @@ void Renderer::TriangleBatchX(Image* image, Target* target, unsigned short num_v
 		glDrawArrays(GL_TRIANGLES, 0, num_indices);
 	else
 		glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, (void*)0);
+	_render_stats.draw_calls++;
+	_render_stats.vertices += num_vertices;
 
 	// Disable the vertex arrays again
 	if (use_vertices)
@@ -4689,6 +4939,113 @@ void Renderer::SetWrapMode(Image* image, WrapEnum wrap_mode_x, WrapEnum wrap_mod
 }
 
 
+// Damage tracking for window targets, used by Flip() to present only what changed
+static void addDamage(Target* target, float x1, float y1, float x2, float y2)
+{
+    ContextData* cdata = (ContextData*)target->context->data;
+    GPU_Rect* damage = &cdata->damage_rect;
+
+    if(target->use_camera && (target->camera.x != 0 || target->camera.y != 0 || target->camera.angle != 0 || target->camera.zoom != 1))
+    {
+        x1 = 0; y1 = 0;
+        x2 = target->w; y2 = target->h;
+    }
+    if(target->use_clip_rect)
+    {
+        x1 = SDL_max(x1, target->clip_rect.x);
+        y1 = SDL_max(y1, target->clip_rect.y);
+        x2 = SDL_min(x2, target->clip_rect.x + target->clip_rect.w);
+        y2 = SDL_min(y2, target->clip_rect.y + target->clip_rect.h);
+    }
+    x1 = SDL_max(x1, 0);
+    y1 = SDL_max(y1, 0);
+    x2 = SDL_min(x2, target->w);
+    y2 = SDL_min(y2, target->h);
+    if(x2 <= x1 || y2 <= y1)
+        return;
+
+    if(cdata->has_damage)
+    {
+        x1 = SDL_min(x1, damage->x);
+        y1 = SDL_min(y1, damage->y);
+        x2 = SDL_max(x2, damage->x + damage->w);
+        y2 = SDL_max(y2, damage->y + damage->h);
+    }
+    damage->x = x1;
+    damage->y = y1;
+    damage->w = x2 - x1;
+    damage->h = y2 - y1;
+    cdata->has_damage = true;
+}
+
+static void addBlitBufferDamage(Target* dest, ContextData* cdata)
+{
+    float* vertex = cdata->blit_buffer;
+    float x1 = vertex[0], y1 = vertex[1];
+    float x2 = x1, y2 = y1;
+    int i;
+
+    for(i = 1; i < cdata->blit_buffer_num_vertices; i++)
+    {
+        vertex += BLIT_BUFFER_FLOATS_PER_VERTEX;
+        if(vertex[0] < x1) x1 = vertex[0];
+        else if(vertex[0] > x2) x2 = vertex[0];
+        if(vertex[1] < y1) y1 = vertex[1];
+        else if(vertex[1] > y2) y2 = vertex[1];
+    }
+    // Lines and antialiased edges may touch the pixel next to the bounding box
+    addDamage(dest, x1 - 1, y1 - 1, x2 + 1, y2 + 1);
+}
+
+#ifdef XGPU_USE_EGL_SWAP_WITH_DAMAGE
+static PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC _eglSwapBuffersWithDamage = NULL;
+static bool _egl_has_buffer_age = false;
+static bool _egl_damage_checked = false;
+
+// Presents only the damaged region, returns false if a full swap is required
+static bool swapBuffersWithDamage(Target* target, const GPU_Rect& damage)
+{
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLSurface surface = eglGetCurrentSurface(EGL_DRAW);
+    EGLint age = 0;
+    EGLint rect[4];
+    float sx, sy;
+
+    if(display == EGL_NO_DISPLAY || surface == EGL_NO_SURFACE)
+        return false;
+    if(!_egl_damage_checked)
+    {
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        _egl_damage_checked = true;
+        if(extensions == NULL)
+            return false;
+        if(strstr(extensions, "EGL_KHR_swap_buffers_with_damage") != NULL)
+            _eglSwapBuffersWithDamage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+        else if(strstr(extensions, "EGL_EXT_swap_buffers_with_damage") != NULL)
+            _eglSwapBuffersWithDamage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+        _egl_has_buffer_age = (strstr(extensions, "EGL_EXT_buffer_age") != NULL);
+    }
+    if(_eglSwapBuffersWithDamage == NULL || !_egl_has_buffer_age)
+        return false;
+
+    // Only the previous frame's buffer is identical to what we've been drawing on top of
+    if(!eglQuerySurface(display, surface, EGL_BUFFER_AGE_EXT, &age) || age != 1)
+        return false;
+
+    // Target coords -> drawable pixels, origin at the bottom-left
+    sx = target->viewport.w / target->w;
+    sy = target->viewport.h / target->h;
+    rect[0] = (EGLint)(target->viewport.x + damage.x * sx);
+    rect[2] = (EGLint)(target->viewport.x + (damage.x + damage.w) * sx + 1) - rect[0];
+    rect[3] = (EGLint)(damage.h * sy + 2);
+    rect[1] = (EGLint)(target->context->drawable_h - (target->viewport.y + (damage.y + damage.h) * sy)) - 1;
+    if(rect[1] < 0)
+        rect[1] = 0;
+
+    return _eglSwapBuffersWithDamage(display, surface, rect, 1) == EGL_TRUE;
+}
+#endif
+
 void Renderer::ClearRGBA(Target* target, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
 {
     if(target == NULL)
@@ -4708,6 +5065,9 @@ void Renderer::ClearRGBA(Target* target, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
         glClear(GL_COLOR_BUFFER_BIT);
 
         unsetClipRect(target);
+
+        if(target->context != NULL)
+            addDamage(target, 0, 0, target->w, target->h);
     }
 }
 
@@ -4768,6 +5128,8 @@ static void DoPartialFlush(Target* dest, Context* context, unsigned short num_ve
 	upload_attribute_data(cdata, num_vertices);
 
 	glDrawElements(cdata->last_shape, num_indices, GL_UNSIGNED_SHORT, (void*)0);
+	_render_stats.draw_calls++;
+	_render_stats.vertices += num_vertices;
 
 	// Disable the vertex arrays again
 	if (context->current_shader_block.position_loc >= 0)
@@ -4822,6 +5184,8 @@ static void DoUntexturedFlush(Context* context, unsigned short num_vertices, flo
 	upload_attribute_data(cdata, num_vertices);
 
 	glDrawElements(cdata->last_shape, num_indices, GL_UNSIGNED_SHORT, (void*)0);
+	_render_stats.draw_calls++;
+	_render_stats.vertices += num_vertices;
 
 	// Disable the vertex arrays again
 	if (context->current_shader_block.position_loc >= 0)
@@ -4850,6 +5214,12 @@ void Renderer::FlushBlitBuffer()
 		int num_indices;
 		float* blit_buffer;
 		unsigned short* index_buffer;
+        int total_vertices = cdata->blit_buffer_num_vertices;
+        Uint64 start = _flush_callback != NULL ? SDL_GetPerformanceCounter() : 0;
+
+        if(dest->context != NULL)
+            addBlitBufferDamage(dest, cdata);
+        _render_stats.flushes++;
 
         changeViewport(dest);
         changeCamera(dest);
@@ -4887,23 +5257,75 @@ void Renderer::FlushBlitBuffer()
         cdata->index_buffer_num_vertices = 0;
 
         unsetClipRect(dest);
+
+        if(_flush_callback != NULL)
+            _flush_callback(start, SDL_GetPerformanceCounter(), total_vertices);
     }
 }
 
 void Renderer::Flip(Target* target)
 {
+    Target* context_target;
+    ContextData* cdata;
+
     FlushBlitBuffer();
     makeContextCurrent(target);
 
+    context_target = _device->current_context_target;
+    cdata = (ContextData*)context_target->context->data;
+
 #ifdef SINGLE_BUFFERED
 	glFlush();	
 #endif
-    SDL_GL_SwapWindow(SDL_GetWindowFromID(_device->current_context_target->context->windowID));
+#ifdef XGPU_USE_EGL_SWAP_WITH_DAMAGE
+    if(!cdata->has_damage || !swapBuffersWithDamage(context_target, cdata->damage_rect))
+#endif
+    SDL_GL_SwapWindow(SDL_GetWindowFromID(context_target->context->windowID));
+    cdata->has_damage = false;
 #ifdef XGPU_USE_OPENGL
 	if (vendor_is_Intel) apply_Intel_attrib_workaround = true;
 #endif    
 }
 
+bool Renderer::GetDamageRect(Target* target, GPU_Rect* rect)
+{
+    ContextData* cdata = (ContextData*)target->context->data;
+
+    // Pending vertices haven't been accounted yet
+    if(cdata->blit_buffer_num_vertices > 0)
+        FlushBlitBuffer();
+
+    if(rect != NULL)
+        *rect = cdata->damage_rect;
+    return cdata->has_damage;
+}
+
+RenderStats Renderer::GetRenderStats()
+{
+    return _render_stats;
+}
+
+void Renderer::ResetRenderStats()
+{
+    memset(&_render_stats, 0, sizeof(_render_stats));
+}
+
+void Renderer::SetFlushCallback(FlushCallback callback)
+{
+    _flush_callback = callback;
+}
+
+void Renderer::InvalidateTarget(Target* target)
+{
+    ContextData* cdata = (ContextData*)target->context->data;
+
+    cdata->damage_rect.x = 0;
+    cdata->damage_rect.y = 0;
+    cdata->damage_rect.w = target->w;
+    cdata->damage_rect.h = target->h;
+    cdata->has_damage = true;
+}
+
 
 // Shader API
 
@@ -5299,6 +5721,7 @@ void Renderer::ActivateShaderProgram(Uint32 program_object, ShaderBlock* block)
 
         FlushBlitBuffer();
         glUseProgram(program_object);
+        _render_stats.shader_switches++;
 
 		// Set up our shader attribute and uniform locations
 		if (block == NULL)
@@ -7418,4 +7841,169 @@ void Renderer::ColorLine(Target* target, float x1, float y1, float x2, float y2,
 	SET_UNTEXTURED_VERTEX(x2 - ts, y2 + tc, r, g, b, a);
 }
 
+void Renderer::TrianglesFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, SDL_Color color)
+{
+	if (num_vertices < 3 || num_indices < 3)
+		return;
+	if (num_vertices > BLIT_BUFFER_ABSOLUTE_MAX_VERTICES) {
+		PushErrorCode("TrianglesFilled", ERROR_USER_ERROR, "Too many vertices");
+		return;
+	}
+
+	BEGIN_UNTEXTURED("TrianglesFilled", GL_TRIANGLES, num_vertices, num_indices);
+#ifdef PREMULTIPLIED_ALPHA
+	r *= a; g *= a; b *= a;
+#endif
+	unsigned int i;
+	for (i = 0; i < num_vertices; i++) {
+		SET_UNTEXTURED_VERTEX_UNINDEXED(vertices[i * 2], vertices[i * 2 + 1], r, g, b, a);
+	}
+	for (i = 0; i < num_indices; i++) {
+		SET_INDEXED_VERTEX(indices[i]);
+	}
+	cdata->blit_buffer_num_vertices += num_vertices;
+}
+
+void Renderer::trianglesTextured(const char* function_name, Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices,
+	Image* image, float origin_x, float origin_y, float scale_s, float scale_t)
+{
+	ContextData* cdata;
+	float* blit_buffer;
+	unsigned short* index_buffer;
+	unsigned short blit_buffer_starting_index;
+	int vert_index, tex_index, color_index;
+	unsigned int i;
+	float r, g, b, a;
+
+	if (num_vertices < 3 || num_indices < 3) return;
+	if (num_vertices > BLIT_BUFFER_ABSOLUTE_MAX_VERTICES) {
+		PushErrorCode(function_name, ERROR_USER_ERROR, "Too many vertices");
+		return;
+	}
+	if (image == NULL) {
+		PushErrorCode(function_name, ERROR_NULL_ARGUMENT, "image");
+		return;
+	}
+	if (target == NULL) {
+		PushErrorCode(function_name, ERROR_NULL_ARGUMENT, "target");
+		return;
+	}
+	if (_device != image->renderer || _device != target->renderer) {
+		PushErrorCode(function_name, ERROR_USER_ERROR, "Mismatched _device");
+		return;
+	}
+	makeContextCurrent(target);
+	if (_device->current_context_target == NULL) {
+		PushErrorCode(function_name, ERROR_USER_ERROR, "NULL context");
+		return;
+	}
+	prepareToRenderToTarget(target);
+	prepareToRenderImage(target, image);
+	// Bind the texture to which subsequent calls refer
+	bindTexture(image);
+	// Bind the FBO
+	if (!bindFramebuffer(target)) {
+		PushErrorCode(function_name, ERROR_BACKEND_ERROR, "Failed to bind framebuffer.");
+		return;
+	}
+
+	cdata = (ContextData*)_device->current_context_target->context->data;
+	if (cdata->blit_buffer_num_vertices + num_vertices >= cdata->blit_buffer_max_num_vertices)
+	{
+		if (!growBlitBuffer(cdata, cdata->blit_buffer_num_vertices + num_vertices))
+			FlushBlitBuffer();
+	}
+	if (cdata->index_buffer_num_vertices + num_indices >= cdata->index_buffer_max_num_vertices)
+	{
+		if (!growIndexBuffer(cdata, cdata->index_buffer_num_vertices + num_indices))
+			FlushBlitBuffer();
+	}
+	blit_buffer = cdata->blit_buffer;
+	index_buffer = cdata->index_buffer;
+
+	blit_buffer_starting_index = cdata->blit_buffer_num_vertices;
+
+	vert_index = BLIT_BUFFER_VERTEX_OFFSET + cdata->blit_buffer_num_vertices*BLIT_BUFFER_FLOATS_PER_VERTEX;
+	tex_index = BLIT_BUFFER_TEX_COORD_OFFSET + cdata->blit_buffer_num_vertices*BLIT_BUFFER_FLOATS_PER_VERTEX;
+	color_index = BLIT_BUFFER_COLOR_OFFSET + cdata->blit_buffer_num_vertices*BLIT_BUFFER_FLOATS_PER_VERTEX;
+	if (target->use_color) {
+		r = MIX_COLOR_COMPONENT_NORMALIZED_RESULT(target->color.r, image->color.r);
+		g = MIX_COLOR_COMPONENT_NORMALIZED_RESULT(target->color.g, image->color.g);
+		b = MIX_COLOR_COMPONENT_NORMALIZED_RESULT(target->color.b, image->color.b);
+		a = MIX_COLOR_COMPONENT_NORMALIZED_RESULT(target->color.a, image->color.a);
+	}
+	else {
+		r = image->color.r / 255.0f;
+		g = image->color.g / 255.0f;
+		b = image->color.b / 255.0f;
+		a = image->color.a / 255.0f;
+	}
+#ifdef PREMULTIPLIED_ALPHA
+	r *= a; g *= a; b *= a;
+#endif
+
+	for (i = 0; i < num_vertices; i++) {
+		float x = vertices[i * 2];
+		float y = vertices[i * 2 + 1];
+		SET_TEXTURED_VERTEX_UNINDEXED(x, y, (x - origin_x) * scale_s, (y - origin_y) * scale_t, r, g, b, a);
+	}
+	for (i = 0; i < num_indices; i++) {
+		SET_INDEXED_VERTEX(indices[i]);
+	}
+	cdata->blit_buffer_num_vertices += num_vertices;
+}
+
+void Renderer::TrianglesTextureFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, Image* image, float texture_x, float texture_y)
+{
+	if (image == NULL) {
+		PushErrorCode("TrianglesTextureFilled", ERROR_NULL_ARGUMENT, "image");
+		return;
+	}
+	float tex_w = image->texture_w;
+	float tex_h = image->texture_h;
+	if (image->using_virtual_resolution)
+	{
+		// Scale texture coords to fit the original dims
+		tex_w *= (float)image->w / image->base_w;
+		tex_h *= (float)image->h / image->base_h;
+	}
+	trianglesTextured("TrianglesTextureFilled", target, num_vertices, vertices, num_indices, indices, image, texture_x, texture_y, 1.0f / tex_w, 1.0f / tex_h);
+}
+
+void Renderer::TrianglesTextureFilledNPOT(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, Image* image)
+{
+	if (target == NULL) {
+		PushErrorCode("TrianglesTextureFilledNPOT", ERROR_NULL_ARGUMENT, "target");
+		return;
+	}
+	trianglesTextured("TrianglesTextureFilledNPOT", target, num_vertices, vertices, num_indices, indices, image, 0, 0, 1.0f / target->w, 1.0f / target->h);
+}
+
+void Renderer::TrianglesColorFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, ColorCallback colorfunc, void* userdata)
+{
+	if (num_vertices < 3 || num_indices < 3)
+		return;
+	if (num_vertices > BLIT_BUFFER_ABSOLUTE_MAX_VERTICES) {
+		PushErrorCode("TrianglesColorFilled", ERROR_USER_ERROR, "Too many vertices");
+		return;
+	}
+
+	BEGIN_UNTEXTURED_NOCOLOR("TrianglesColorFilled", GL_TRIANGLES, num_vertices, num_indices);
+
+	float r, g, b, a;
+	GPU_Color color;
+	unsigned int i;
+	for (i = 0; i < num_vertices; i++) {
+		MAKE_VERTICE_COLOR(vertices[i * 2], vertices[i * 2 + 1]);
+#ifdef PREMULTIPLIED_ALPHA
+		r *= a; g *= a; b *= a;
+#endif
+		SET_UNTEXTURED_VERTEX_UNINDEXED(vertices[i * 2], vertices[i * 2 + 1], r, g, b, a);
+	}
+	for (i = 0; i < num_indices; i++) {
+		SET_INDEXED_VERTEX(indices[i]);
+	}
+	cdata->blit_buffer_num_vertices += num_vertices;
+}
+
 NS_GPU_END
\ No newline at end of file
@@ -33,6 +33,8 @@ public:
 	Image* CreateAliasImage(Image* image);	
 	bool SaveImage(Image* image, const char* filename, FileFormatEnum format);	
 	Image* CopyImage(Image* image);	
+	bool CopyTargetRect(Target* source, const GPU_Rect* source_rect, Image* image, int dest_x, int dest_y);
+	bool SetImageSize(Image* image, Uint16 w, Uint16 h);
 	void UpdateImage(Image* image, const GPU_Rect* image_rect, SDL_Surface* surface, const GPU_Rect* surface_rect);	
 	void UpdateImageBytes(Image* image, const GPU_Rect* image_rect, const unsigned char* bytes, int bytes_per_row);		
 	bool ReplaceImage(Image* image, SDL_Surface* surface, const GPU_Rect* surface_rect);	
@@ -60,6 +62,11 @@ public:
 	void ClearRGBA(Target* target, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
 	void FlushBlitBuffer();
 	void Flip(Target* target);
+	bool GetDamageRect(Target* target, GPU_Rect* rect);
+	void InvalidateTarget(Target* target);
+	RenderStats GetRenderStats();
+	void ResetRenderStats();
+	void SetFlushCallback(FlushCallback callback);
 		
 	Uint32 CreateShaderProgram();
 	void FreeShaderProgram(Uint32 program_object);
@@ -122,8 +129,13 @@ public:
 	void TextureLine(Target* target, float x1, float y1, float x2, float y2, Image* image, float texture_x, float texture_y);
 	void TextureLineNPOT(Target* target, float x1, float y1, float x2, float y2, Image* image);
 	void BlitTransformAColor(Image* image, Target* target, float x, float y, AffineTransform* transform, GPU_Color colors[4]);
+	void BlitBatchA(Image* image, Target* target, AffineTransform* transform, unsigned int num_sprites, const float* records, unsigned int stride);
 	void PolygonColorFilled(Target* target, unsigned int num_vertices, float* vertices, ColorCallback colorfunc, void* userdata);
 	void ColorLine(Target* target, float x1, float y1, float x2, float y2, ColorCallback colorfunc, void* userdata);
+	void TrianglesFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, SDL_Color color);
+	void TrianglesTextureFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, Image* image, float texture_x, float texture_y);
+	void TrianglesTextureFilledNPOT(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, Image* image);
+	void TrianglesColorFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, ColorCallback colorfunc, void* userdata);
 
 	bool IsExtensionSupported(const char* extension_str);
 private:
@@ -150,6 +162,8 @@ private:
 	void disableTexturing();
 	void prepareToRenderImage(Target* target, Image* image);
 	void prepareToRenderShapes(unsigned int shape);
+	void trianglesTextured(const char* function_name, Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices,
+		Image* image, float origin_x, float origin_y, float scale_s, float scale_t);
 	GLuint CreateUninitializedTexture();
 	Image* CreateUninitializedImage(Uint16 w, Uint16 h, FormatEnum format);
 
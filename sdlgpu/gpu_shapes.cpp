@@ -187,6 +187,30 @@ void PolygonColorFilled(Target * target, unsigned int num_vertices, float * vert
 	renderer->PolygonColorFilled(target, num_vertices, vertices, colorfunc, userdata);
 }
 
+void TrianglesFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, SDL_Color color)
+{
+	CHECK_RENDERER();
+	renderer->TrianglesFilled(target, num_vertices, vertices, num_indices, indices, color);
+}
+
+void TrianglesTextureFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, Image* image, float texture_x, float texture_y)
+{
+	CHECK_RENDERER();
+	renderer->TrianglesTextureFilled(target, num_vertices, vertices, num_indices, indices, image, texture_x, texture_y);
+}
+
+void TrianglesTextureFilledNPOT(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, Image* image)
+{
+	CHECK_RENDERER();
+	renderer->TrianglesTextureFilledNPOT(target, num_vertices, vertices, num_indices, indices, image);
+}
+
+void TrianglesColorFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, ColorCallback colorfunc, void* userdata)
+{
+	CHECK_RENDERER();
+	renderer->TrianglesColorFilled(target, num_vertices, vertices, num_indices, indices, colorfunc, userdata);
+}
+
 void ColorLine(Target * target, float x1, float y1, float x2, float y2, ColorCallback colorfunc, void* userdata)
 {
 	CHECK_RENDERER();
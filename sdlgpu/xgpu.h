@@ -601,6 +601,17 @@ Image* CreateAliasImage(Image* image);
 /* Copy an image to a new image.  Don't forget to FreeImage() both. */
 Image* CopyImage(Image* image);
 
+/* Copy a rectangle of pixels from a render target into another image at (dest_x, dest_y), with glCopyTexSubImage2D.
+ * No blending, transform or virtual resolution applies.  Returns false if the copy can't be done. */
+bool CopyTargetRect(Target* source, const GPU_Rect* source_rect, Image* image, int dest_x, int dest_y);
+
+/* Change the size of an image within its allocated texture, e.g. to reuse the texture for a smaller image.  The image's target gets the new size, with its viewport reset and clipping off.
+ * The texture is kept as is, so the pixels outside the new size stay in the padding.  Fails for images with a virtual resolution or a size that doesn't fit the texture. */
+bool SetImageSize(Image* image, Uint16 w, Uint16 h);
+
+/* Returns true if the texture of the image is referenced by another image (e.g. from CreateAliasImage()) or the image itself has more than one reference. */
+bool IsImageShared(Image* image);
+
 /* Deletes an image in the proper way for this renderer.  Also deletes the corresponding Target if applicable.  Be careful not to use that target afterward! */
 void FreeImage(Image* image);
 
@@ -785,6 +796,33 @@ void FlushBlitBuffer(void);
 /* Updates the given target's associated window.  For non-context targets (e.g. image targets), this will flush the blit buffer. */
 void Flip(Target* target);
 
+/* Counters of the GL work issued by the renderer. */
+typedef struct RenderStats {
+	Uint32 flushes;             // blit buffer flushes
+	Uint32 draw_calls;
+	Uint32 vertices;
+	Uint32 texture_binds;
+	Uint32 framebuffer_binds;
+	Uint32 shader_switches;
+	Uint32 upload_bytes;        // vertex, index and texture data sent to the GPU
+} RenderStats;
+
+/* Returns the counters accumulated since the last ResetRenderStats(). */
+RenderStats GetRenderStats(void);
+
+void ResetRenderStats(void);
+
+/* Called after every blit buffer flush with the SDL_GetPerformanceCounter() ticks around it, for profiling.  NULL to disable. */
+typedef void (*FlushCallback)(Uint64 start, Uint64 end, int num_vertices);
+void SetFlushCallback(FlushCallback callback);
+
+/* Returns true if anything was rendered to the given window target since its last Flip.
+ * \param rect If not NULL, receives the bounding box of the damaged region in target coordinates. */
+bool GetDamageRect(Target* target, GPU_Rect* rect);
+
+/* Marks the whole window target as damaged, so the next Flip presents it completely. */
+void InvalidateTarget(Target* target);
+
 
 
 /* Renders a colored point.
@@ -1141,6 +1179,12 @@ bool IsExtensionSupported(const char* extension_str);
 void BlitTransformA(Image* image, GPU_Rect* src_rect, Target* target, float x, float y, AffineTransform* transform);
 void BlitTransformAScale(Image* image, GPU_Rect* src_rect, Target* target, float x, float y, AffineTransform* transform, float scale_x, float scale_y);
 
+/* Floats of a BlitBatchA record: source rect x, y, w, h, affine a, b, c, d, tx, ty, alpha */
+#define BLIT_BATCH_RECORD_SIZE 11
+/* Blits num_sprites regions of the image, each record's affine is applied before transform.
+ * \param stride Floats from one record to the next, at least BLIT_BATCH_RECORD_SIZE */
+void BlitBatchA(Image* image, Target* target, AffineTransform* transform, unsigned int num_sprites, const float* records, unsigned int stride);
+
 void PolygonTextureFilled(Target* target, unsigned int num_vertices, float* vertices, Image* image, float texture_x, float texture_y);
 void PolygonTextureFilledNPOT(Target* target, unsigned int num_vertices, float* vertices, Image* image);
 void TextureLine(Target* target, float x1, float y1, float x2, float y2, Image* image, float texture_x, float texture_y);
@@ -1151,6 +1195,15 @@ void BlitTransformAColor(Image* image, Target* target, float x, float y, AffineT
 void PolygonColorFilled(Target* target, unsigned int num_vertices, float* vertices, ColorCallback colorfunc, void* userdata);
 void ColorLine(Target* target, float x1, float y1, float x2, float y2, ColorCallback colorfunc, void* userdata);
 
+/* Renders an indexed triangle list, e.g. a tessellated path.  The triangles go into the blit buffer like other shapes.
+ * \param vertices An array of vertex positions stored as interlaced x and y coords, at most 60000 vertices
+ * \param indices Vertex indices, three per triangle
+ */
+void TrianglesFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, SDL_Color color);
+void TrianglesTextureFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, Image* image, float texture_x, float texture_y);
+void TrianglesTextureFilledNPOT(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, Image* image);
+void TrianglesColorFilled(Target* target, unsigned int num_vertices, const float* vertices, unsigned int num_indices, const unsigned short* indices, ColorCallback colorfunc, void* userdata);
+
 
 NS_GPU_END
 
@@ -32,11 +32,21 @@
 #include FT_STROKER_H
 #include FT_GLYPH_H
 #include FT_TRUETYPE_IDS_H
+#include FT_SIZES_H
 
 #include "SDL.h"
 #include "SDL_endian.h"
 #include "SDL_ttf.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TTF_BLEND_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TTF_BLEND_NEON
+#include <arm_neon.h>
+#endif
+
 /* FIXME: Right now we assume the gray-scale renderer Freetype is using
    supports 256 shades of gray, but we should instead key off of num_grays
    in the result FT_Bitmap after the FT_Render_Glyph() call. */
@@ -50,6 +60,10 @@
 #define CACHED_BITMAP   0x01
 #define CACHED_PIXMAP   0x02
 
+/* Glyph cache defaults, the hash table doubles when it holds more glyphs than buckets */
+#define GLYPH_CACHE_BUDGET          (2 * 1024 * 1024)
+#define GLYPH_CACHE_MIN_BUCKETS     64
+
 /* Cached glyph information */
 typedef struct cached_glyph {
     int stored;
@@ -62,14 +76,35 @@ typedef struct cached_glyph {
     int maxy;
     int yoffset;
     int advance;
-    Uint16 cached;
+    Uint32 cached;  /* the code point, once loaded */
+    size_t size;    /* bytes held for the glyph */
+    struct cached_glyph *hash_next;
+    struct cached_glyph *lru_prev;  /* more recently used */
+    struct cached_glyph *lru_next;
 } c_glyph;
 
 /* The structure used to hold internal font information */
+/* A face loaded from memory, shared by fonts of different sizes */
+struct _TTF_FontFace {
+    FT_Face face;
+    FT_Library library;
+    int ownlibrary;
+    void *data;
+    int freedata;
+    int refcount;
+};
+
 struct _TTF_Font {
     /* Freetype2 maintains all sorts of useful info itself */
     FT_Face face;
 
+    /* Fonts opened from a shared face have their own size of it */
+    TTF_FontFace *shared;
+    FT_Size size;
+
+    /* The FreeType instance the face was opened with */
+    FT_Library library;
+
     /* We'll cache these ourselves */
     int height;
     int ascent;
@@ -96,9 +131,18 @@ struct _TTF_Font {
     int underline_offset;
     int underline_height;
 
-    /* Cache for style-transformed glyphs */
+    /* Cache for style-transformed glyphs, hashed by code point, the least
+       recently used glyphs are freed when it grows over the budget */
     c_glyph *current;
-    c_glyph cache[257]; /* 257 is a prime */
+    c_glyph **cache;
+    int cache_buckets;
+    int cache_count;
+    c_glyph *lru_first;
+    c_glyph *lru_last;
+    size_t cache_bytes;
+    size_t cache_budget;
+    Uint32 cache_hits;
+    Uint32 cache_misses;
 
     /* We are responsible for closing the font stream */
     SDL_RWops *src;
@@ -112,6 +156,9 @@ struct _TTF_Font {
     int hinting;
 };
 
+/* The size of a shared face is made current before it loads glyphs or kerning */
+#define TTF_ACTIVATE_SIZE(font) if ((font)->size) FT_Activate_Size((font)->size)
+
 /* Handle a style only if the font does not already handle it */
 #define TTF_HANDLE_STYLE_BOLD(font) (((font)->style & TTF_STYLE_BOLD) && \
                                     !((font)->face_style & TTF_STYLE_BOLD))
@@ -248,6 +295,114 @@ static void TTF_drawLine_Blended(const TTF_Font *font, const SDL_Surface *textbu
     }
 }
 
+/* Blend a span of glyph coverage into premultiplied white ARGB pixels.
+   Pixels are kept with all four channels equal to the alpha, so the max of
+   the coverage and the pixel alpha can be taken per byte, which lets
+   overlapping glyphs (or the outline and fill of a glyph) merge in place.
+*/
+typedef void (*Blend_Span_Func)(Uint32 *dst, const Uint8 *src, int n);
+
+static void Blend_Span_Scalar(Uint32 *dst, const Uint8 *src, int n)
+{
+	Uint32 alpha;
+	while (n-- > 0) {
+		alpha = std::max<Uint32>(*src++, *dst & 0xFF);
+		*dst++ = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+	}
+}
+
+#ifdef TTF_BLEND_SSE2
+static void Blend_Span_SSE2(Uint32 *dst, const Uint8 *src, int n)
+{
+	while (n >= 16) {
+		__m128i s = _mm_loadu_si128((const __m128i*)src);
+		__m128i lo = _mm_unpacklo_epi8(s, s);
+		__m128i hi = _mm_unpackhi_epi8(s, s);
+		__m128i *d = (__m128i*)dst;
+		_mm_storeu_si128(d, _mm_max_epu8(_mm_unpacklo_epi16(lo, lo), _mm_loadu_si128(d)));
+		_mm_storeu_si128(d + 1, _mm_max_epu8(_mm_unpackhi_epi16(lo, lo), _mm_loadu_si128(d + 1)));
+		_mm_storeu_si128(d + 2, _mm_max_epu8(_mm_unpacklo_epi16(hi, hi), _mm_loadu_si128(d + 2)));
+		_mm_storeu_si128(d + 3, _mm_max_epu8(_mm_unpackhi_epi16(hi, hi), _mm_loadu_si128(d + 3)));
+		src += 16;
+		dst += 16;
+		n -= 16;
+	}
+	Blend_Span_Scalar(dst, src, n);
+}
+#endif
+
+#ifdef TTF_BLEND_NEON
+static void Blend_Span_NEON(Uint32 *dst, const Uint8 *src, int n)
+{
+	while (n >= 16) {
+		uint8x16_t s = vld1q_u8(src);
+		uint8x16x2_t s2 = vzipq_u8(s, s);
+		uint16x8x2_t lo = vzipq_u16(vreinterpretq_u16_u8(s2.val[0]), vreinterpretq_u16_u8(s2.val[0]));
+		uint16x8x2_t hi = vzipq_u16(vreinterpretq_u16_u8(s2.val[1]), vreinterpretq_u16_u8(s2.val[1]));
+		Uint8 *d = (Uint8*)dst;
+		vst1q_u8(d, vmaxq_u8(vreinterpretq_u8_u16(lo.val[0]), vld1q_u8(d)));
+		vst1q_u8(d + 16, vmaxq_u8(vreinterpretq_u8_u16(lo.val[1]), vld1q_u8(d + 16)));
+		vst1q_u8(d + 32, vmaxq_u8(vreinterpretq_u8_u16(hi.val[0]), vld1q_u8(d + 32)));
+		vst1q_u8(d + 48, vmaxq_u8(vreinterpretq_u8_u16(hi.val[1]), vld1q_u8(d + 48)));
+		src += 16;
+		dst += 16;
+		n -= 16;
+	}
+	Blend_Span_Scalar(dst, src, n);
+}
+#endif
+
+/* selected in TTF_Init */
+static Blend_Span_Func Blend_Span = Blend_Span_Scalar;
+
+#ifdef _DEBUG
+/* Runs the kernel against the scalar one on random spans of every length up to
+   40, so the vector body, the tail and a mix of both are covered, at unaligned
+   offsets. The pixels past the span must be left alone.
+*/
+static SDL_bool Check_Blend_Span(Blend_Span_Func func)
+{
+	Uint8 src[48];
+	Uint32 expected[48], actual[48];
+	int n, i, offset;
+	for (n = 0; n <= 40; ++n) {
+		for (offset = 0; offset < 4; ++offset) {
+			for (i = 0; i < 48; ++i) {
+				Uint32 alpha = rand() & 0xFF;
+				src[i] = rand() & 0xFF;
+				expected[i] = actual[i] = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+			}
+			Blend_Span_Scalar(expected + offset, src + offset, n);
+			func(actual + offset, src + offset, n);
+			if (memcmp(expected, actual, sizeof(expected)) != 0) {
+				SDL_LogError(0, "Blend_Span kernel differs from the scalar one at length %d, offset %d", n, offset);
+				return SDL_FALSE;
+			}
+		}
+	}
+	return SDL_TRUE;
+}
+#endif
+
+static void Select_Blend_Span(void)
+{
+	Blend_Span = Blend_Span_Scalar;
+#ifdef TTF_BLEND_SSE2
+	if (SDL_HasSSE2()) {
+		Blend_Span = Blend_Span_SSE2;
+	}
+#endif
+#ifdef TTF_BLEND_NEON
+	/* SDL 2.0.5 has no NEON query, NEON is assumed when the compiler targets it */
+	Blend_Span = Blend_Span_NEON;
+#endif
+#ifdef _DEBUG
+	if (Blend_Span != Blend_Span_Scalar && !Check_Blend_Span(Blend_Span)) {
+		Blend_Span = Blend_Span_Scalar;
+	}
+#endif
+}
+
 /* rcg06192001 get linked library's version. */
 const SDL_version *TTF_Linked_Version(void)
 {
@@ -307,6 +462,7 @@ int TTF_Init( void )
             TTF_SetFTError("Couldn't init FreeType engine", error);
             status = -1;
         }
+        Select_Blend_Span();
     }
     if ( status == 0 ) {
         ++TTF_initialized;
@@ -331,16 +487,81 @@ static unsigned long RWread(
     return (unsigned long)SDL_RWread( src, buffer, 1, (int)count );
 }
 
+static void Set_Unicode_Charmap( FT_Face face )
+{
+    FT_CharMap found;
+    int i;
+
+    /* Set charmap for loaded font */
+    found = 0;
+    for (i = 0; i < face->num_charmaps; i++) {
+        FT_CharMap charmap = face->charmaps[i];
+        if ((charmap->platform_id == 3 && charmap->encoding_id == 1) /* Windows Unicode */
+         || (charmap->platform_id == 3 && charmap->encoding_id == 0) /* Windows Symbol */
+         || (charmap->platform_id == 2 && charmap->encoding_id == 1) /* ISO Unicode */
+         || (charmap->platform_id == 0)) { /* Apple Unicode */
+            found = charmap;
+            break;
+        }
+    }
+    if ( found ) {
+        /* If this fails, continue using the default charmap */
+        FT_Set_Charmap(face, found);
+    }
+}
+
+/* Set the size of the font's face and the metrics and style defaults of the size */
+static void Init_Font_Size( TTF_Font *font, int ptsize )
+{
+    FT_Face face = font->face;
+    FT_Fixed scale;
+
+	auto pixelsize = ptsize;
+	font->font_size_family = pixelsize;
+	FT_Set_Pixel_Sizes(face, 0, pixelsize);	
+
+	scale = face->size->metrics.y_scale;
+	font->ascent = FT_CEIL(FT_MulFix(face->ascender, scale));
+	font->descent = FT_CEIL(FT_MulFix(face->descender, scale));
+	font->height = font->ascent - font->descent + /* baseline */ 1;
+	font->lineskip = FT_CEIL(FT_MulFix(face->height, scale));
+	font->underline_offset = FT_FLOOR(FT_MulFix(face->underline_position, scale));
+	font->underline_height = FT_FLOOR(FT_MulFix(face->underline_thickness, scale));
+
+    if ( font->underline_height < 1 ) {
+        font->underline_height = 1;
+    }
+
+    /* Initialize the font face style */
+    font->face_style = TTF_STYLE_NORMAL;
+    if ( font->face->style_flags & FT_STYLE_FLAG_BOLD ) {
+        font->face_style |= TTF_STYLE_BOLD;
+    }
+    if ( font->face->style_flags & FT_STYLE_FLAG_ITALIC ) {
+        font->face_style |= TTF_STYLE_ITALIC;
+    }
+
+    /* Set the default font style */
+    font->style = font->face_style;
+    font->outline = 0;
+	font->line_cap = FT_STROKER_LINECAP_BUTT;
+	font->line_join = FT_STROKER_LINEJOIN_MITER;
+	font->miter_limit = 10;
+
+    font->kerning = 1;
+    font->glyph_overhang = face->size->metrics.y_ppem / 10;
+    /* x offset = cos(((90.0-12)/360)*2*M_PI), or 12 degree angle */
+    font->glyph_italics = 0.207f;
+    font->glyph_italics *= font->height;
+}
+
 TTF_Font* TTF_OpenFontIndexRW( SDL_RWops *src, int freesrc, int ptsize, long index )
 {
     TTF_Font* font;
     FT_Error error;
     FT_Face face;
-    FT_Fixed scale;
     FT_Stream stream;
-    FT_CharMap found;
     Sint64 position;
-    int i;
 
     if ( ! TTF_initialized ) {
         TTF_SetError( "Library not initialized" );
@@ -374,6 +595,7 @@ TTF_Font* TTF_OpenFontIndexRW( SDL_RWops *src, int freesrc, int ptsize, long ind
         return NULL;
     }
     SDL_memset(font, 0, sizeof(*font));
+    font->cache_budget = GLYPH_CACHE_BUDGET;
 
     font->src = src;
     font->freesrc = freesrc;
@@ -393,6 +615,7 @@ TTF_Font* TTF_OpenFontIndexRW( SDL_RWops *src, int freesrc, int ptsize, long ind
 
     font->args.flags = FT_OPEN_STREAM;
     font->args.stream = stream;
+    font->library = library;
 
     error = FT_Open_Face( library, &font->args, index, &font->face );
     if ( error ) {
@@ -401,23 +624,7 @@ TTF_Font* TTF_OpenFontIndexRW( SDL_RWops *src, int freesrc, int ptsize, long ind
         return NULL;
     }
     face = font->face;
-
-    /* Set charmap for loaded font */
-    found = 0;
-    for (i = 0; i < face->num_charmaps; i++) {
-        FT_CharMap charmap = face->charmaps[i];
-        if ((charmap->platform_id == 3 && charmap->encoding_id == 1) /* Windows Unicode */
-         || (charmap->platform_id == 3 && charmap->encoding_id == 0) /* Windows Symbol */
-         || (charmap->platform_id == 2 && charmap->encoding_id == 1) /* ISO Unicode */
-         || (charmap->platform_id == 0)) { /* Apple Unicode */
-            found = charmap;
-            break;
-        }
-    }
-    if ( found ) {
-        /* If this fails, continue using the default charmap */
-        FT_Set_Charmap(face, found);
-    }
+    Set_Unicode_Charmap( face );
 #if 0
     /* Make sure that our font face is scalable (global metrics) */
     if ( FT_IS_SCALABLE(face) ) {	
@@ -464,47 +671,110 @@ TTF_Font* TTF_OpenFontIndexRW( SDL_RWops *src, int freesrc, int ptsize, long ind
     }
 #endif
 
-	auto pixelsize = ptsize;
-	font->font_size_family = pixelsize;
-	error = FT_Set_Pixel_Sizes(face, 0, pixelsize);	
+    Init_Font_Size( font, ptsize );
+    return font;
+}
 
-	scale = face->size->metrics.y_scale;
-	font->ascent = FT_CEIL(FT_MulFix(face->ascender, scale));
-	font->descent = FT_CEIL(FT_MulFix(face->descender, scale));
-	font->height = font->ascent - font->descent + /* baseline */ 1;
-	font->lineskip = FT_CEIL(FT_MulFix(face->height, scale));
-	font->underline_offset = FT_FLOOR(FT_MulFix(face->underline_position, scale));
-	font->underline_height = FT_FLOOR(FT_MulFix(face->underline_thickness, scale));
+TTF_FontFace* TTF_OpenFontFaceMem( void *data, size_t size, int freedata )
+{
+    return TTF_OpenFontFaceMemEx(data, size, freedata, 0);
+}
 
-    if ( font->underline_height < 1 ) {
-        font->underline_height = 1;
-    }
+TTF_FontFace* TTF_OpenFontFaceMemEx( void *data, size_t size, int freedata, int ownlibrary )
+{
+    TTF_FontFace* shared;
+    FT_Error error;
 
-    /* Initialize the font face style */
-    font->face_style = TTF_STYLE_NORMAL;
-    if ( font->face->style_flags & FT_STYLE_FLAG_BOLD ) {
-        font->face_style |= TTF_STYLE_BOLD;
+    if ( ! TTF_initialized ) {
+        TTF_SetError( "Library not initialized" );
+        if ( freedata ) {
+            SDL_free( data );
+        }
+        return NULL;
     }
-    if ( font->face->style_flags & FT_STYLE_FLAG_ITALIC ) {
-        font->face_style |= TTF_STYLE_ITALIC;
+    shared = (TTF_FontFace*)SDL_malloc(sizeof *shared);
+    if ( shared == NULL ) {
+        TTF_SetError( "Out of memory" );
+        if ( freedata ) {
+            SDL_free( data );
+        }
+        return NULL;
+    }
+    SDL_memset(shared, 0, sizeof(*shared));
+    shared->data = data;
+    shared->freedata = freedata;
+    shared->refcount = 1;
+    shared->library = library;
+    if ( ownlibrary ) {
+        error = FT_Init_FreeType( &shared->library );
+        if ( error ) {
+            TTF_SetFTError( "Couldn't init FreeType engine", error );
+            shared->library = NULL;
+            TTF_CloseFontFace( shared );
+            return NULL;
+        }
+        shared->ownlibrary = 1;
     }
 
-    /* Set the default font style */
-    font->style = font->face_style;
-    font->outline = 0;
-	font->line_cap = FT_STROKER_LINECAP_BUTT;
-	font->line_join = FT_STROKER_LINEJOIN_MITER;
-	font->miter_limit = 10;
+    /* FreeType reads the tables in place, data must outlive the face */
+    error = FT_New_Memory_Face( shared->library, (const FT_Byte*)data, (FT_Long)size, 0, &shared->face );
+    if ( error ) {
+        TTF_SetFTError( "Couldn't load font data", error );
+        shared->face = NULL;
+        TTF_CloseFontFace( shared );
+        return NULL;
+    }
+    Set_Unicode_Charmap( shared->face );
+    return shared;
+}
 
-    font->kerning = 1;
-    font->glyph_overhang = face->size->metrics.y_ppem / 10;
-    /* x offset = cos(((90.0-12)/360)*2*M_PI), or 12 degree angle */
-    font->glyph_italics = 0.207f;
-    font->glyph_italics *= font->height;
+TTF_Font* TTF_OpenFontFromFace( TTF_FontFace *shared, int ptsize )
+{
+    TTF_Font* font;
+    FT_Error error;
+
+    TTF_CHECKPOINTER(shared, NULL);
+
+    font = (TTF_Font*)SDL_malloc(sizeof *font);
+    if ( font == NULL ) {
+        TTF_SetError( "Out of memory" );
+        return NULL;
+    }
+    SDL_memset(font, 0, sizeof(*font));
+    font->cache_budget = GLYPH_CACHE_BUDGET;
 
+    error = FT_New_Size( shared->face, &font->size );
+    if ( error ) {
+        TTF_SetFTError( "Couldn't create font size", error );
+        SDL_free( font );
+        return NULL;
+    }
+    font->face = shared->face;
+    font->library = shared->library;
+    font->shared = shared;
+    ++shared->refcount;
+    TTF_ACTIVATE_SIZE(font);
+    Init_Font_Size( font, ptsize );
     return font;
 }
 
+void TTF_CloseFontFace( TTF_FontFace *shared )
+{
+    if ( shared && --shared->refcount == 0 ) {
+        if ( shared->face ) {
+            FT_Done_Face( shared->face );
+        }
+        if ( shared->ownlibrary && shared->library ) {
+            FT_Done_FreeType( shared->library );
+        }
+        if ( shared->freedata ) {
+            SDL_free( shared->data );
+        }
+        SDL_free( shared );
+    }
+}
+
+
 TTF_Font* TTF_OpenFontRW( SDL_RWops *src, int freesrc, int ptsize )
 {
     return TTF_OpenFontIndexRW(src, freesrc, ptsize, 0);
@@ -542,14 +812,104 @@ static void Flush_Glyph( c_glyph* glyph )
 
 static void Flush_Cache( TTF_Font* font )
 {
-    int i;
-    int size = sizeof( font->cache ) / sizeof( font->cache[0] );
+    c_glyph *glyph = font->lru_first;
 
-    for ( i = 0; i < size; ++i ) {
-        if ( font->cache[i].cached ) {
-            Flush_Glyph( &font->cache[i] );
-        }
+    while ( glyph ) {
+        c_glyph *next = glyph->lru_next;
+        Flush_Glyph( glyph );
+        SDL_free( glyph );
+        glyph = next;
+    }
+    if ( font->cache ) {
+        SDL_free( font->cache );
+        font->cache = NULL;
+    }
+    font->cache_buckets = 0;
+    font->cache_count = 0;
+    font->lru_first = font->lru_last = NULL;
+    font->cache_bytes = 0;
+    font->current = NULL;
+}
+
+/* Code points are mostly consecutive runs, their low bits spread them evenly */
+#define GLYPH_BUCKET(font, ch) ((ch) & ((font)->cache_buckets - 1))
+
+static void Unlink_LRU( TTF_Font* font, c_glyph* glyph )
+{
+    if ( glyph->lru_prev ) {
+        glyph->lru_prev->lru_next = glyph->lru_next;
+    } else {
+        font->lru_first = glyph->lru_next;
+    }
+    if ( glyph->lru_next ) {
+        glyph->lru_next->lru_prev = glyph->lru_prev;
+    } else {
+        font->lru_last = glyph->lru_prev;
+    }
+    glyph->lru_prev = glyph->lru_next = NULL;
+}
+
+static void Push_LRU( TTF_Font* font, c_glyph* glyph )
+{
+    glyph->lru_prev = NULL;
+    glyph->lru_next = font->lru_first;
+    if ( font->lru_first ) {
+        font->lru_first->lru_prev = glyph;
+    } else {
+        font->lru_last = glyph;
+    }
+    font->lru_first = glyph;
+}
+
+static int Grow_Cache( TTF_Font* font )
+{
+    int buckets = font->cache_buckets ? font->cache_buckets * 2 : GLYPH_CACHE_MIN_BUCKETS;
+    c_glyph **cache = (c_glyph **)SDL_malloc( buckets * sizeof(c_glyph *) );
+    c_glyph *glyph;
+
+    if ( !cache ) {
+        return -1;
+    }
+    SDL_memset( cache, 0, buckets * sizeof(c_glyph *) );
+    if ( font->cache ) {
+        SDL_free( font->cache );
+    }
+    font->cache = cache;
+    font->cache_buckets = buckets;
+    for ( glyph = font->lru_first; glyph; glyph = glyph->lru_next ) {
+        int h = GLYPH_BUCKET(font, glyph->cached);
+        glyph->hash_next = cache[h];
+        cache[h] = glyph;
+    }
+    return 0;
+}
+
+static void Remove_Glyph( TTF_Font* font, c_glyph* glyph )
+{
+    c_glyph **link = &font->cache[GLYPH_BUCKET(font, glyph->cached)];
+
+    while ( *link != glyph ) {
+        link = &(*link)->hash_next;
     }
+    *link = glyph->hash_next;
+    Unlink_LRU( font, glyph );
+    font->cache_bytes -= glyph->size;
+    --font->cache_count;
+    Flush_Glyph( glyph );
+    SDL_free( glyph );
+}
+
+static size_t Glyph_Size( const c_glyph* glyph )
+{
+    size_t size = sizeof( *glyph );
+
+    if ( glyph->bitmap.buffer ) {
+        size += glyph->bitmap.pitch * glyph->bitmap.rows;
+    }
+    if ( glyph->pixmap.buffer ) {
+        size += glyph->pixmap.pitch * glyph->pixmap.rows;
+    }
+    return size;
 }
 
 struct Span_ {		
@@ -572,7 +932,7 @@ struct Rect_ {
 	float width() const { return xmax - xmin + 1; }
 	float height() const { return ymax - ymin + 1; }	
 };
-static FT_Error Load_Glyph( TTF_Font* font, Uint16 ch, c_glyph* cached, int want )
+static FT_Error Load_Glyph( TTF_Font* font, Uint32 ch, c_glyph* cached, int want )
 {
     FT_Face face;
     FT_Error error;
@@ -658,7 +1018,7 @@ static FT_Error Load_Glyph( TTF_Font* font, Uint16 ch, c_glyph* cached, int want
         if ( (font->outline > 0) && glyph->format != FT_GLYPH_FORMAT_BITMAP ) {
             FT_Stroker stroker;
             FT_Get_Glyph( glyph, &bitmap_glyph );
-            error = FT_Stroker_New( library, &stroker );
+            error = FT_Stroker_New( font->library, &stroker );
             if ( error ) {
                 return error;
             }
@@ -681,7 +1041,7 @@ static FT_Error Load_Glyph( TTF_Font* font, Uint16 ch, c_glyph* cached, int want
 			params.flags = FT_RASTER_FLAG_AA | FT_RASTER_FLAG_DIRECT;
 			params.gray_spans = _RasterCallback;
 			params.user = &spans;
-			FT_Outline_Render(library, outline, &params);
+			FT_Outline_Render(font->library, outline, &params);
 			
 			long width, rows;
 			bitmap = (FT_Bitmap*)malloc(sizeof(FT_Bitmap));
@@ -925,19 +1285,52 @@ static FT_Error Load_Glyph( TTF_Font* font, Uint16 ch, c_glyph* cached, int want
     return 0;
 }
 
-static FT_Error Find_Glyph( TTF_Font* font, Uint16 ch, int want )
+static FT_Error Find_Glyph( TTF_Font* font, Uint32 ch, int want )
 {
     int retval = 0;
-    int hsize = sizeof( font->cache ) / sizeof( font->cache[0] );
-
-    int h = ch % hsize;
-    font->current = &font->cache[h];
+    c_glyph *glyph = NULL;
 
-    if (font->current->cached != ch)
-        Flush_Glyph( font->current );
-
-    if ( (font->current->stored & want) != want ) {
-        retval = Load_Glyph( font, ch, font->current, want );
+    TTF_ACTIVATE_SIZE(font);
+    if ( font->cache ) {
+        for ( glyph = font->cache[GLYPH_BUCKET(font, ch)]; glyph; glyph = glyph->hash_next ) {
+            if ( glyph->cached == ch ) {
+                break;
+            }
+        }
+    }
+    if ( !glyph ) {
+        if ( font->cache_count >= font->cache_buckets && Grow_Cache( font ) < 0 ) {
+            return FT_Err_Out_Of_Memory;
+        }
+        glyph = (c_glyph *)SDL_malloc( sizeof(*glyph) );
+        if ( !glyph ) {
+            return FT_Err_Out_Of_Memory;
+        }
+        SDL_memset( glyph, 0, sizeof(*glyph) );
+        glyph->cached = ch;
+        glyph->size = sizeof(*glyph);
+        glyph->hash_next = font->cache[GLYPH_BUCKET(font, ch)];
+        font->cache[GLYPH_BUCKET(font, ch)] = glyph;
+        font->cache_bytes += glyph->size;
+        ++font->cache_count;
+    } else {
+        Unlink_LRU( font, glyph );
+    }
+    Push_LRU( font, glyph );
+    font->current = glyph;
+
+    if ( (glyph->stored & want) != want ) {
+        ++font->cache_misses;
+        retval = Load_Glyph( font, ch, glyph, want );
+        font->cache_bytes -= glyph->size;
+        glyph->size = Glyph_Size( glyph );
+        font->cache_bytes += glyph->size;
+        /* the glyph just found stays, it is used right after */
+        while ( font->cache_bytes > font->cache_budget && font->lru_last != glyph ) {
+            Remove_Glyph( font, font->lru_last );
+        }
+    } else {
+        ++font->cache_hits;
     }
     return retval;
 }
@@ -946,7 +1339,10 @@ void TTF_CloseFont( TTF_Font* font )
 {
     if ( font ) {
         Flush_Cache( font );
-        if ( font->face ) {
+        if ( font->shared ) {
+            FT_Done_Size( font->size );
+            TTF_CloseFontFace( font->shared );
+        } else if ( font->face ) {
             FT_Done_Face( font->face );
         }
         if ( font->args.stream ) {
@@ -1228,7 +1624,7 @@ int TTF_SizeUTF8(TTF_Font *font, const char *text, int *w, int *h)
     textlen = SDL_strlen(text);
     x= 0;
     while ( textlen > 0 ) {
-        Uint16 c = UTF8_getch(&text, &textlen);
+        Uint32 c = UTF8_getch(&text, &textlen);
         if ( c == UNICODE_BOM_NATIVE || c == UNICODE_BOM_SWAPPED ) {
             continue;
         }
@@ -1322,11 +1718,10 @@ SDL_Surface *TTF_RenderUTF8_Blended_PremultipliedAlpha(TTF_Font *font, const cha
 	int xstart;
 	int width, height;
 	SDL_Surface *textbuf;
-	Uint8 alpha;
 	Uint8 *src;
 	Uint32 *dst;
 	Uint32 *dst_check;
-	int row, col;
+	int row, n;
 	c_glyph *glyph;
 	FT_Error error;
 	FT_Long use_kerning;
@@ -1361,7 +1756,7 @@ SDL_Surface *TTF_RenderUTF8_Blended_PremultipliedAlpha(TTF_Font *font, const cha
 	xstart = 0;
 	SDL_FillRect(textbuf, NULL, 0); /* Initialize with fg and 0 alpha */
 	while (textlen > 0) {
-		Uint16 c = UTF8_getch(&text, &textlen);
+		Uint32 c = UTF8_getch(&text, &textlen);
 		if (c == UNICODE_BOM_NATIVE || c == UNICODE_BOM_SWAPPED) {
 			continue;
 		}
@@ -1409,10 +1804,9 @@ SDL_Surface *TTF_RenderUTF8_Blended_PremultipliedAlpha(TTF_Font *font, const cha
 			* account for pitch.
 			* */
 			src = (Uint8*)(glyph->pixmap.buffer + glyph->pixmap.pitch * row);
-			for (col = width; col>0 && dst < dst_check; --col) {
-				alpha = *src++;
-				alpha = std::max<int>(alpha, *dst & 0xFF);
-				*dst++ = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+			n = std::min<ptrdiff_t>(width, dst_check - dst);
+			if (n > 0) {
+				Blend_Span(dst, src, n);
 			}
 		}
 		xstart += glyph->advance;
@@ -1524,6 +1918,7 @@ int TTF_WasInit( void )
 int TTF_GetFontKerningSize(TTF_Font* font, int prev_index, int index)
 {
     FT_Vector delta;
+    TTF_ACTIVATE_SIZE(font);
     FT_Get_Kerning( font->face, prev_index, index, ft_kerning_default, &delta );
     return (delta.x >> 6);
 }
@@ -1564,3 +1959,99 @@ int TTF_GetFontKerningSizeGlyphs(TTF_Font *font, Uint16 previous_ch, Uint16 ch)
     return (delta.x >> 6);
 }
 
+Uint32 TTF_UTF8NextChar(const char **text, size_t *textlen)
+{
+	return UTF8_getch(text, textlen);
+}
+
+static void Glyph_Pixmap_Metrics(TTF_Font *font, c_glyph *cached, TTF_GlyphPixmap *glyph)
+{
+	int overhang = TTF_HANDLE_STYLE_BOLD(font) ? font->glyph_overhang : 0;
+	glyph->index = cached->index;
+	glyph->minx = cached->minx;
+	glyph->miny = cached->miny;
+	/* as TTF_SizeUTF8() bounds the text */
+	glyph->extent = std::max<int>(cached->advance, cached->maxx) + overhang;
+	glyph->yoffset = cached->yoffset;
+	glyph->advance = cached->advance + overhang;
+}
+
+int TTF_GetGlyphPixmapMetrics(TTF_Font *font, Uint32 ch, TTF_GlyphPixmap *glyph)
+{
+	FT_Error error;
+
+	TTF_CHECKPOINTER(font, -1);
+	TTF_CHECKPOINTER(glyph, -1);
+
+	error = Find_Glyph(font, ch, CACHED_METRICS);
+	if (error) {
+		TTF_SetFTError("Couldn't find glyph", error);
+		return -1;
+	}
+	Glyph_Pixmap_Metrics(font, font->current, glyph);
+	glyph->width = glyph->rows = glyph->pitch = 0;
+	glyph->pixels = NULL;
+	return 0;
+}
+
+int TTF_RenderGlyphPixmap(TTF_Font *font, Uint32 ch, TTF_GlyphPixmap *glyph)
+{
+	FT_Error error;
+	c_glyph *cached;
+
+	TTF_CHECKPOINTER(font, -1);
+	TTF_CHECKPOINTER(glyph, -1);
+
+	error = Find_Glyph(font, ch, CACHED_METRICS | CACHED_PIXMAP);
+	if (error) {
+		TTF_SetFTError("Couldn't find glyph", error);
+		return -1;
+	}
+	cached = font->current;
+	Glyph_Pixmap_Metrics(font, cached, glyph);
+	/* freetype may report a larger pixmap than possible */
+	glyph->width = cached->pixmap.width;
+	if (font->outline <= 0 && glyph->width > cached->maxx - cached->minx) {
+		glyph->width = cached->maxx - cached->minx;
+	}
+	glyph->rows = cached->pixmap.rows;
+	glyph->pitch = cached->pixmap.pitch;
+	glyph->pixels = cached->pixmap.buffer;
+	if (!glyph->pixels || glyph->width <= 0) {
+		glyph->width = glyph->rows = 0;
+	}
+	return 0;
+}
+
+int TTF_GetGlyphIndexKerning(TTF_Font *font, Uint32 prev_index, Uint32 index)
+{
+	FT_Vector delta;
+
+	if (!font || !prev_index || !index || !font->kerning || !FT_HAS_KERNING(font->face)) {
+		return 0;
+	}
+	TTF_ACTIVATE_SIZE(font);
+	if (FT_Get_Kerning(font->face, prev_index, index, ft_kerning_default, &delta)) {
+		return 0;
+	}
+	return (delta.x >> 6);
+}
+
+void TTF_SetFontCacheBudget(TTF_Font *font, size_t bytes)
+{
+	if (!font) return;
+	font->cache_budget = bytes;
+	/* shrink right away, except for the current glyph */
+	while (font->cache_bytes > font->cache_budget && font->lru_last && font->lru_last != font->current) {
+		Remove_Glyph(font, font->lru_last);
+	}
+}
+
+void TTF_GetFontCacheStats(const TTF_Font *font, TTF_CacheStats *stats)
+{
+	if (!font || !stats) return;
+	stats->hits = font->cache_hits;
+	stats->misses = font->cache_misses;
+	stats->glyphs = font->cache_count;
+	stats->bytes = font->cache_bytes;
+}
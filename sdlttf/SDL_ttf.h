@@ -85,6 +85,20 @@ extern DECLSPEC int SDLCALL TTF_Init(void);
 
 extern DECLSPEC TTF_Font * SDLCALL TTF_OpenFont(const char *file, int pixelsize);
 
+/* A font file parsed once from memory and shared by the fonts opened from it,
+   each of them is a size of the face with its own glyph cache.
+   The face frees data with SDL_free() when freedata is set, also on failure.
+*/
+typedef struct _TTF_FontFace TTF_FontFace;
+
+extern DECLSPEC TTF_FontFace * SDLCALL TTF_OpenFontFaceMem(void *data, size_t size, int freedata);
+/* ownlibrary gives the face a FreeType instance of its own, the face and its
+   fonts may then be used on another thread than the other fonts */
+extern DECLSPEC TTF_FontFace * SDLCALL TTF_OpenFontFaceMemEx(void *data, size_t size, int freedata, int ownlibrary);
+extern DECLSPEC TTF_Font * SDLCALL TTF_OpenFontFromFace(TTF_FontFace *face, int pixelsize);
+/* The face is freed once it and the fonts opened from it are closed */
+extern DECLSPEC void SDLCALL TTF_CloseFontFace(TTF_FontFace *face);
+
 
 /* Set and retrieve the font style */
 #define TTF_STYLE_NORMAL        0x00
@@ -165,6 +179,49 @@ extern DECLSPEC int SDLCALL TTF_SizeUTF8(TTF_Font *font, const char *text, int *
 
 extern DECLSPEC SDL_Surface *TTF_RenderUTF8_Blended_PremultipliedAlpha(TTF_Font *font, const char *text);
 
+/* A glyph rendered on its own, e.g. to be packed into an atlas.
+   Drawn like TTF_RenderUTF8_Blended_PremultipliedAlpha() does, the pixmap's
+   top-left is at (pen + minx, yoffset) from the top-left of the text line.
+*/
+typedef struct TTF_GlyphPixmap {
+    Uint32 index;   /* FreeType glyph index, for TTF_GetGlyphIndexKerning() */
+    int minx;
+    int miny;
+    int extent;     /* right edge of the glyph bounds from the pen */
+    int yoffset;
+    int advance;    /* with the bold overhang */
+    int width;
+    int rows;
+    int pitch;
+    const Uint8 *pixels; /* 8-bit coverage, valid until the next call on the font */
+} TTF_GlyphPixmap;
+
+/* Decode the next character of UTF-8 text as the UTF8 functions do, advancing text and textlen */
+extern DECLSPEC Uint32 SDLCALL TTF_UTF8NextChar(const char **text, size_t *textlen);
+
+/* Render a glyph's pixmap and metrics, returns 0 on success */
+extern DECLSPEC int SDLCALL TTF_RenderGlyphPixmap(TTF_Font *font, Uint32 ch, TTF_GlyphPixmap *glyph);
+
+/* Get a glyph's metrics as TTF_RenderGlyphPixmap() does without rendering it,
+   the pixmap fields are 0. Returns 0 on success */
+extern DECLSPEC int SDLCALL TTF_GetGlyphPixmapMetrics(TTF_Font *font, Uint32 ch, TTF_GlyphPixmap *glyph);
+
+/* Get the kerning in pixels between two glyph indices, 0 if the font has none or kerning is off */
+extern DECLSPEC int SDLCALL TTF_GetGlyphIndexKerning(TTF_Font *font, Uint32 prev_index, Uint32 index);
+
+/* Each font caches its rendered glyphs by code point, the least recently used
+   are freed when the cache holds more than the budget (2MB by default).
+*/
+typedef struct TTF_CacheStats {
+    Uint32 hits;    /* lookups that found the glyph rendered */
+    Uint32 misses;  /* lookups that loaded or rendered the glyph */
+    int glyphs;
+    size_t bytes;
+} TTF_CacheStats;
+
+extern DECLSPEC void SDLCALL TTF_SetFontCacheBudget(TTF_Font *font, size_t bytes);
+extern DECLSPEC void SDLCALL TTF_GetFontCacheStats(const TTF_Font *font, TTF_CacheStats *stats);
+
 /* Close an opened font file */
 extern DECLSPEC void SDLCALL TTF_CloseFont(TTF_Font *font);
 